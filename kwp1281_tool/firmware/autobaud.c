@@ -0,0 +1,92 @@
+#include "autobaud.h"
+#include <stdint.h>
+#include <avr/interrupt.h>
+#include <avr/io.h>
+
+/*************************************************************************
+ * Auto-Baud
+ *
+ * Measures the baud rate of the 0x55 sync byte that the module sends
+ * after the 5 baud address.  With its start and stop bits, 0x55 is
+ * 0 1 0 1 0 1 0 1 0 1 on the line, so every bit has an edge.  The edges
+ * are timestamped with Timer1 from the INT0 interrupt, which is on the
+ * same pin as RXD1 (PD2), while the USART1 receiver is disabled.  The
+ * first and last edges used are both falling so any difference between
+ * the transceiver's rise and fall times cancels out.  The Output Compare
+ * A interrupt fires AUTOBAUD_MAX_GAP after each edge and starts the
+ * measurement over, so the edges of a 5 baud address that was still on
+ * the line when timing started are discarded.
+ *************************************************************************/
+
+static volatile uint16_t _edges[AUTOBAUD_EDGES];
+static volatile uint8_t _num_edges;
+
+// Start timestamping edges on PD2.  USART1 RX must be disabled.
+void autobaud_start()
+{
+    _num_edges = 0;
+
+    TCCR1A = 0;
+    TCCR1B = _BV(CS11);     // normal mode, prescaler 8
+    TCNT1 = 0;
+    TIFR1 = _BV(OCF1A);     // clear compare match seen before now
+    TIMSK1 |= _BV(OCIE1A);  // enable compare match A
+
+    EICRA = (EICRA & ~(_BV(ISC01) | _BV(ISC00))) | _BV(ISC00); // any edge
+    EIFR = _BV(INTF0);      // clear edge seen before now
+    EIMSK |= _BV(INT0);     // enable INT0
+}
+
+void autobaud_stop()
+{
+    EIMSK &= ~_BV(INT0);    // disable INT0
+    TIMSK1 &= ~_BV(OCIE1A); // disable compare match A
+    TCCR1B = 0;             // stop timer1
+}
+
+// Returns true when all edges of the sync byte have been timestamped
+uint8_t autobaud_done()
+{
+    return _num_edges == AUTOBAUD_EDGES;
+}
+
+// Returns the measured baud rate, or 0 if the edges were not evenly
+// spaced (not a 0x55 or noise on the line)
+uint32_t autobaud_baud()
+{
+    uint16_t total = _edges[AUTOBAUD_EDGES - 1] - _edges[0];
+    uint16_t bit = total / AUTOBAUD_BITS;
+    if (bit == 0) { return 0; }
+
+    // each edge must be within a quarter bit of where it is expected
+    for (uint8_t i=1; i<AUTOBAUD_EDGES; i++) {
+        uint16_t width = _edges[i] - _edges[i-1];
+        if ((width < bit - (bit / 4)) || (width > bit + (bit / 4))) { return 0; }
+    }
+
+    return (((uint32_t)AUTOBAUD_TIMER_HZ * AUTOBAUD_BITS) + (total / 2)) / total;
+}
+
+// Edge on PD2/INT0
+ISR(INT0_vect)
+{
+    uint16_t now = TCNT1;
+    uint8_t n = _num_edges;
+
+    // the first edge must be the falling edge of the start bit
+    if ((n == 0) && (PIND & _BV(PD2))) { return; }
+
+    _edges[n++] = now;
+    _num_edges = n;
+    OCR1A = now + AUTOBAUD_MAX_GAP;
+    if (n == AUTOBAUD_EDGES) {
+        EIMSK &= ~_BV(INT0);
+        TIMSK1 &= ~_BV(OCIE1A);
+    }
+}
+
+// No edge for longer than the slowest bit time
+ISR(TIMER1_COMPA_vect)
+{
+    _num_edges = 0;
+}
@@ -0,0 +1,21 @@
+#ifndef AUTOBAUD_H
+#define AUTOBAUD_H
+
+#include <stdint.h>
+
+// Timer1 counts at F_CPU/8 while the sync byte is measured
+#define AUTOBAUD_TIMER_HZ       (F_CPU / 8)
+#define AUTOBAUD_EDGES          9     // falling edges of start bit to bit 7
+#define AUTOBAUD_BITS           8     // bit times between first and last edge
+#define AUTOBAUD_MIN_BAUD       1200  // slowest rate that can be measured
+
+// Edges further apart than the slowest bit time (plus a quarter) are not
+// from the same sync byte, e.g. the edges of the 5 baud address
+#define AUTOBAUD_MAX_GAP        ((AUTOBAUD_TIMER_HZ * 5) / (AUTOBAUD_MIN_BAUD * 4))
+
+void autobaud_start();
+void autobaud_stop();
+uint8_t autobaud_done();
+uint32_t autobaud_baud();
+
+#endif
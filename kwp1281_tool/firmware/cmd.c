@@ -0,0 +1,497 @@
+#include <stdint.h>
+#include <string.h>
+#include <util/atomic.h>
+#include "cmd.h"
+#include "kwp1281.h"
+#include "main.h"
+#include "sniff.h"
+#include "uart.h"
+
+/*************************************************************************
+ * Command Interpreter
+ *
+ * Lets a host computer drive the KWP1281 connection over UART_DEBUG
+ * (see host/kwpclient.py).  The KWP1281 transcript is not sent while
+ * the command interface is in use (log_level is LOG_LEVEL_OFF).
+ *************************************************************************/
+
+void cmd_init()
+{
+    cmd_buf_index = 0;
+    cmd_expected_length = 0;
+}
+
+static void _send_empty_reply(uint8_t error_code)
+{
+    uart_put(UART_DEBUG, 1);   // 1 byte to follow
+    uart_put(UART_DEBUG, error_code);
+}
+
+/* Send CMD_ERROR_KWP with the result if it is an error, otherwise
+ * send nothing.  Returns 1 if a reply was sent.
+ */
+static uint8_t _reply_if_kwp_error(kwp_result_t result)
+{
+    if (result == KWP_SUCCESS) { return 0; }
+
+    uart_put(UART_DEBUG, 2);   // 2 bytes to follow
+    uart_put(UART_DEBUG, CMD_ERROR_KWP);
+    uart_put(UART_DEBUG, result);
+    return 1;
+}
+
+static void _reply_kwp_result(kwp_result_t result)
+{
+    if (_reply_if_kwp_error(result)) { return; }
+    _send_empty_reply(CMD_ERROR_OK);
+}
+
+/* Command: Echo
+ * Arguments: <arg1> <arg2> <arg3> ...
+ * Returns: <error> <arg1> <arg2> <arg3> ...
+ *
+ * Echo the arguments back.
+ */
+static void _do_echo()
+{
+    uart_put(UART_DEBUG, cmd_buf_index); // number of bytes to follow
+    uart_put(UART_DEBUG, CMD_ERROR_OK);  // error code
+    for (uint8_t i=1; i<cmd_buf_index; i++) {
+        uart_put(UART_DEBUG, cmd_buf[i]);
+    }
+}
+
+/* Command: Connect
+ * Arguments: <address> <baud high> <baud low>
+ * Returns: <error>
+ *
+ * Wake up the module at address and receive its identification blocks.
+ * If baud is 0, the rate is measured from the module's sync byte, with
+ * 9600 and 10400 baud tried if that fails.
+ */
+static void _do_kwp_connect()
+{
+    if (cmd_buf_index != 4) {
+        _send_empty_reply(CMD_ERROR_BAD_ARGS_LENGTH);
+        return;
+    }
+
+    uint8_t address = cmd_buf[1];
+    uint16_t baud = (cmd_buf[2] << 8) + cmd_buf[3];
+
+    kwp_result_t result;
+    if (baud == 0) {
+        result = kwp_autoconnect(address);
+    } else {
+        result = kwp_connect(address, baud);
+    }
+    _reply_kwp_result(result);
+}
+
+/* Command: Disconnect
+ * Arguments: none
+ * Returns: <error>
+ *
+ * Wait long enough for the module to end the session.  This takes
+ * about 5 seconds.
+ */
+static void _do_kwp_disconnect()
+{
+    if (cmd_buf_index != 1) {
+        _send_empty_reply(CMD_ERROR_BAD_ARGS_LENGTH);
+        return;
+    }
+    _reply_kwp_result(kwp_disconnect());
+}
+
+/* Command: Send Block
+ * Arguments: <title> <data0> <data1> ...
+ * Returns: <error>
+ *
+ * Send a block.  The block length, counter, and end are added.
+ */
+static void _do_kwp_send_block()
+{
+    if ((cmd_buf_index < 2) || (cmd_buf_index > 253)) {
+        _send_empty_reply(CMD_ERROR_BAD_ARGS_LENGTH);
+        return;
+    }
+
+    uint8_t datalen = cmd_buf_index - 2;
+    uint8_t block[256];
+    block[0] = datalen + 3;     // block length: counter + title + data + end
+    block[1] = 0;               // placeholder for block counter
+    memcpy(&block[2], &cmd_buf[1], datalen + 1);  // title + data
+    block[datalen + 3] = 0;     // placeholder for block end
+
+    _reply_kwp_result(kwp_send_block(block));
+}
+
+/* Command: Receive Block
+ * Arguments: none
+ * Returns: <error> <length> <counter> <title> <data0> ... <end>
+ *
+ * Receive a block and return all of its bytes.
+ */
+static void _do_kwp_receive_block()
+{
+    if (cmd_buf_index != 1) {
+        _send_empty_reply(CMD_ERROR_BAD_ARGS_LENGTH);
+        return;
+    }
+
+    kwp_result_t result = kwp_receive_block();
+    if (_reply_if_kwp_error(result)) { return; }
+    if (kwp_rx_size > 254) {
+        _send_empty_reply(CMD_ERROR_BAD_ARGS_VALUE);
+        return;
+    }
+
+    uart_put(UART_DEBUG, kwp_rx_size + 1); // number of bytes to follow
+    uart_put(UART_DEBUG, CMD_ERROR_OK);
+    for (uint8_t i=0; i<kwp_rx_size; i++) {
+        uart_put(UART_DEBUG, kwp_rx_buf[i]);
+    }
+}
+
+/* Command: Read Memory
+ * Arguments: <title> <address high> <address low> <length>
+ * Returns: <error> <data0> <data1> ...
+ *
+ * Read one chunk of memory.  The title is KWP_READ_RAM,
+ * KWP_READ_ROM_EEPROM, or KWP_READ_EEPROM.  The length is 1 to
+ * KWP_MAX_CHUNK_SIZE.
+ */
+static void _do_kwp_read_memory()
+{
+    if (cmd_buf_index != 5) {
+        _send_empty_reply(CMD_ERROR_BAD_ARGS_LENGTH);
+        return;
+    }
+
+    uint8_t title = cmd_buf[1];
+    uint16_t address = (cmd_buf[2] << 8) + cmd_buf[3];
+    uint8_t length = cmd_buf[4];
+
+    if ((title != KWP_READ_RAM) &&
+        (title != KWP_READ_ROM_EEPROM) &&
+        (title != KWP_READ_EEPROM)) {
+        _send_empty_reply(CMD_ERROR_BAD_ARGS_VALUE);
+        return;
+    }
+    if ((length == 0) || (length > KWP_MAX_CHUNK_SIZE)) {
+        _send_empty_reply(CMD_ERROR_BAD_ARGS_VALUE);
+        return;
+    }
+
+    uint8_t data[KWP_MAX_CHUNK_SIZE];
+    kwp_result_t result = kwp_read_mem_chunk(title, address, length, data);
+    if (_reply_if_kwp_error(result)) { return; }
+
+    uart_put(UART_DEBUG, length + 1); // number of bytes to follow
+    uart_put(UART_DEBUG, CMD_ERROR_OK);
+    for (uint8_t i=0; i<length; i++) {
+        uart_put(UART_DEBUG, data[i]);
+    }
+}
+
+/* Command: Login with SAFE Code
+ * Arguments: <safe code high> <safe code low>
+ * Returns: <error>
+ *
+ * Log in with the SAFE code (binary, not BCD) and read group 0x19 to
+ * unlock the protected commands.
+ */
+static void _do_kwp_login_safe()
+{
+    if (cmd_buf_index != 3) {
+        _send_empty_reply(CMD_ERROR_BAD_ARGS_LENGTH);
+        return;
+    }
+
+    uint16_t safe_code = (cmd_buf[1] << 8) + cmd_buf[2];
+    _reply_kwp_result(kwp_login_safe(safe_code));
+}
+
+/* Command: Premium 5 Manufacturing Login
+ * Arguments: none
+ * Returns: <error>
+ *
+ * Log in to a Premium 5 connected at address 0x7C.
+ */
+static void _do_kwp_p5_login_mfg()
+{
+    if (cmd_buf_index != 1) {
+        _send_empty_reply(CMD_ERROR_BAD_ARGS_LENGTH);
+        return;
+    }
+    _reply_kwp_result(kwp_p5_login_mfg());
+}
+
+/* Command: Module Info
+ * Arguments: none
+ * Returns: <error> <vag number: 12> <component 1: 12> <component 2: 12>
+ *
+ * Return the identification received by the last connect.  The fields
+ * are all zero if the module sent none (e.g. Premium 5 at 0x7C).
+ */
+static void _do_kwp_module_info()
+{
+    if (cmd_buf_index != 1) {
+        _send_empty_reply(CMD_ERROR_BAD_ARGS_LENGTH);
+        return;
+    }
+
+    uart_put(UART_DEBUG, 1 + (12 * 3)); // number of bytes to follow
+    uart_put(UART_DEBUG, CMD_ERROR_OK);
+    for (uint8_t i=0; i<12; i++) {
+        uart_put(UART_DEBUG, kwp_vag_number[i]);
+    }
+    for (uint8_t i=0; i<12; i++) {
+        uart_put(UART_DEBUG, kwp_component_1[i]);
+    }
+    for (uint8_t i=0; i<12; i++) {
+        uart_put(UART_DEBUG, kwp_component_2[i]);
+    }
+}
+
+static void _put_be16(uint16_t w)
+{
+    uart_put(UART_DEBUG, HIGH(w));
+    uart_put(UART_DEBUG, LOW(w));
+}
+
+/* Command: Session Info
+ * Arguments: none
+ * Returns: <error> <uptime ms: 4> <keep-alives: 2> <rtt: 2> <rtt max: 2>
+ *
+ * Return how long the session has been open (0 if it has been closed)
+ * and the keep-alive statistics.  Round trips are in 100 us ticks.
+ * All values are big endian.
+ */
+static void _do_kwp_session_info()
+{
+    if (cmd_buf_index != 1) {
+        _send_empty_reply(CMD_ERROR_BAD_ARGS_LENGTH);
+        return;
+    }
+
+    uint32_t uptime = kwp_session_uptime_ms();
+    uint16_t count, rtt, rtt_max;
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        count = kwp_keepalive_count;
+        rtt = kwp_keepalive_rtt;
+        rtt_max = kwp_keepalive_rtt_max;
+    }
+
+    uart_put(UART_DEBUG, 11); // number of bytes to follow
+    uart_put(UART_DEBUG, CMD_ERROR_OK);
+    _put_be16(uptime >> 16);
+    _put_be16(uptime & 0xFFFF);
+    _put_be16(count);
+    _put_be16(rtt);
+    _put_be16(rtt_max);
+}
+
+/* Command: Set Keep-Alive Interval
+ * Arguments: <interval ms high> <interval ms low>
+ * Returns: <error>
+ *
+ * Set the idle time before an ACK keep-alive is sent.  0 turns
+ * keep-alives off.
+ */
+static void _do_kwp_set_keepalive()
+{
+    if (cmd_buf_index != 3) {
+        _send_empty_reply(CMD_ERROR_BAD_ARGS_LENGTH);
+        return;
+    }
+
+    kwp_set_keepalive((cmd_buf[1] << 8) + cmd_buf[2]);
+    _send_empty_reply(CMD_ERROR_OK);
+}
+
+/* Command: Premium 5 Write EEPROM
+ * Arguments: <address high> <address low> <data0> <data1> ...
+ * Returns: <error> <bytes written: 2> <write blocks: 2>
+ *
+ * Write the data to the EEPROM starting at address.  Only the bytes
+ * that differ are written and they are verified by reading them back
+ * (see kwp_p5_write_eeprom()).  Counts are big endian.
+ */
+static void _do_kwp_p5_write_eeprom()
+{
+    if (cmd_buf_index < 4) {
+        _send_empty_reply(CMD_ERROR_BAD_ARGS_LENGTH);
+        return;
+    }
+
+    uint16_t address = (cmd_buf[1] << 8) + cmd_buf[2];
+    uint8_t length = cmd_buf_index - 3;
+    if (((uint32_t)address + length) > KWP_P5_EEPROM_SIZE) {
+        _send_empty_reply(CMD_ERROR_BAD_ARGS_VALUE);
+        return;
+    }
+
+    kwp_result_t result = kwp_p5_write_eeprom(address, length, &cmd_buf[3]);
+    if (_reply_if_kwp_error(result)) { return; }
+
+    uart_put(UART_DEBUG, 5); // number of bytes to follow
+    uart_put(UART_DEBUG, CMD_ERROR_OK);
+    _put_be16(kwp_eeprom_written);
+    _put_be16(kwp_eeprom_blocks);
+}
+
+/* Command: Stream Group Readings
+ * Arguments: <cycles high> <cycles low> <group0> <group1> ...
+ * Returns: <error> <elapsed ms: 4> <samples of group0: 2> ...
+ *
+ * Read the groups (up to KWP_STREAM_MAX_GROUPS) over and over.  Each
+ * response is sent as a DUMP_FRAME_GROUP frame (see dump.h) before the
+ * reply.  Cycles of 0 means until the host sends any byte, which is
+ * discarded.  Values are big endian.
+ */
+static void _do_kwp_stream_groups()
+{
+    if ((cmd_buf_index < 4) || (cmd_buf_index > 3 + KWP_STREAM_MAX_GROUPS)) {
+        _send_empty_reply(CMD_ERROR_BAD_ARGS_LENGTH);
+        return;
+    }
+
+    uint16_t cycles = (cmd_buf[1] << 8) + cmd_buf[2];
+    uint8_t count = cmd_buf_index - 3;
+
+    kwp_result_t result = kwp_stream_groups(&cmd_buf[3], count, cycles);
+    if (_reply_if_kwp_error(result)) { return; }
+
+    uart_put(UART_DEBUG, 5 + (count * 2)); // number of bytes to follow
+    uart_put(UART_DEBUG, CMD_ERROR_OK);
+    _put_be16(kwp_stream_elapsed_ms >> 16);
+    _put_be16(kwp_stream_elapsed_ms & 0xFFFF);
+    for (uint8_t i=0; i<count; i++) {
+        _put_be16(kwp_stream_samples[i]);
+    }
+}
+
+/* Command: Sniff
+ * Arguments: <baud high> <baud low>
+ * Returns: <error> <blocks: 2> <errors: 2> <dropped: 2>
+ *
+ * Listen to the K-line without driving it and send each block seen as
+ * a DUMP_FRAME_SNIFF frame (see sniff.h) until the host sends any byte,
+ * which is discarded.  If baud is 0, it is measured from the sync byte
+ * of each session.  The tool's own session must be disconnected first.
+ * Counts are big endian.
+ */
+static void _do_kwp_sniff()
+{
+    if (cmd_buf_index != 3) {
+        _send_empty_reply(CMD_ERROR_BAD_ARGS_LENGTH);
+        return;
+    }
+    if (kwp_session_uptime_ms() != 0) {
+        _reply_kwp_result(KWP_BUSY);
+        return;
+    }
+
+    sniff_run((cmd_buf[1] << 8) + cmd_buf[2]);
+
+    uart_put(UART_DEBUG, 7); // number of bytes to follow
+    uart_put(UART_DEBUG, CMD_ERROR_OK);
+    _put_be16(sniff_blocks);
+    _put_be16(sniff_errors);
+    _put_be16(sniff_dropped);
+}
+
+static void _cmd_dispatch()
+{
+    switch (cmd_buf[0]) {
+        case CMD_ECHO:
+            _do_echo();
+            break;
+
+        case CMD_KWP_CONNECT:
+            _do_kwp_connect();
+            break;
+        case CMD_KWP_DISCONNECT:
+            _do_kwp_disconnect();
+            break;
+        case CMD_KWP_SEND_BLOCK:
+            _do_kwp_send_block();
+            break;
+        case CMD_KWP_RECEIVE_BLOCK:
+            _do_kwp_receive_block();
+            break;
+        case CMD_KWP_READ_MEMORY:
+            _do_kwp_read_memory();
+            break;
+        case CMD_KWP_LOGIN_SAFE:
+            _do_kwp_login_safe();
+            break;
+        case CMD_KWP_P5_LOGIN_MFG:
+            _do_kwp_p5_login_mfg();
+            break;
+        case CMD_KWP_MODULE_INFO:
+            _do_kwp_module_info();
+            break;
+        case CMD_KWP_SESSION_INFO:
+            _do_kwp_session_info();
+            break;
+        case CMD_KWP_SET_KEEPALIVE:
+            _do_kwp_set_keepalive();
+            break;
+        case CMD_KWP_P5_WRITE_EEPROM:
+            _do_kwp_p5_write_eeprom();
+            break;
+        case CMD_KWP_STREAM_GROUPS:
+            _do_kwp_stream_groups();
+            break;
+        case CMD_KWP_SNIFF:
+            _do_kwp_sniff();
+            break;
+
+        default:
+            _send_empty_reply(CMD_ERROR_BAD_COMMAND);
+    }
+}
+
+/* Receive a command byte.  Commands are executed immediately after the
+ * last byte has been received.  The caller must call cmd_init() if no
+ * byte is received for CMD_TIMEOUT_MS so the client can resynchronize.
+ *
+ * Format of a command request:
+ *   <number of bytes to follow> <command byte> <arg> <arg> ...
+ * Examples:
+ *   01 11            Command 11 (disconnect), no args
+ *   04 10 56 00 00   Command 10 (connect), args: [56, 00, 00]
+ *
+ * Format of a command response:
+ *   <number of bytes to follow> <error> <arg> <arg> ...
+ * Examples:
+ *   01 00            Command succeeded, no data
+ *   03 00 AA 55      Command succeeded, data: [AA, 55]
+ *   02 05 01         Command failed, KWP1281 error: [01 (timeout)]
+ *
+ * Error byte of zero means success, non-zero means error.
+ */
+void cmd_receive_byte(uint8_t c)
+{
+    // receive command length byte
+    if (cmd_expected_length == 0) {
+        if (c == 0) { // invalid, command length must be 1 byte or longer
+            _send_empty_reply(CMD_ERROR_NO_COMMAND);
+            cmd_init();
+        } else {
+            cmd_expected_length = c;
+        }
+    }
+    // receive command byte(s)
+    else {
+        cmd_buf[cmd_buf_index++] = c;
+
+        if (cmd_buf_index == cmd_expected_length) {
+            _cmd_dispatch();
+            cmd_init();
+        }
+    }
+}
@@ -0,0 +1,38 @@
+#ifndef CMD_H
+#define CMD_H
+
+#include <stdint.h>
+
+#define CMD_ECHO 0x02
+
+#define CMD_KWP_CONNECT 0x10
+#define CMD_KWP_DISCONNECT 0x11
+#define CMD_KWP_SEND_BLOCK 0x12
+#define CMD_KWP_RECEIVE_BLOCK 0x13
+#define CMD_KWP_READ_MEMORY 0x14
+#define CMD_KWP_LOGIN_SAFE 0x15
+#define CMD_KWP_P5_LOGIN_MFG 0x16
+#define CMD_KWP_MODULE_INFO 0x17
+#define CMD_KWP_SESSION_INFO 0x18
+#define CMD_KWP_SET_KEEPALIVE 0x19
+#define CMD_KWP_P5_WRITE_EEPROM 0x1A
+#define CMD_KWP_STREAM_GROUPS 0x1B
+#define CMD_KWP_SNIFF 0x1C
+
+#define CMD_ERROR_OK 0x00
+#define CMD_ERROR_NO_COMMAND 0x01
+#define CMD_ERROR_BAD_COMMAND 0x02
+#define CMD_ERROR_BAD_ARGS_LENGTH 0x03
+#define CMD_ERROR_BAD_ARGS_VALUE 0x04
+#define CMD_ERROR_KWP 0x05      // followed by a kwp_result_t
+
+#define CMD_TIMEOUT_MS 2000     // forget a partial command after this
+
+uint8_t cmd_buf[256];
+uint8_t cmd_buf_index;
+uint8_t cmd_expected_length;
+
+void cmd_init();
+void cmd_receive_byte(uint8_t c);
+
+#endif
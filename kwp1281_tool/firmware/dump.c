@@ -0,0 +1,79 @@
+#include "main.h"
+#include "dump.h"
+#include "uart.h"
+#include <stdint.h>
+#include <string.h>
+#include <util/crc16.h>
+
+static uint16_t _crc;
+
+static void _put(uint8_t c)
+{
+    _crc = _crc_xmodem_update(_crc, c);
+    uart_put(UART_DEBUG, c);
+}
+
+static void _send_frame(uint8_t type, uint16_t address, uint8_t *data, uint8_t length)
+{
+    uart_put(UART_DEBUG, DUMP_SYNC_1);
+    uart_put(UART_DEBUG, DUMP_SYNC_2);
+
+    _crc = 0;
+    _put(type);
+    _put(HIGH(address));
+    _put(LOW(address));
+    _put(length);
+    for (uint8_t i=0; i<length; i++) {
+        _put(data[i]);
+    }
+
+    uint16_t crc = _crc;
+    uart_put(UART_DEBUG, HIGH(crc));
+    uart_put(UART_DEBUG, LOW(crc));
+}
+
+// Announce a dump of total_size bytes read with block title
+void dump_start(uint8_t title, uint16_t start_address, uint16_t total_size)
+{
+    uint8_t data[] = { title, HIGH(total_size), LOW(total_size) };
+    _send_frame(DUMP_FRAME_START, start_address, data, sizeof(data));
+}
+
+// Send a chunk of memory read from address
+void dump_data(uint16_t address, uint8_t *data, uint8_t length)
+{
+    _send_frame(DUMP_FRAME_DATA, address, data, length);
+}
+
+// End the dump.  address is the next address that would have been read.
+void dump_end(uint16_t address, uint8_t result, uint16_t retries, uint16_t reconnects)
+{
+    uint8_t data[] = { result, HIGH(retries), LOW(retries),
+                       HIGH(reconnects), LOW(reconnects) };
+    _send_frame(DUMP_FRAME_END, address, data, sizeof(data));
+}
+
+// Send a debug log record
+void dump_log(uint16_t seq, uint8_t *data, uint8_t length)
+{
+    _send_frame(DUMP_FRAME_LOG, seq, data, length);
+}
+
+// Send a group reading response received at tick (100 us units)
+void dump_group(uint8_t group, uint32_t tick, uint8_t *data, uint8_t length)
+{
+    uint8_t frame[255];
+    if (length > sizeof(frame) - 4) { length = sizeof(frame) - 4; }
+    frame[0] = tick >> 24;
+    frame[1] = tick >> 16;
+    frame[2] = tick >> 8;
+    frame[3] = tick;
+    memcpy(&frame[4], data, length);
+    _send_frame(DUMP_FRAME_GROUP, group, frame, length + 4);
+}
+
+// Send a K-line sniffer record
+void dump_sniff(uint16_t seq, uint8_t *data, uint8_t length)
+{
+    _send_frame(DUMP_FRAME_SNIFF, seq, data, length);
+}
@@ -0,0 +1,34 @@
+#ifndef DUMP_H
+#define DUMP_H
+
+#include <stdint.h>
+
+// Binary memory dump frames sent on UART_DEBUG
+//
+//   A5 5A <type> <address hi> <address lo> <length> <data...> <crc hi> <crc lo>
+//
+// The CRC is CRC-16/XMODEM over <type> through the last data byte.  Text
+// may appear between frames; it never contains 0xA5.
+#define DUMP_SYNC_1         0xA5
+#define DUMP_SYNC_2         0x5A
+
+// Frame Types
+#define DUMP_FRAME_START    'S'   /* data: <title> <total size hi> <total size lo> */
+#define DUMP_FRAME_DATA     'D'   /* data: memory at <address> */
+#define DUMP_FRAME_END      'E'   /* data: <kwp_result_t> <retries hi> <retries lo>
+                                           <reconnects hi> <reconnects lo> */
+#define DUMP_FRAME_LOG      'L'   /* data: debug log record (see log.h),
+                                     address is the record sequence number */
+#define DUMP_FRAME_GROUP    'G'   /* data: <tick: 4> <group reading data...>,
+                                     address is the group number */
+#define DUMP_FRAME_SNIFF    'K'   /* data: sniffer record (see sniff.h),
+                                     address is the record sequence number */
+
+void dump_start(uint8_t title, uint16_t start_address, uint16_t total_size);
+void dump_data(uint16_t address, uint8_t *data, uint8_t length);
+void dump_end(uint16_t address, uint8_t result, uint16_t retries, uint16_t reconnects);
+void dump_log(uint16_t seq, uint8_t *data, uint8_t length);
+void dump_group(uint8_t group, uint32_t tick, uint8_t *data, uint8_t length);
+void dump_sniff(uint16_t seq, uint8_t *data, uint8_t length);
+
+#endif
@@ -1,9 +1,13 @@
 #include "main.h"
 #include "kwp1281.h"
+#include "autobaud.h"
+#include "dump.h"
+#include "log.h"
+#include "timer.h"
 #include "uart.h"
 #include <string.h>
 #include <avr/io.h>
-#include <util/delay.h>
+#include <util/atomic.h>
 
 
 // Return a string description of a result
@@ -20,6 +24,9 @@ const char * kwp_describe_result(kwp_result_t result) {
         case KWP_UNEXPECTED:        return "Unexpected block title received";
         case KWP_MEM_TOO_SHORT:     return "Length of memory returned is shorter than requested";
         case KWP_MEM_TOO_LONG:      return "Length of memory returned is longer than requested";
+        case KWP_BUSY:              return "Exchange already in progress";
+        case KWP_NAK_RECEIVED:      return "No Acknowledge block received";
+        case KWP_VERIFY_FAILED:     return "Memory read back does not match memory written";
         default:                    return "???";
     }
 }
@@ -31,6 +38,9 @@ void kwp_panic_if_error(kwp_result_t result)
     if (result == KWP_SUCCESS) { return; }
 
     const char *msg = kwp_describe_result(result);
+    uint8_t args[] = { result };
+    LOG(LOG_LEVEL_ERROR, LOG_EV_RESULT, args, sizeof(args));
+    log_flush();
     uart_flush_tx(UART_DEBUG);
     uart_puts(UART_DEBUG, "\n\n*** KWP PANIC: ");
     uart_puts(UART_DEBUG, (char *)msg);
@@ -39,209 +49,616 @@ void kwp_panic_if_error(kwp_result_t result)
 }
 
 
-// Send module address at 5bps
-static void _send_address(uint8_t address)
+/*************************************************************************
+ * Protocol Engine
+ *
+ * Bytes are moved by the USART1 RX and UDRE interrupts.  The state
+ * machine below is stepped by kwp_tick() from the Timer3 interrupt, so
+ * a block exchange proceeds in the background with all delays and
+ * timeouts measured by the timer.  The main program submits a block
+ * with kwp_submit_*(), then polls with kwp_poll() or waits with
+ * kwp_complete().
+ *************************************************************************/
+
+#define KWP_TX_DELAY_MS     1       // default delay before sending each byte
+#define KWP_BLOCK_DELAY_MS  10      // default delay after receiving a block
+#define KWP_SYNC_DELAY_MS   30      // delay after 0x55 0x01 0x8A
+#define KWP_BYTE_TIMEOUT_MS 3000    // maximum wait for any byte
+#define KWP_ADDRESS_BIT_MS  200     // 1000ms / 5bps = 200ms per bit
+#define KWP_KEEPALIVE_MS    500     // default idle time before a keep-alive
+#define KWP_BAUD_FALLBACK   10400   // used if the sync byte can't be measured
+
+typedef enum
 {
-    UCSR1B &= ~_BV(RXEN1);  // Disable RX (PD2/TXD1)
-    UCSR1B &= ~_BV(TXEN1);  // Disable TX (PD3/TXD1)
-    DDRD |= _BV(PD3);       // PD3 = output
+    KWP_STATE_IDLE = 0,
+    KWP_STATE_ADDRESS_BIT = 1,  // sending 5 baud address
+    KWP_STATE_SYNC = 2,         // waiting for 0x55 0x01 0x8A
+    KWP_STATE_SYNC_DELAY = 3,   // waiting before sending 0x75
+    KWP_STATE_TX_DELAY = 4,     // waiting before sending next byte
+    KWP_STATE_TX_ECHO = 5,      // waiting for echo of byte sent
+    KWP_STATE_TX_COMPL = 6,     // waiting for complement of byte sent
+    KWP_STATE_RX_BYTE = 7,      // waiting for next byte of block
+    KWP_STATE_RX_DELAY = 8,     // waiting before sending complement
+    KWP_STATE_RX_ECHO = 9,      // waiting for echo of complement sent
+    KWP_STATE_BLOCK_DELAY = 10, // waiting after last byte of block
+    KWP_STATE_AUTOBAUD = 11,    // measuring 0x55 to find the baud rate
+} kwp_state_t;
+
+typedef enum
+{
+    KWP_OP_CONNECT = 0,
+    KWP_OP_SEND = 1,
+    KWP_OP_RECEIVE = 2,
+    KWP_OP_KEEPALIVE = 3,   // send ACK, receive ACK; started by kwp_tick()
+} kwp_op_t;
+
+static volatile kwp_state_t _state;
+static volatile kwp_result_t _result;
+static kwp_op_t _op;
+static uint32_t _deadline;          // tick when current wait ends
+static uint8_t _address;            // address being sent at 5 baud
+static uint8_t _address_bit;        // next bit of address to send
+static uint8_t _address_parity;
+static uint8_t _autobaud;           // flag: measure baud rate from 0x55
+static uint8_t _sync_index;         // bytes of 0x55 0x01 0x8A matched
+static uint8_t _tx_buf[256];        // block being sent
+static uint8_t _tx_index;           // index of byte in _tx_buf being sent
+static uint8_t _tx_byte;            // byte sent, awaiting echo/complement
+static uint8_t _rx_remaining;       // bytes left in block being received
+static uint8_t *_rx_buf;            // kwp_rx_buf, or _keepalive_rx_buf
+static uint8_t _rx_count;           // bytes received into _rx_buf
+
+static const uint8_t _sync_bytes[] = { 0x55, 0x01, 0x8a };
+
+static void _wait(uint16_t ms)
+{
+    _deadline = timer_now() + TIMER_MS(ms) + 1;
+}
 
-    uint8_t parity = 1;
-    for (uint8_t i=0; i<10; i++) {
-        uint8_t bit;
-        switch (i) {
-            case 0:     // start bit
-                bit = 0;
-                break;
-            case 8:     // parity bit
-                bit = parity;
-                break;
-            case 9:     // stop bit
-                bit = 1;
-                break;
-            default:    // 7 data bits
-                bit = (uint8_t)((address & (1 << (i - 1))) != 0);
-                parity ^= bit;
-        }
+static void _wait_ticks(uint16_t ticks)
+{
+    _deadline = timer_now() + ticks + 1;
+}
 
-        if (bit == 1) {
-            PORTD |= _BV(PD3);  // high
-        } else {
-            PORTD &= ~_BV(PD3); // low
-        }
-        _delay_ms(200);         // 1000ms / 5bps = 200ms per bit
-    }
+/*************************************************************************
+ * Delay Tuning
+ *
+ * The delays before each byte and after each block start at the values
+ * above, which are safe for any module.  During the first blocks of a
+ * session, we measure how long the module takes to respond: the time
+ * from the end of a byte we send to the end of its reply byte, and from
+ * the end of a block we send to the end of the first byte of its reply.
+ * Subtracting one byte time gives the module's turnaround.  The delays
+ * are then shrunk to the slowest turnaround seen plus a safety margin.
+ * If a block exchange of the session fails with a bad echo or timeout,
+ * the margin is doubled, the delays go back to their defaults, and the
+ * next blocks are measured again to tune them with the new margin.  Each
+ * session starts again from the initial margin.
+ *************************************************************************/
+
+#define KWP_TUNE_BLOCKS         8   // blocks to measure before tuning
+#define KWP_TUNE_MARGIN_TICKS   3   // initial margin (300 us)
+#define KWP_TX_DELAY_MIN_TICKS  2   // never send sooner than this
+
+static uint16_t _tx_delay;          // ticks to wait before sending a byte
+static uint16_t _block_delay;       // ticks to wait after receiving a block
+static uint16_t _tune_margin;       // added to the turnaround when tuned
+static uint8_t _tune_blocks;        // blocks left to measure; 0=tuned
+static uint8_t _byte_ticks;         // time of one byte (10 bits) on the line
+static uint16_t _byte_latency_max;  // slowest reply to a byte
+static uint16_t _block_latency_max; // slowest reply to a block
+static uint32_t _mark;              // tick when our last byte was echoed
+static uint8_t _block_mark;         // flag: _mark is the end of a block
+
+static void _tune_reset(uint32_t baud)
+{
+    _tx_delay = TIMER_MS(KWP_TX_DELAY_MS);
+    _block_delay = TIMER_MS(KWP_BLOCK_DELAY_MS);
+    _tune_blocks = KWP_TUNE_BLOCKS;
+    _tune_margin = KWP_TUNE_MARGIN_TICKS;
+    _byte_ticks = (10 * TIMER_TICKS_PER_SEC + baud - 1) / baud;
+    _byte_latency_max = 0;
+    _block_latency_max = 0;
+    _block_mark = 0;
+}
 
-    UCSR1B |= _BV(TXEN1);   // Enable TX (PD3/TXD1)
-    UCSR1B |= _BV(RXEN1);   // Enable RX (PD2/TXD1)
-    DDRD &= ~_BV(PD3);      // PD3 = input
+static void _tune_mark(uint8_t end_of_block)
+{
+    _mark = timer_now();
+    _block_mark = end_of_block;
 }
 
+static void _tune_sample(uint16_t *latency_max)
+{
+    if (_tune_blocks == 0) { return; }
+    uint32_t latency = timer_now() - _mark;
+    if (latency > 0xFFFF) { latency = 0xFFFF; }
+    if (latency > *latency_max) { *latency_max = latency; }
+}
 
-// Send byte only
-static kwp_result_t _send_byte(uint8_t tx_byte)
+// Turnaround plus margin, never more than the default delay
+static uint16_t _tuned_delay(uint16_t latency_max, uint16_t default_delay)
 {
-    _delay_ms(1);
+    uint16_t delay = KWP_TX_DELAY_MIN_TICKS;
+    if (latency_max > _byte_ticks) { delay += latency_max - _byte_ticks; }
+    delay += _tune_margin;
+    if (delay > default_delay) { delay = default_delay; }
+    return delay;
+}
 
-    // send byte
-    uart_blocking_put(UART_KLINE, tx_byte);
+static void _tune_block_done()
+{
+    if (_tune_blocks == 0) { return; }
+    if (--_tune_blocks != 0) { return; }
+    _tx_delay = _tuned_delay(_byte_latency_max, TIMER_MS(KWP_TX_DELAY_MS));
+    _block_delay = _tuned_delay(_block_latency_max, TIMER_MS(KWP_BLOCK_DELAY_MS));
+}
 
-    // consume its echo
-    uint8_t echo;
-    uint8_t uart_ready = uart_blocking_get_with_timeout(UART_KLINE, 3000, &echo);
-    if (!uart_ready) { return KWP_TIMEOUT; }
-    if (echo != tx_byte) { return KWP_BAD_ECHO; }
+static void _tune_back_off()
+{
+    if (_tune_margin < TIMER_MS(KWP_BLOCK_DELAY_MS)) { _tune_margin *= 2; }
+    _tx_delay = TIMER_MS(KWP_TX_DELAY_MS);
+    _block_delay = TIMER_MS(KWP_BLOCK_DELAY_MS);
+    _tune_blocks = KWP_TUNE_BLOCKS;
+    _byte_latency_max = 0;
+    _block_latency_max = 0;
+}
 
-    uart_puthex(UART_DEBUG, tx_byte);
-    uart_put(UART_DEBUG, ' ');
-    return KWP_SUCCESS;
+/*************************************************************************
+ * Keep-Alive
+ *
+ * The module ends the session if it doesn't receive a block for a
+ * while.  When the session is open, it is our turn to send (the last
+ * block was received from the module), and no exchange has been
+ * submitted for _keepalive_interval, kwp_tick() sends an ACK block and
+ * receives the module's ACK in the background.  A keep-alive that fails
+ * closes the session; the next exchange submitted will fail as well.
+ *************************************************************************/
+
+static uint8_t _session_open;       // flag: connected and no errors since
+static uint8_t _our_turn;           // flag: module is waiting for a block
+static uint32_t _session_start;     // tick when kwp_connect() succeeded
+static uint32_t _keepalive_interval = TIMER_MS(KWP_KEEPALIVE_MS);
+static uint32_t _keepalive_due;     // tick when the next keep-alive is sent
+static uint32_t _keepalive_sent;    // tick when keep-alive in progress started
+static uint8_t _keepalive_rx_buf[256];
+
+static uint8_t _keepalive_is_due()
+{
+    return _session_open && _our_turn && (_keepalive_interval != 0) &&
+           timer_expired(_keepalive_due);
 }
 
+static void _keepalive_send()
+{
+    _tx_buf[0] = 0x03;                  // block length
+    _tx_buf[1] = ++kwp_block_counter;   // block counter
+    _tx_buf[2] = KWP_ACK;               // block title
+    _tx_buf[3] = 0x03;                  // block end
+
+    _op = KWP_OP_KEEPALIVE;
+    _our_turn = 0;
+    _tx_index = 0;
+    _keepalive_sent = timer_now();
+    _wait_ticks(_tx_delay);
+    _state = KWP_STATE_TX_DELAY;
+}
 
-// Send byte and receive its complement
-static kwp_result_t _send_byte_recv_compl(uint8_t tx_byte)
+static void _keepalive_done(kwp_result_t result)
 {
-    kwp_result_t result = _send_byte(tx_byte);
-    if (result != KWP_SUCCESS) { return result; }
+    if (result != KWP_SUCCESS) { return; }
 
-    uint8_t complement;
-    uint8_t uart_ready = uart_blocking_get_with_timeout(UART_KLINE, 3000, &complement);
-    if (!uart_ready) { return KWP_TIMEOUT; }
-    if (complement != (tx_byte ^ 0xff)) { return KWP_BAD_COMPLEMENT; }
+    uint32_t rtt = timer_now() - _keepalive_sent;
+    if (rtt > 0xFFFF) { rtt = 0xFFFF; }
+    kwp_keepalive_rtt = rtt;
+    if (rtt > kwp_keepalive_rtt_max) { kwp_keepalive_rtt_max = rtt; }
+    kwp_keepalive_count++;
 
-    return KWP_SUCCESS;
+    uint8_t args[] = { HIGH(rtt), LOW(rtt) };
+    LOG(LOG_LEVEL_DEBUG, LOG_EV_KEEPALIVE, args, sizeof(args));
 }
 
+// Wait for a keep-alive in progress to finish, then hold off the next
+// one while the caller sets up its exchange
+static kwp_result_t _claim()
+{
+    while (1) {
+        ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+            if (_state == KWP_STATE_IDLE) {
+                _keepalive_due = timer_now() + _keepalive_interval;
+                return KWP_SUCCESS;
+            }
+            if (_op != KWP_OP_KEEPALIVE) { return KWP_BUSY; }
+        }
+        timer_sleep();
+    }
+}
 
-// Receive byte only
-static kwp_result_t _recv_byte(uint8_t *rx_byte_out)
+static void _finish(kwp_result_t result)
 {
-    uint8_t uart_ready = uart_blocking_get_with_timeout(UART_KLINE, 3000, rx_byte_out);
-    if (!uart_ready) { return KWP_TIMEOUT; }
+    // Only the exchanges of a session use the tuned delays.  A failed
+    // connect or keep-alive says nothing about them.
+    if (((_op == KWP_OP_SEND) || (_op == KWP_OP_RECEIVE)) &&
+        ((result == KWP_BAD_ECHO) || (result == KWP_TIMEOUT))) {
+        _tune_back_off();
+    }
 
-    uart_puthex(UART_DEBUG, *rx_byte_out);
-    uart_put(UART_DEBUG, ' ');
-    return KWP_SUCCESS;
+    if (_op == KWP_OP_KEEPALIVE) {
+        if ((result == KWP_SUCCESS) && (_keepalive_rx_buf[2] != KWP_ACK)) {
+            result = KWP_UNEXPECTED;
+        }
+        _keepalive_done(result);    // _result is left for the main program
+    } else {
+        if (_op == KWP_OP_RECEIVE) { kwp_rx_size = _rx_count; }
+        _result = result;
+    }
+
+    if (result != KWP_SUCCESS) {
+        _session_open = 0;
+        _our_turn = 0;
+    }
+    _keepalive_due = timer_now() + _keepalive_interval;
+    _state = KWP_STATE_IDLE;
 }
 
+// Get a received byte if one is available.  If not, and the byte
+// timeout has expired, finish with a timeout.
+static uint8_t _get(uint8_t *rx_byte_out)
+{
+    if (uart_rx_ready(UART_KLINE)) {
+        *rx_byte_out = uart_blocking_get(UART_KLINE);
+        return 1;
+    }
+    if (timer_expired(_deadline)) { _finish(KWP_TIMEOUT); }
+    return 0;
+}
 
-// Receive byte and send its complement
-static kwp_result_t _recv_byte_send_compl(uint8_t *rx_byte_out)
+static void _put(uint8_t tx_byte)
 {
-    kwp_result_t result = _recv_byte(rx_byte_out);
-    if (result != KWP_SUCCESS) { return result; }
+    _tx_byte = tx_byte;
+    uart_put(UART_KLINE, tx_byte);
+    _wait(KWP_BYTE_TIMEOUT_MS);
+}
 
-    _delay_ms(1);
+// Drive the next bit of the 5 baud address
+static void _tick_address_bit()
+{
+    if (_address_bit == 10) {   // stop bit has been sent
+        UCSR1B |= _BV(TXEN1);   // Enable TX (PD3/TXD1)
+        DDRD &= ~_BV(PD3);      // PD3 = input
 
-    // send complement byte
-    uint8_t complement = *rx_byte_out ^ 0xFF;
-    uart_blocking_put(UART_KLINE, complement);
+        if (_autobaud) {        // RX stays off while 0x55 is timed
+            autobaud_start();
+            _state = KWP_STATE_AUTOBAUD;
+        } else {
+            UCSR1B |= _BV(RXEN1);   // Enable RX (PD2/TXD1)
+            _sync_index = 0;
+            _state = KWP_STATE_SYNC;
+        }
+        _wait(KWP_BYTE_TIMEOUT_MS);
+        return;
+    }
 
-    // consume its echo
-    uint8_t echo;
-    uint8_t uart_ready = uart_blocking_get_with_timeout(UART_KLINE, 3000, &echo);
-    if (!uart_ready) { return KWP_TIMEOUT; }
-    if (echo != complement) { return KWP_BAD_ECHO; }
+    uint8_t bit;
+    switch (_address_bit) {
+        case 0:     // start bit
+            bit = 0;
+            break;
+        case 8:     // parity bit
+            bit = _address_parity;
+            break;
+        case 9:     // stop bit
+            bit = 1;
+            break;
+        default:    // 7 data bits
+            bit = (uint8_t)((_address & (1 << (_address_bit - 1))) != 0);
+            _address_parity ^= bit;
+    }
 
-    return KWP_SUCCESS;
+    if (bit == 1) {
+        PORTD |= _BV(PD3);  // high
+    } else {
+        PORTD &= ~_BV(PD3); // low
+    }
+
+    _address_bit++;
+    _deadline += TIMER_MS(KWP_ADDRESS_BIT_MS);
 }
 
+// The 0x55 sync byte has been timed.  Switch UART_KLINE to the measured
+// rate and receive the rest of the sync bytes (0x01 0x8A) with it.
+static void _tick_autobaud()
+{
+    uint32_t baud = autobaud_baud();
+    autobaud_stop();
+    if (baud != 0) { kwp_baud = baud; }  // else keep KWP_BAUD_FALLBACK
+
+    uart_init(UART_KLINE, kwp_baud);    // also enables RX
+    _tune_reset(kwp_baud);
 
-// Wait for the 0x55 0x01 0x8A sequence during initial connection
-static kwp_result_t _wait_for_55_01_8a()
+    _sync_index = 1;    // 0x55 was timed, not received
+    _state = KWP_STATE_SYNC;
+    _wait(KWP_BYTE_TIMEOUT_MS);
+}
+
+// Handle a byte received as part of a block
+static void _tick_rx_byte(uint8_t c)
 {
-    const uint8_t expected_rx_bytes[] = { 0x55, 0x01, 0x8a };
-    uint8_t rx_byte;
-    uint8_t i = 0;
+    if (_rx_count != 0) {
+        _tune_sample(&_byte_latency_max);
+    } else if (_block_mark) {
+        _tune_sample(&_block_latency_max);
+    }
 
-    while (1) {
-        kwp_result_t result = _recv_byte(&rx_byte);
-        if (result != KWP_SUCCESS) { return result; }
+    // last byte in block (0x03 block end) gets no complement
+    if ((_rx_count != 0) && (_rx_remaining == 1)) {
+        if (c != 0x03) { _finish(KWP_BAD_BLK_END); return; }
+        _rx_buf[_rx_count++] = c;
+        _tune_block_done();
+        _state = KWP_STATE_BLOCK_DELAY;
+        _wait_ticks(_block_delay);
+        return;
+    }
 
-        if (rx_byte == expected_rx_bytes[i]) {
-            if (++i == 3) { return KWP_SUCCESS; }
-        } else {
-            i = 0;
-        }
+    _rx_buf[_rx_count++] = c;
+    if (_rx_count == 0xFF) { _finish(KWP_RX_OVERFLOW); return; }
+
+    switch (_rx_count) {
+        case 1:  // block length (must be at least 3 for title, counter, end)
+            if (c < 3) { _finish(KWP_BAD_BLK_LENGTH); return; }
+            _rx_remaining = c;
+            break;
+        case 2:  // block counter
+            if (kwp_is_first_block) {   // set initial value
+                kwp_block_counter = c;
+                kwp_is_first_block = 0;
+            } else {                    // increment; detect mismatch
+                if (++kwp_block_counter != c) { _finish(KWP_BAD_BLK_COUNTER); return; }
+            }
+            // fall through
+        default:
+            _rx_remaining--;
     }
+
+    _tx_byte = c ^ 0xFF;
+    _state = KWP_STATE_RX_DELAY;
+    _wait_ticks(_tx_delay);
 }
 
+// Step the state machine.  Called from the timer interrupt on every tick.
+void kwp_tick()
+{
+    uint8_t c;
 
-// Send a block
-kwp_result_t kwp_send_block(uint8_t *buf)
+    switch (_state) {
+        case KWP_STATE_IDLE:
+            if (_keepalive_is_due()) { _keepalive_send(); }
+            break;
+
+        case KWP_STATE_ADDRESS_BIT:
+            if (timer_expired(_deadline)) { _tick_address_bit(); }
+            break;
+
+        case KWP_STATE_AUTOBAUD:
+            if (autobaud_done()) {
+                _tick_autobaud();
+            } else if (timer_expired(_deadline)) {
+                autobaud_stop();
+                _finish(KWP_TIMEOUT);
+            }
+            break;
+
+        case KWP_STATE_SYNC:
+            if (!_get(&c)) { break; }
+            if (c == _sync_bytes[_sync_index]) {
+                if (++_sync_index == 3) {
+                    _state = KWP_STATE_SYNC_DELAY;
+                    _wait(KWP_SYNC_DELAY_MS);
+                    break;
+                }
+            } else {
+                _sync_index = 0;
+            }
+            _wait(KWP_BYTE_TIMEOUT_MS);
+            break;
+
+        case KWP_STATE_SYNC_DELAY:
+            if (!timer_expired(_deadline)) { break; }
+            _put(0x75);
+            _state = KWP_STATE_TX_ECHO;
+            break;
+
+        case KWP_STATE_TX_DELAY:
+            if (!timer_expired(_deadline)) { break; }
+            _put(_tx_buf[_tx_index]);
+            _state = KWP_STATE_TX_ECHO;
+            break;
+
+        case KWP_STATE_TX_ECHO:
+            if (!_get(&c)) { break; }
+            if (c != _tx_byte) { _finish(KWP_BAD_ECHO); break; }
+            if ((_op == KWP_OP_CONNECT) || (_tx_index == _tx_buf[0])) {
+                // 0x75 or block end, no complement
+                _tune_mark(1);
+                if (_op == KWP_OP_CONNECT) {
+                    _finish(KWP_SUCCESS);
+                    break;
+                }
+                _tx_index++;
+                _tune_block_done();
+                if (_op == KWP_OP_KEEPALIVE) {   // now receive the reply
+                    _rx_buf = _keepalive_rx_buf;
+                    _rx_count = 0;
+                    _rx_remaining = 1;
+                    _wait(KWP_BYTE_TIMEOUT_MS);
+                    _state = KWP_STATE_RX_BYTE;
+                    break;
+                }
+                _finish(KWP_SUCCESS);
+                break;
+            }
+            _tune_mark(0);
+            _state = KWP_STATE_TX_COMPL;
+            break;
+
+        case KWP_STATE_TX_COMPL:
+            if (!_get(&c)) { break; }
+            if (c != (_tx_byte ^ 0xFF)) { _finish(KWP_BAD_COMPLEMENT); break; }
+            _tune_sample(&_byte_latency_max);
+            _tx_index++;
+            _state = KWP_STATE_TX_DELAY;
+            _wait_ticks(_tx_delay);
+            break;
+
+        case KWP_STATE_RX_BYTE:
+            if (_get(&c)) { _tick_rx_byte(c); }
+            break;
+
+        case KWP_STATE_RX_DELAY:
+            if (!timer_expired(_deadline)) { break; }
+            _put(_tx_byte);
+            _state = KWP_STATE_RX_ECHO;
+            break;
+
+        case KWP_STATE_RX_ECHO:
+            if (!_get(&c)) { break; }
+            if (c != _tx_byte) { _finish(KWP_BAD_ECHO); break; }
+            _tune_mark(0);
+            _state = KWP_STATE_RX_BYTE;
+            break;
+
+        case KWP_STATE_BLOCK_DELAY:
+            if (!timer_expired(_deadline)) { break; }
+            _our_turn = 1;
+            _finish(KWP_SUCCESS);
+            break;
+    }
+}
+
+// Start the 5 baud address and initial handshake.  Delays return to
+// their defaults and are tuned again for the new session.  If baud is
+// KWP_BAUD_AUTO, the rate is measured from the module's 0x55 sync byte.
+kwp_result_t kwp_submit_connect(uint8_t address, uint32_t baud)
 {
-    uint8_t block_length = buf[0];
-    uint8_t buf_size = block_length + 1;
+    kwp_result_t result = _claim();
+    if (result != KWP_SUCCESS) { return result; }
+    _session_open = 0;
+    _our_turn = 0;
 
-    buf[1] = ++kwp_block_counter;   // insert block counter
-    buf[buf_size - 1] = 0x03;       // insert block end
+    _autobaud = (baud == KWP_BAUD_AUTO);
+    if (_autobaud) { baud = KWP_BAUD_FALLBACK; }
+    kwp_baud = baud;
 
-    uart_puts(UART_DEBUG, "SEND: ");
+    uart_init(UART_KLINE, baud);
+    _tune_reset(baud);
 
-    // send each byte and receive its complement, except block end
-    kwp_result_t result;
-    uint8_t i;
-    for (i=0; i<(buf_size-1); i++) {
-        result = _send_byte_recv_compl(buf[i]);
-        if (result != KWP_SUCCESS) { return result; }
+    UCSR1B &= ~_BV(RXEN1);  // Disable RX (PD2/TXD1)
+    UCSR1B &= ~_BV(TXEN1);  // Disable TX (PD3/TXD1)
+    DDRD |= _BV(PD3);       // PD3 = output
+
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        _op = KWP_OP_CONNECT;
+        _address = address;
+        _address_bit = 0;
+        _address_parity = 1;
+        _deadline = timer_now();
+        _result = KWP_BUSY;
+        _state = KWP_STATE_ADDRESS_BIT;
     }
+    return KWP_SUCCESS;
+}
 
-    // send block end, do not receive complement
-    result = _send_byte(buf[i]);
+// Start sending a block.  The block counter and block end are inserted
+// into buf, then it is copied so the caller may reuse it immediately.
+kwp_result_t kwp_submit_send_block(uint8_t *buf)
+{
+    kwp_result_t result = _claim();
     if (result != KWP_SUCCESS) { return result; }
 
-    uart_puts(UART_DEBUG, "\n");
+    uint8_t block_length = buf[0];
+    uint8_t buf_size = block_length + 1;
+
+    buf[1] = ++kwp_block_counter;   // insert block counter
+    buf[buf_size - 1] = 0x03;       // insert block end
+    memcpy(_tx_buf, buf, buf_size);
+
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        _op = KWP_OP_SEND;
+        _our_turn = 0;
+        _tx_index = 0;
+        _wait_ticks(_tx_delay);
+        _result = KWP_BUSY;
+        _state = KWP_STATE_TX_DELAY;
+    }
     return KWP_SUCCESS;
 }
 
-
-// Receive a block
-kwp_result_t kwp_receive_block()
+// Start receiving a block into kwp_rx_buf
+kwp_result_t kwp_submit_receive_block()
 {
-    uart_puts(UART_DEBUG, "RECV: ");
+    kwp_result_t result = _claim();
+    if (result != KWP_SUCCESS) { return result; }
 
     kwp_rx_size = 0;
     memset(kwp_rx_buf, 0, sizeof(kwp_rx_buf));
 
-    uint8_t bytes_remaining = 1;
-    uint8_t c;
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        _op = KWP_OP_RECEIVE;
+        _rx_buf = kwp_rx_buf;
+        _rx_count = 0;
+        _rx_remaining = 1;
+        _wait(KWP_BYTE_TIMEOUT_MS);
+        _result = KWP_BUSY;
+        _state = KWP_STATE_RX_BYTE;
+    }
+    return KWP_SUCCESS;
+}
+
+// Returns KWP_BUSY while an exchange is in progress, otherwise the
+// result of the last exchange submitted.  Keep-alives are not counted.
+kwp_result_t kwp_poll()
+{
+    if ((_state != KWP_STATE_IDLE) && (_op != KWP_OP_KEEPALIVE)) {
+        return KWP_BUSY;
+    }
+    return _result;
+}
+
+// Wait for the exchange in progress to finish and return its result.
+// Log records queued during the exchange are sent afterward.
+kwp_result_t kwp_complete()
+{
     kwp_result_t result;
+    while ((result = kwp_poll()) == KWP_BUSY) {
+        timer_sleep();
+    }
+    log_drain();
+    return result;
+}
 
-    while (bytes_remaining) {
-        if ((kwp_rx_size == 0) || (bytes_remaining > 1)) {
-            result = _recv_byte_send_compl(&c);
-            if (result != KWP_SUCCESS) { return result; }
-        } else {
-            // do not send complement for last byte in block (0x03 block end)
-            result = _recv_byte(&c);
-            if (result != KWP_SUCCESS) { return result; }
-            if (c != 0x03) { return KWP_BAD_BLK_END; }
-        }
 
-        kwp_rx_buf[kwp_rx_size++] = c;
-        if (kwp_rx_size == sizeof(kwp_rx_buf)) { return KWP_RX_OVERFLOW; }
+// Send a block
+kwp_result_t kwp_send_block(uint8_t *buf)
+{
+    kwp_result_t result = kwp_submit_send_block(buf);
+    if (result != KWP_SUCCESS) { return result; }
+    result = kwp_complete();
+
+    // bytes before _tx_index were sent and acknowledged
+    LOG(LOG_LEVEL_DEBUG, LOG_EV_SEND, _tx_buf, _tx_index);
+    return result;
+}
 
-        switch (kwp_rx_size) {
-            case 1:  // block length (must be at least 3 for title, counter, end)
-                if (c < 3) { return KWP_BAD_BLK_LENGTH; }
-                bytes_remaining = c;
-                break;
-            case 2:  // block counter
-                if (kwp_is_first_block) {   // set initial value
-                    kwp_block_counter = c;
-                    kwp_is_first_block = 0;
-                } else {                    // increment; detect mismatch
-                    if (++kwp_block_counter != c) { return KWP_BAD_BLK_COUNTER; }
-                }
-                // fall through
-            default:
-                bytes_remaining--;
-        }
-    }
 
-    _delay_ms(10);
-    uart_puts(UART_DEBUG, "\n");
-    return KWP_SUCCESS;
+// Receive a block
+kwp_result_t kwp_receive_block()
+{
+    kwp_result_t result = kwp_submit_receive_block();
+    if (result != KWP_SUCCESS) { return result; }
+    result = kwp_complete();
+
+    LOG(LOG_LEVEL_DEBUG, LOG_EV_RECV, kwp_rx_buf, kwp_rx_size);
+    return result;
 }
 
 
@@ -252,20 +669,15 @@ kwp_result_t kwp_receive_block_expect(uint8_t title)
     if (result != KWP_SUCCESS) { return result; }
     if (kwp_rx_buf[2] == title) { return KWP_SUCCESS; }
 
-    uart_flush_tx(UART_DEBUG);
-    uart_puts(UART_DEBUG, "\n\nExpected to receive title 0x");
-    uart_puthex(UART_DEBUG, title);
-    uart_puts(UART_DEBUG, ", got 0x");
-    uart_puthex(UART_DEBUG, kwp_rx_buf[2]);
-    uart_put(UART_DEBUG, '\n');
-
+    uint8_t args[] = { title, kwp_rx_buf[2] };
+    LOG(LOG_LEVEL_WARN, LOG_EV_UNEXPECTED, args, sizeof(args));
     return KWP_UNEXPECTED;
 }
 
 
 kwp_result_t kwp_send_ack_block()
 {
-    uart_puts(UART_DEBUG, "PERFORM ACK\n");
+    LOG_TEXT(LOG_LEVEL_DEBUG, "PERFORM ACK");
     uint8_t block[] = {
         0x03,       // block length
         0,          // placeholder for block counter
@@ -278,7 +690,7 @@ kwp_result_t kwp_send_ack_block()
 
 kwp_result_t kwp_send_login_block(uint16_t safe_code, uint8_t fern, uint16_t workshop)
 {
-    uart_puts(UART_DEBUG, "PERFORM LOGIN\n");
+    LOG_TEXT(LOG_LEVEL_DEBUG, "PERFORM LOGIN");
     uint8_t block[] = {
         0x08,               // block length
         0,                  // placeholder for block counter
@@ -318,7 +730,7 @@ kwp_result_t kwp_login_safe(uint16_t safe_code)
 
 kwp_result_t kwp_send_group_reading_block(uint8_t group)
 {
-    uart_puts(UART_DEBUG, "PERFORM GROUP READ\n");
+    LOG_TEXT(LOG_LEVEL_DEBUG, "PERFORM GROUP READ");
     uint8_t block[] = {
         0x04,               // block length
         0,                  // placeholder for block counter
@@ -330,9 +742,74 @@ kwp_result_t kwp_send_group_reading_block(uint8_t group)
 }
 
 
+/*************************************************************************
+ * Group Reading Stream
+ *
+ * Measuring groups are read one after another with no ACK exchange in
+ * between, so the only limit on the rate is the module's response time
+ * (and the tuned delays).  Each response is sent to UART_DEBUG as a
+ * DUMP_FRAME_GROUP frame stamped with the tick it was received.
+ *************************************************************************/
+
+// Read one group and send its response.  Returns KWP_NAK_RECEIVED if
+// the module doesn't have the group; no frame is sent in that case.
+static kwp_result_t _stream_group(uint8_t group)
+{
+    kwp_result_t result = kwp_send_group_reading_block(group);
+    if (result != KWP_SUCCESS) { return result; }
+
+    result = kwp_receive_block();
+    if (result != KWP_SUCCESS) { return result; }
+    uint32_t tick = timer_now();
+
+    if (kwp_rx_buf[2] == KWP_NAK) { return KWP_NAK_RECEIVED; }
+    if (kwp_rx_buf[2] != KWP_R_GROUP_READING) { return KWP_UNEXPECTED; }
+
+    uint8_t datalen = kwp_rx_buf[0] - 3;  // block length - (counter + title + end)
+    dump_group(group, tick, &kwp_rx_buf[3], datalen);
+    return KWP_SUCCESS;
+}
+
+// Read the groups over and over for the given number of cycles (0 is
+// forever), or until a byte is received on UART_DEBUG (it is discarded).
+// kwp_stream_samples counts the responses for each group.  A group the
+// module NAKs is skipped.
+kwp_result_t kwp_stream_groups(const uint8_t *groups, uint8_t count, uint16_t cycles)
+{
+    if ((count == 0) || (count > KWP_STREAM_MAX_GROUPS)) { return KWP_UNEXPECTED; }
+
+    kwp_stream_count = count;
+    memcpy(kwp_stream_list, groups, count);
+    memset(kwp_stream_samples, 0, sizeof(kwp_stream_samples));
+    uint32_t start = timer_now();
+    kwp_result_t result = KWP_SUCCESS;
+
+    for (uint16_t cycle=0; (cycles == 0) || (cycle < cycles); cycle++) {
+        for (uint8_t i=0; i<count; i++) {
+            result = _stream_group(groups[i]);
+            if (result == KWP_SUCCESS) {
+                kwp_stream_samples[i]++;
+            } else if (result != KWP_NAK_RECEIVED) {
+                goto done;
+            }
+        }
+
+        if (uart_rx_ready(UART_DEBUG)) {
+            uart_blocking_get(UART_DEBUG);
+            break;
+        }
+    }
+    result = KWP_SUCCESS;
+
+done:
+    kwp_stream_elapsed_ms = (timer_now() - start) / TIMER_TICKS_PER_MS;
+    return result;
+}
+
+
 int _send_read_mem_block(uint8_t title, uint16_t address, uint8_t length)
 {
-    uart_puts(UART_DEBUG, "PERFORM READ xx MEMORY\n");
+    LOG_TEXT(LOG_LEVEL_DEBUG, "PERFORM READ xx MEMORY");
     uint8_t block[] = {
         0x06,           // block length
         0,              // placeholder for block counter
@@ -346,69 +823,282 @@ int _send_read_mem_block(uint8_t title, uint16_t address, uint8_t length)
 }
 
 
-static kwp_result_t _read_mem(uint8_t req_title, uint8_t resp_title,
-                              uint16_t start_address, uint16_t total_size, uint8_t chunk_size)
+// Send a read memory request and receive the reply.  On success, the
+// memory is in kwp_rx_buf starting at index 3.
+static kwp_result_t _request_mem(uint8_t req_title, uint8_t resp_title,
+                                 uint16_t address, uint8_t length)
 {
-    uint16_t address = start_address;
+    kwp_result_t result = _send_read_mem_block(req_title, address, length);
+    if (result != KWP_SUCCESS) { return result; }
+
+    result = kwp_receive_block();
+    if (result != KWP_SUCCESS) { return result; }
+    if (kwp_rx_buf[2] == KWP_NAK) { return KWP_NAK_RECEIVED; }
+    if (kwp_rx_buf[2] != resp_title) { return KWP_UNEXPECTED; }
+
+    uint8_t datalen = kwp_rx_buf[0] - 3;  // block length - (counter + title + end)
+    if (datalen < length) { return KWP_MEM_TOO_SHORT; }
+    if (datalen > length) { return KWP_MEM_TOO_LONG; }
+    return KWP_SUCCESS;
+}
+
+
+// Acknowledge a memory reply and receive the module's acknowledge
+static kwp_result_t _ack_mem()
+{
+    kwp_result_t result = kwp_send_ack_block();
+    if (result != KWP_SUCCESS) { return result; }
+    return kwp_receive_block_expect(KWP_ACK);
+}
+
+
+static uint8_t _mem_resp_title(uint8_t req_title)
+{
+    return (req_title == KWP_READ_RAM) ? KWP_R_READ_RAM : KWP_R_READ_ROM_EEPROM;
+}
+
+
+// Chunk sizes found by kwp_probe_chunk_size() for this session, one for
+// each read memory title: KWP_READ_RAM, KWP_READ_ROM_EEPROM, KWP_READ_EEPROM
+static uint8_t _chunk_sizes[3];
+
+// Largest write EEPROM block the module has accepted this session
+static uint8_t _write_size;
+
+static uint8_t *_chunk_size_for(uint8_t req_title)
+{
+    switch (req_title) {
+        case KWP_READ_RAM:          return &_chunk_sizes[0];
+        case KWP_READ_ROM_EEPROM:   return &_chunk_sizes[1];
+        default:                    return &_chunk_sizes[2];
+    }
+}
+
+
+// Find the largest chunk the module will return for a read memory title.
+// The maximum is tried first, then a binary search is done.  A length is
+// too big if the module NAKs it or returns a different length.  Each probe
+// reads from address, so it should be a valid address for the memory.
+kwp_result_t kwp_probe_chunk_size(uint8_t req_title, uint16_t address, uint8_t *chunk_size_out)
+{
+    uint8_t resp_title = _mem_resp_title(req_title);
+    kwp_result_t result = KWP_SUCCESS;
+    kwp_result_t rejected = KWP_MEM_TOO_SHORT;
+
+    uint8_t good = 0;                           // largest length that worked
+    uint16_t bad = KWP_MAX_CHUNK_SIZE + 1;      // smallest length that failed
+    uint8_t length = KWP_MAX_CHUNK_SIZE;
+
+    while ((bad - good) > 1) {
+        result = _request_mem(req_title, resp_title, address, length);
+        switch (result) {
+            case KWP_SUCCESS:
+                good = length;
+                break;
+            case KWP_MEM_TOO_SHORT:
+            case KWP_MEM_TOO_LONG:
+            case KWP_NAK_RECEIVED:
+                rejected = result;
+                bad = length;
+                break;
+            default:
+                return result;
+        }
+
+        // a nak ends the exchange; a memory reply must be acknowledged
+        if (result != KWP_NAK_RECEIVED) {
+            result = _ack_mem();
+            if (result != KWP_SUCCESS) { return result; }
+        }
+
+        length = (good + bad) / 2;
+    }
+
+    if (good == 0) { return rejected; }
+
+    LOG(LOG_LEVEL_INFO, LOG_EV_CHUNK_SIZE, &good, 1);
+
+    *_chunk_size_for(req_title) = good;
+    *chunk_size_out = good;
+    return KWP_SUCCESS;
+}
+
+
+// Read memory in chunks.  If chunk_size is KWP_CHUNK_AUTO, the largest chunk
+// size is probed on the first read of this type in the session and reused
+// after that.  The memory is sent to UART_DEBUG as "MEM:" lines, or as
+// binary frames if kwp_binary_dump is set.
+static kwp_result_t _read_mem_chunks(uint8_t req_title, uint16_t *address,
+                                     uint16_t total_size, uint8_t chunk_size)
+{
+    uint8_t resp_title = _mem_resp_title(req_title);
     uint16_t remaining = total_size;
+    kwp_result_t result;
+
+    if (chunk_size == KWP_CHUNK_AUTO) {
+        chunk_size = *_chunk_size_for(req_title);
+        if (chunk_size == 0) {
+            result = kwp_probe_chunk_size(req_title, *address, &chunk_size);
+            if (result != KWP_SUCCESS) { return result; }
+        }
+    }
 
     while (remaining != 0) {
         if (remaining < chunk_size) { chunk_size = remaining; }
 
-        kwp_result_t result = _send_read_mem_block(req_title, address, chunk_size);
-        if (result != KWP_SUCCESS) { return result; }
-
-        result = kwp_receive_block_expect(resp_title);
+        result = _request_mem(req_title, resp_title, *address, chunk_size);
         if (result != KWP_SUCCESS) { return result; }
 
         uint8_t datalen = kwp_rx_buf[0] - 3;  // block length - (counter + title + end)
-        if (datalen < chunk_size) { return KWP_MEM_TOO_SHORT; }
-        if (datalen > chunk_size) { return KWP_MEM_TOO_LONG; }
-
-        uart_puts(UART_DEBUG, "MEM: ");
-        uart_puthex16(UART_DEBUG, address);
-        uart_puts(UART_DEBUG, ": ");
-        for (uint8_t i=0; i<datalen; i++) {
-            uart_puthex(UART_DEBUG, kwp_rx_buf[3 + i]);
-            uart_put(UART_DEBUG, ' ');
+        if (kwp_binary_dump) {
+            dump_data(*address, &kwp_rx_buf[3], datalen);
+        } else {
+            uart_puts(UART_DEBUG, "MEM: ");
+            uart_puthex16(UART_DEBUG, *address);
+            uart_puts(UART_DEBUG, ": ");
+            for (uint8_t i=0; i<datalen; i++) {
+                uart_puthex(UART_DEBUG, kwp_rx_buf[3 + i]);
+                uart_put(UART_DEBUG, ' ');
+            }
+            uart_puts(UART_DEBUG, "\n");
         }
-        uart_puts(UART_DEBUG, "\n");
 
-        address += chunk_size;
+        *address += chunk_size;
         remaining -= chunk_size;
 
-        result = kwp_send_ack_block();
-        if (result != KWP_SUCCESS) { return result; }
-
-        kwp_receive_block_expect(KWP_ACK);
+        result = _ack_mem();
         if (result != KWP_SUCCESS) { return result; }
     }
     return KWP_SUCCESS;
 }
 
+// Read one chunk of memory into buf.  Unlike the functions below, nothing
+// is sent to UART_DEBUG except the transcript.
+kwp_result_t kwp_read_mem_chunk(uint8_t req_title, uint16_t address,
+                                uint8_t length, uint8_t *buf)
+{
+    if ((length == 0) || (length > KWP_MAX_CHUNK_SIZE)) { return KWP_MEM_TOO_LONG; }
+
+    kwp_result_t result = _request_mem(req_title, _mem_resp_title(req_title),
+                                       address, length);
+    if (result != KWP_SUCCESS) { return result; }
+
+    memcpy(buf, &kwp_rx_buf[3], length);  // the ack below reuses kwp_rx_buf
+    return _ack_mem();
+}
+
+static kwp_result_t _read_mem(uint8_t req_title, uint16_t start_address,
+                              uint16_t total_size, uint8_t chunk_size)
+{
+    uint16_t address = start_address;
+    if (kwp_binary_dump) { dump_start(req_title, start_address, total_size); }
+    kwp_result_t result = _read_mem_chunks(req_title, &address, total_size, chunk_size);
+    if (kwp_binary_dump) { dump_end(address, result, 0, 0); }
+    return result;
+}
+
+
+// Reconnect to the module and log in again after an error.  Address
+// KWP_RADIO_MFG logs in with kwp_p5_login_mfg(), any other address with
+// kwp_login_safe().
+static kwp_result_t _reconnect(uint8_t module_address, uint16_t safe_code)
+{
+    kwp_dump_reconnects++;
+    LOG_TEXT(LOG_LEVEL_INFO, "RECONNECT");
+
+    kwp_disconnect();
+    kwp_result_t result = kwp_autoconnect(module_address);
+    if (result != KWP_SUCCESS) { return result; }
+
+    if (module_address == KWP_RADIO_MFG) {
+        return kwp_p5_login_mfg();
+    }
+    return kwp_login_safe(safe_code);
+}
+
+
+// Read memory like _read_mem(), but recover from errors.  The address after
+// the last chunk received is kept as a checkpoint.  After an error, the
+// session is reconnected and logged in again, and the read continues from
+// the checkpoint.  Gives up after KWP_DUMP_MAX_RETRIES consecutive failures
+// at the same address.  kwp_dump_retries and kwp_dump_reconnects count the
+// recoveries.
+kwp_result_t kwp_read_mem_resumable(uint8_t module_address, uint16_t safe_code,
+                                    uint8_t req_title, uint16_t start_address,
+                                    uint16_t total_size, uint8_t chunk_size)
+{
+    uint16_t address = start_address;   // checkpoint: next address to read
+    uint16_t failed_address = start_address;
+    uint8_t failures = 0;
+    kwp_result_t result = KWP_SUCCESS;
+
+    kwp_dump_retries = 0;
+    kwp_dump_reconnects = 0;
+    if (kwp_binary_dump) { dump_start(req_title, start_address, total_size); }
+
+    // probe once up front; reconnecting forgets the probed size
+    if (chunk_size == KWP_CHUNK_AUTO) {
+        chunk_size = *_chunk_size_for(req_title);
+        if (chunk_size == 0) {
+            result = kwp_probe_chunk_size(req_title, start_address, &chunk_size);
+        }
+    }
+
+    while (1) {
+        uint16_t remaining = total_size - (address - start_address);
+        if (result == KWP_SUCCESS) {    // session is usable
+            result = _read_mem_chunks(req_title, &address, remaining, chunk_size);
+            if (result == KWP_SUCCESS) { break; }
+        }
+
+        if (address != failed_address) {    // progress since last failure
+            failed_address = address;
+            failures = 0;
+        }
+        if (++failures > KWP_DUMP_MAX_RETRIES) { break; }
+
+        uint8_t args[] = { HIGH(address), LOW(address), result };
+        LOG(LOG_LEVEL_WARN, LOG_EV_DUMP_ERROR, args, sizeof(args));
+
+        kwp_dump_retries++;
+        result = _reconnect(module_address, safe_code);
+        if ((result == KWP_SUCCESS) && (chunk_size == KWP_CHUNK_AUTO)) {
+            result = kwp_probe_chunk_size(req_title, address, &chunk_size);
+        }
+    }
+
+    if (kwp_binary_dump) {
+        dump_end(address, result, kwp_dump_retries, kwp_dump_reconnects);
+    } else {
+        uart_puts(UART_DEBUG, "RETRIES: ");
+        uart_puthex16(UART_DEBUG, kwp_dump_retries);
+        uart_puts(UART_DEBUG, " RECONNECTS: ");
+        uart_puthex16(UART_DEBUG, kwp_dump_reconnects);
+        uart_puts(UART_DEBUG, "\n");
+    }
+    return result;
+}
+
 kwp_result_t kwp_read_ram(uint16_t start_address, uint16_t total_size, uint8_t chunk_size)
 {
-    return _read_mem(KWP_READ_RAM, KWP_R_READ_RAM,
-                     start_address, total_size, chunk_size);
+    return _read_mem(KWP_READ_RAM, start_address, total_size, chunk_size);
 }
 
 kwp_result_t kwp_read_rom_or_eeprom(uint16_t start_address, uint16_t total_size, uint8_t chunk_size)
 {
-    return _read_mem(KWP_READ_ROM_EEPROM, KWP_R_READ_ROM_EEPROM,
-                     start_address, total_size, chunk_size);
+    return _read_mem(KWP_READ_ROM_EEPROM, start_address, total_size, chunk_size);
 }
 
 kwp_result_t kwp_read_eeprom(uint16_t start_address, uint16_t total_size, uint8_t chunk_size)
 {
-    return _read_mem(KWP_READ_EEPROM, KWP_R_READ_ROM_EEPROM,
-                     start_address, total_size, chunk_size);
+    return _read_mem(KWP_READ_EEPROM, start_address, total_size, chunk_size);
 }
 
 // Premium 4 only ===========================================================
 
 static kwp_result_t _send_f0_block()
 {
-    uart_puts(UART_DEBUG, "PERFORM TITLE F0\n");
+    LOG_TEXT(LOG_LEVEL_DEBUG, "PERFORM TITLE F0");
     uint8_t block[] = {
         0x04,           // block length
         0,              // placeholder for block length
@@ -431,6 +1121,143 @@ kwp_result_t kwp_p4_read_safe_code_bcd(uint16_t *safe_code)
     return KWP_SUCCESS;
 }
 
+// Premium 5 only ===========================================================
+
+// Send a write EEPROM request and receive the reply, which echoes the
+// count, the address, and the first byte written.  The reply is not
+// acknowledged; the next request can follow it directly.
+static kwp_result_t _write_eeprom_block(uint16_t address, uint8_t length,
+                                        const uint8_t *data)
+{
+    LOG_TEXT(LOG_LEVEL_DEBUG, "PERFORM WRITE EEPROM");
+    uint8_t block[KWP_MAX_WRITE_SIZE + 7];
+    block[0] = length + 6;          // block length
+    block[1] = 0;                   // placeholder for block counter
+    block[2] = KWP_WRITE_EEPROM;    // block title
+    block[3] = length;              // number of bytes to write
+    block[4] = HIGH(address);       // address high
+    block[5] = LOW(address);        // address low
+    memcpy(&block[6], data, length);
+    block[length + 6] = 0;          // placeholder for block end
+
+    kwp_result_t result = kwp_send_block(block);
+    if (result != KWP_SUCCESS) { return result; }
+    kwp_eeprom_blocks++;
+
+    result = kwp_receive_block();
+    if (result != KWP_SUCCESS) { return result; }
+    if (kwp_rx_buf[2] == KWP_NAK) { return KWP_NAK_RECEIVED; }
+    if (kwp_rx_buf[2] != KWP_R_WRITE_EEPROM) { return KWP_UNEXPECTED; }
+
+    if ((kwp_rx_buf[0] != 0x07) ||
+        (kwp_rx_buf[3] != length) ||
+        (kwp_rx_buf[4] != HIGH(address)) ||
+        (kwp_rx_buf[5] != LOW(address)) ||
+        (kwp_rx_buf[6] != data[0])) { return KWP_UNEXPECTED; }
+
+    kwp_eeprom_written += length;
+    return KWP_SUCCESS;
+}
+
+// Write a run of bytes in blocks of _write_size.  A block that is
+// NAKed is sent again at half the size, and the smaller size is kept for
+// the rest of the session.
+static kwp_result_t _write_eeprom_run(uint16_t address, uint8_t length,
+                                      const uint8_t *data)
+{
+    uint8_t args[] = { HIGH(address), LOW(address), length };
+    LOG(LOG_LEVEL_INFO, LOG_EV_WRITE, args, sizeof(args));
+
+    while (length != 0) {
+        uint8_t size = (length < _write_size) ? length : _write_size;
+        kwp_result_t result = _write_eeprom_block(address, size, data);
+        if ((result == KWP_NAK_RECEIVED) && (size > 1)) {
+            _write_size = size / 2;
+            continue;
+        }
+        if (result != KWP_SUCCESS) { return result; }
+
+        address += size;
+        data += size;
+        length -= size;
+    }
+    return KWP_SUCCESS;
+}
+
+// Program the EEPROM (24C04) with image, which holds total_size bytes
+// starting at start_address.  The EEPROM is read one chunk at a time.
+// Only the runs of bytes that differ from the image are written, then
+// the chunk is read again to verify it.  Runs separated by fewer than
+// KWP_WRITE_MERGE_GAP unchanged bytes are written as one block, since
+// rewriting a few bytes costs less than another block exchange.
+// kwp_eeprom_written and kwp_eeprom_blocks count the writes.  Requires
+// kwp_login_safe() at address 0x56, or kwp_p5_login_mfg() at 0x7c.
+kwp_result_t kwp_p5_write_eeprom(uint16_t start_address, uint16_t total_size,
+                                 const uint8_t *image)
+{
+    uint8_t current[KWP_MAX_CHUNK_SIZE];
+    kwp_result_t result;
+
+    kwp_eeprom_written = 0;
+    kwp_eeprom_blocks = 0;
+    if (((uint32_t)start_address + total_size) > KWP_P5_EEPROM_SIZE) {
+        return KWP_MEM_TOO_LONG;
+    }
+
+    uint8_t chunk_size = *_chunk_size_for(KWP_READ_ROM_EEPROM);
+    if (chunk_size == 0) {
+        result = kwp_probe_chunk_size(KWP_READ_ROM_EEPROM, start_address, &chunk_size);
+        if (result != KWP_SUCCESS) { return result; }
+    }
+
+    uint16_t offset = 0;
+    while (offset < total_size) {
+        uint16_t address = start_address + offset;
+        uint8_t size = chunk_size;
+        if ((total_size - offset) < size) { size = total_size - offset; }
+        const uint8_t *want = &image[offset];
+
+        result = kwp_read_mem_chunk(KWP_READ_ROM_EEPROM, address, size, current);
+        if (result != KWP_SUCCESS) { return result; }
+
+        uint8_t dirty = 0;
+        uint8_t i = 0;
+        while (i < size) {
+            if (current[i] == want[i]) { i++; continue; }
+
+            // extend the run over differences and short gaps
+            uint8_t start = i;
+            uint8_t end = i + 1;    // one past the last byte to write
+            for (uint8_t j = end; j < size; j++) {
+                if (current[j] == want[j]) { continue; }
+                if ((j - end) >= KWP_WRITE_MERGE_GAP) { break; }
+                end = j + 1;
+            }
+
+            result = _write_eeprom_run(address + start, end - start, &want[start]);
+            if (result != KWP_SUCCESS) { return result; }
+            dirty = 1;
+            i = end;
+        }
+
+        if (dirty) {
+            result = kwp_read_mem_chunk(KWP_READ_ROM_EEPROM, address, size, current);
+            if (result != KWP_SUCCESS) { return result; }
+
+            for (i = 0; i < size; i++) {
+                if (current[i] == want[i]) { continue; }
+                uint16_t bad_address = address + i;
+                uint8_t args[] = { HIGH(bad_address), LOW(bad_address), want[i], current[i] };
+                LOG(LOG_LEVEL_ERROR, LOG_EV_VERIFY_ERROR, args, sizeof(args));
+                return KWP_VERIFY_FAILED;
+            }
+        }
+
+        offset += size;
+    }
+    return KWP_SUCCESS;
+}
+
 // Premium 5 mfg mode (address 0x7c) only ===================================
 
 kwp_result_t kwp_p5_login_mfg()
@@ -456,7 +1283,7 @@ kwp_result_t kwp_p5_read_safe_code_bcd(uint16_t *safe_code)
 
 static kwp_result_t _send_calc_rom_checksum_block()
 {
-    uart_puts(UART_DEBUG, "PERFORM ROM CHECKSUM\n");
+    LOG_TEXT(LOG_LEVEL_DEBUG, "PERFORM ROM CHECKSUM");
     uint8_t block[] = {
         0x05,       // block length
         0,          // placeholder for block counter
@@ -484,26 +1311,24 @@ kwp_result_t kwp_p5_calc_rom_checksum(uint16_t *rom_checksum)
 
 kwp_result_t kwp_connect(uint8_t address, uint32_t baud)
 {
-    uart_puts(UART_DEBUG, "\nCONNECT ");
-    uart_puthex(UART_DEBUG, address);
-    uart_puts(UART_DEBUG, ": ");
-
-    uart_init(UART_KLINE, baud);
-
     // Initialize connection state
     kwp_is_first_block = 1;
+    kwp_keepalive_count = 0;
+    kwp_keepalive_rtt = 0;
+    kwp_keepalive_rtt_max = 0;
+    memset(_chunk_sizes, 0, sizeof(_chunk_sizes));
+    _write_size = KWP_MAX_WRITE_SIZE;
     memset(kwp_vag_number,  0, sizeof(kwp_vag_number));
     memset(kwp_component_1, 0, sizeof(kwp_component_1));
     memset(kwp_component_2, 0, sizeof(kwp_component_2));
 
     // Send address at 5 baud and perform initial handshake
-    _send_address(address);
-    kwp_result_t result = _wait_for_55_01_8a();
+    kwp_result_t result = kwp_submit_connect(address, baud);
     if (result != KWP_SUCCESS) { return result; }
-    _delay_ms(30);
-    result = _send_byte(0x75);
+    result = kwp_complete();
+    uint8_t args[] = { address, kwp_baud >> 24, kwp_baud >> 16, kwp_baud >> 8, kwp_baud };
+    LOG(LOG_LEVEL_INFO, LOG_EV_CONNECT, args, sizeof(args));
     if (result != KWP_SUCCESS) { return result; }
-    uart_put(UART_DEBUG, '\n');
 
     // Receive 0xF6 ASCII/data blocks until we have control of the connection
     // Most modules will send 4 ASCII/data blocks: 3 with component info, 1 with workshop/coding
@@ -513,7 +1338,11 @@ kwp_result_t kwp_connect(uint8_t address, uint32_t baud)
         result = kwp_receive_block();
         if (result != KWP_SUCCESS) { return result; }
 
-        if (kwp_rx_buf[2] == KWP_ACK) { return KWP_SUCCESS; }
+        if (kwp_rx_buf[2] == KWP_ACK) {
+            _session_start = timer_now();
+            _session_open = 1;  // start keep-alives
+            return KWP_SUCCESS;
+        }
         if (kwp_rx_buf[2] != KWP_R_ASCII_DATA) { return KWP_UNEXPECTED; }
 
         switch (ascii_blocks++) {
@@ -536,27 +1365,121 @@ kwp_result_t kwp_connect(uint8_t address, uint32_t baud)
 
 kwp_result_t kwp_autoconnect(uint8_t address)
 {
-    const uint16_t baud_rates[2] = { 9600, 10400 };
+    // measure the rate from the sync byte, then fall back to trying the
+    // usual rates in case the measurement fails
+    const uint16_t baud_rates[4] = { KWP_BAUD_AUTO, KWP_BAUD_AUTO, 9600, 10400 };
 
-    for (uint8_t try=0; try<2; try++) {
-        for (uint8_t baud_index=0; baud_index<2; baud_index++) {
-            kwp_result_t result = kwp_connect(address, baud_rates[baud_index]);
-            if (result == KWP_SUCCESS) { return result; }
+    for (uint8_t baud_index=0; baud_index<4; baud_index++) {
+        kwp_result_t result = kwp_connect(address, baud_rates[baud_index]);
+        if (result == KWP_SUCCESS) { return result; }
 
-            const char *msg = kwp_describe_result(result);
-            uart_puts(UART_DEBUG, (char *)msg);
-            _delay_ms(2000); // delay before next try
-        }
+        uint8_t args[] = { result };
+        LOG(LOG_LEVEL_WARN, LOG_EV_RESULT, args, sizeof(args));
+        timer_delay_ms(2000); // delay before next try
     }
     return KWP_TIMEOUT;
 }
 
 kwp_result_t kwp_disconnect()
 {
-    _delay_ms(5000);
+    // stop keep-alives so the module times out and ends the session
+    kwp_result_t result = _claim();
+    if (result != KWP_SUCCESS) { return result; }
+    _session_open = 0;
+
+    timer_delay_ms(5000);
     return KWP_SUCCESS;
 }
 
+// Set the idle time before a keep-alive is sent.  0 turns them off.
+void kwp_set_keepalive(uint16_t interval_ms)
+{
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        _keepalive_interval = TIMER_MS((uint32_t)interval_ms);
+        _keepalive_due = timer_now() + _keepalive_interval;
+    }
+}
+
+// Milliseconds since kwp_connect() succeeded, or 0 if the session
+// has been closed by an error or kwp_disconnect()
+uint32_t kwp_session_uptime_ms()
+{
+    uint32_t uptime = 0;
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        if (_session_open) { uptime = timer_now() - _session_start; }
+    }
+    return uptime / TIMER_TICKS_PER_MS;
+}
+
+// Print the session uptime and keep-alive round trips (in units of 100 us)
+void kwp_print_session()
+{
+    uint16_t count, rtt, rtt_max;
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        count = kwp_keepalive_count;
+        rtt = kwp_keepalive_rtt;
+        rtt_max = kwp_keepalive_rtt_max;
+    }
+    uint32_t uptime = kwp_session_uptime_ms();
+
+    uart_puts(UART_DEBUG, "Uptime:      ");
+    uart_puthex16(UART_DEBUG, uptime >> 16);
+    uart_puthex16(UART_DEBUG, uptime & 0xFFFF);
+    uart_puts(UART_DEBUG, " ms\nKeep-Alives: ");
+    uart_puthex16(UART_DEBUG, count);
+    uart_puts(UART_DEBUG, "\nRound Trip:  ");
+    uart_puthex16(UART_DEBUG, rtt);
+    uart_puts(UART_DEBUG, " (max ");
+    uart_puthex16(UART_DEBUG, rtt_max);
+    uart_puts(UART_DEBUG, ")\n");
+}
+
+// Print the samples of each group read by the last kwp_stream_groups()
+// and the rate achieved, in hundredths of a sample per second
+void kwp_print_stream()
+{
+    uint32_t elapsed = kwp_stream_elapsed_ms;
+    if (elapsed == 0) { elapsed = 1; }
+
+    uart_puts(UART_DEBUG, "Elapsed:     ");
+    uart_puthex16(UART_DEBUG, kwp_stream_elapsed_ms >> 16);
+    uart_puthex16(UART_DEBUG, kwp_stream_elapsed_ms & 0xFFFF);
+    uart_puts(UART_DEBUG, " ms\n");
+    for (uint8_t i=0; i<kwp_stream_count; i++) {
+        // samples * 100000 overflows past 42949 samples, so a long
+        // stream divides its time instead
+        uint32_t samples = kwp_stream_samples[i];
+        uint32_t rate;
+        if (samples <= 0xFFFFFFFFUL / 100000) {
+            rate = (samples * 100000UL) / elapsed;
+        } else {
+            uint32_t tenths = elapsed / 100;    // of a second
+            if (tenths == 0) { tenths = 1; }
+            rate = (samples * 1000UL) / tenths;
+        }
+        uart_puts(UART_DEBUG, "Group ");
+        uart_puthex(UART_DEBUG, kwp_stream_list[i]);
+        uart_puts(UART_DEBUG, ":    ");
+        uart_puthex16(UART_DEBUG, kwp_stream_samples[i]);
+        uart_puts(UART_DEBUG, " samples, rate ");
+        uart_puthex16(UART_DEBUG, rate >> 16);
+        uart_puthex16(UART_DEBUG, rate & 0xFFFF);
+        uart_puts(UART_DEBUG, "\n");
+    }
+}
+
+// Print the baud rate and the delays in use, in units of 100 us
+void kwp_print_timing()
+{
+    uart_puts(UART_DEBUG, "Baud:        ");
+    uart_puthex16(UART_DEBUG, kwp_baud);
+    uart_puts(UART_DEBUG, "\nTX Delay:    ");
+    uart_puthex16(UART_DEBUG, _tx_delay);
+    uart_puts(UART_DEBUG, "\nBlock Delay: ");
+    uart_puthex16(UART_DEBUG, _block_delay);
+    uart_puts(UART_DEBUG, _tune_blocks ? " (not tuned)\n" : " (tuned)\n");
+}
+
 void kwp_print_module_info()
 {
     uart_puts(UART_DEBUG, "VAG Number: \"");
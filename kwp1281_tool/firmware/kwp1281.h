@@ -17,38 +17,90 @@ typedef enum
     KWP_UNEXPECTED = 8,
     KWP_MEM_TOO_SHORT = 9,
     KWP_MEM_TOO_LONG = 10,
+    KWP_BUSY = 11,
+    KWP_NAK_RECEIVED = 12,
+    KWP_VERIFY_FAILED = 13,
 } kwp_result_t;
 
+kwp_result_t kwp_submit_connect(uint8_t address, uint32_t baud);
+kwp_result_t kwp_submit_send_block(uint8_t *buf);
+kwp_result_t kwp_submit_receive_block();
+kwp_result_t kwp_poll();
+kwp_result_t kwp_complete();
+void kwp_tick();
+
 kwp_result_t kwp_connect(uint8_t address, uint32_t baud);
 kwp_result_t kwp_autoconnect(uint8_t address);
 kwp_result_t kwp_send_group_reading_block(uint8_t group);
+kwp_result_t kwp_stream_groups(const uint8_t *groups, uint8_t count, uint16_t cycles);
 kwp_result_t kwp_send_login_block(uint16_t safe_code, uint8_t fern, uint16_t workshop);
 kwp_result_t kwp_send_ack_block();
 kwp_result_t kwp_send_block(uint8_t *buf);
 kwp_result_t kwp_receive_block();
 kwp_result_t kwp_receive_block_expect(uint8_t title);
+kwp_result_t kwp_probe_chunk_size(uint8_t req_title, uint16_t address, uint8_t *chunk_size_out);
+kwp_result_t kwp_read_mem_chunk(uint8_t req_title, uint16_t address, uint8_t length, uint8_t *buf);
 kwp_result_t kwp_read_ram(uint16_t start_address, uint16_t total_size, uint8_t chunk_size);
 kwp_result_t kwp_read_rom_or_eeprom(uint16_t start_address, uint16_t total_size, uint8_t chunk_size);
 kwp_result_t kwp_read_eeprom(uint16_t start_address, uint16_t total_size, uint8_t chunk_size);
+kwp_result_t kwp_read_mem_resumable(uint8_t module_address, uint16_t safe_code,
+                                    uint8_t req_title, uint16_t start_address,
+                                    uint16_t total_size, uint8_t chunk_size);
 kwp_result_t kwp_login_safe(uint16_t safe_code);
 kwp_result_t kwp_p4_read_safe_code_bcd(uint16_t *safe_code);
+kwp_result_t kwp_p5_write_eeprom(uint16_t start_address, uint16_t total_size, const uint8_t *image);
 kwp_result_t kwp_p5_login_mfg();
 kwp_result_t kwp_p5_read_safe_code_bcd(uint16_t *safe_code);
 kwp_result_t kwp_p5_calc_rom_checksum(uint16_t *rom_checksum);
 kwp_result_t kwp_disconnect();
 void kwp_print_module_info();
+void kwp_print_stream();
+void kwp_print_timing();
+void kwp_set_keepalive(uint16_t interval_ms);
+uint32_t kwp_session_uptime_ms();
+void kwp_print_session();
 const char * kwp_describe_result(kwp_result_t result);
 void kwp_panic_if_error(kwp_result_t result);
 
+uint32_t kwp_baud;              // baud rate of the session; measured if KWP_BAUD_AUTO
 uint8_t kwp_is_first_block;     // flag: 0=no blocks received, 1=otherwise
 uint8_t kwp_block_counter;      // block counter; valid after first rx block
 uint8_t kwp_rx_buf[256];        // all bytes received for the current block
 uint8_t kwp_rx_size;            // number of bytes used in kwp_rx_buf
 
+uint8_t kwp_binary_dump;        // flag: 1=send memory as binary frames
+
+uint16_t kwp_dump_retries;      // chunks read again by kwp_read_mem_resumable()
+uint16_t kwp_dump_reconnects;   // reconnects done by kwp_read_mem_resumable()
+
+uint16_t kwp_eeprom_written;    // bytes written by kwp_p5_write_eeprom()
+uint16_t kwp_eeprom_blocks;     // write blocks sent by kwp_p5_write_eeprom()
+
+uint16_t kwp_keepalive_count;   // keep-alives exchanged this session
+uint16_t kwp_keepalive_rtt;     // round trip of last keep-alive, 100 us ticks
+uint16_t kwp_keepalive_rtt_max; // slowest keep-alive round trip this session
+
+#define KWP_STREAM_MAX_GROUPS 8
+uint8_t kwp_stream_count;       // number of groups read by kwp_stream_groups()
+uint8_t kwp_stream_list[KWP_STREAM_MAX_GROUPS];     // group numbers
+uint16_t kwp_stream_samples[KWP_STREAM_MAX_GROUPS]; // responses for each group
+uint32_t kwp_stream_elapsed_ms; // duration of the last stream
+
 uint8_t kwp_vag_number[16];     // "1J0035180D  "
 uint8_t kwp_component_1[16];    // " RADIO 3CP  "
 uint8_t kwp_component_2[16];    // "        0001"
 
+// Baud rate for kwp_connect(): time the module's 0x55 sync byte
+#define KWP_BAUD_AUTO       0
+
+// Memory read chunk sizes
+#define KWP_CHUNK_AUTO      0     // probe once per session, then reuse
+#define KWP_MAX_CHUNK_SIZE  251   // block length 254; kwp_rx_size can't wrap
+#define KWP_DUMP_MAX_RETRIES 5    // consecutive failures before giving up
+#define KWP_MAX_WRITE_SIZE  248   // block length 254 with count and address
+#define KWP_WRITE_MERGE_GAP 8     // unchanged bytes rewritten to save a block
+#define KWP_P5_EEPROM_SIZE  0x200 // 24C04
+
 // Module Addresses
 #define KWP_RADIO       0x56
 #define KWP_RADIO_MFG   0x7C    // Delco Premium 5, TechniSat Gamma 5
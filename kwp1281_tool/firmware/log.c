@@ -0,0 +1,123 @@
+#include "main.h"
+#include "dump.h"
+#include "log.h"
+#include "timer.h"
+#include "uart.h"
+#include <stdint.h>
+#include <string.h>
+#include <util/atomic.h>
+
+/*************************************************************************
+ * Debug Log
+ *
+ * Each record in the ring is <length> <seq: 2> <level> <event> <tick: 4>
+ * <args>, where length is the number of args.  log_write() may be called from
+ * an interrupt; it never waits for the UART.
+ *************************************************************************/
+
+#define LOG_HEADER_SIZE     9   // length, seq, level, event, tick
+#define LOG_FRAME_OVERHEAD  8   // sync, type, address, length, crc
+
+static uint8_t _ring[LOG_RING_SIZE];
+static volatile uint16_t _read_index;
+static volatile uint16_t _write_index;
+static uint16_t _seq;           // sequence number of next record written
+
+static uint16_t _used()
+{
+    return (_write_index - _read_index) & (LOG_RING_SIZE - 1);
+}
+
+static void _ring_put(uint8_t c)
+{
+    _ring[_write_index] = c;
+    _write_index = (_write_index + 1) & (LOG_RING_SIZE - 1);
+}
+
+static uint8_t _ring_peek(uint16_t offset)
+{
+    return _ring[(_read_index + offset) & (LOG_RING_SIZE - 1)];
+}
+
+void log_init(uint8_t level)
+{
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        _read_index = 0;
+        _write_index = 0;
+    }
+    _seq = 0;
+    log_dropped = 0;
+    log_level = level;
+}
+
+// Queue a record.  Args past LOG_MAX_ARGS are cut off.
+void log_write(uint8_t level, uint8_t event, const uint8_t *args, uint8_t length)
+{
+    if (length > LOG_MAX_ARGS) { length = LOG_MAX_ARGS; }
+    uint32_t tick = timer_now();
+
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        uint16_t free = (LOG_RING_SIZE - 1) - _used();
+        if (free < (uint16_t)LOG_HEADER_SIZE + length) {
+            log_dropped++;      // the host sees a gap in the sequence
+        } else {
+            _ring_put(length);
+            _ring_put(HIGH(_seq));
+            _ring_put(LOW(_seq));
+            _ring_put(level);
+            _ring_put(event);
+            _ring_put(tick >> 24);
+            _ring_put(tick >> 16);
+            _ring_put(tick >> 8);
+            _ring_put(tick);
+            for (uint8_t i=0; i<length; i++) {
+                _ring_put(args[i]);
+            }
+        }
+        _seq++;
+    }
+}
+
+void log_text(uint8_t level, const char *str)
+{
+    log_write(level, LOG_EV_TEXT, (const uint8_t *)str, strlen(str));
+}
+
+// Send the oldest record if the UART can take all of it without
+// waiting.  Returns 1 if a record was sent.
+static uint8_t _send_one()
+{
+    uint8_t frame[LOG_MAX_ARGS + 6];
+    uint8_t length;
+    uint16_t seq;
+
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        if (_used() == 0) { return 0; }
+        length = _ring_peek(0) + (LOG_HEADER_SIZE - 3);
+        if (uart_tx_free(UART_DEBUG) < LOG_FRAME_OVERHEAD + length) { return 0; }
+
+        seq = (_ring_peek(1) << 8) | _ring_peek(2);
+        for (uint8_t i=0; i<length; i++) {
+            frame[i] = _ring_peek(3 + i);
+        }
+        _read_index = (_read_index + 3 + length) & (LOG_RING_SIZE - 1);
+    }
+
+    dump_log(seq, frame, length);
+    return 1;
+}
+
+// Send as many records as fit in the UART's transmit buffer.  Call this
+// only when no block is being exchanged.
+void log_drain()
+{
+    while (_send_one());
+}
+
+// Send all records, waiting for the UART as needed
+void log_flush()
+{
+    while (_used() != 0) {
+        if (!_send_one()) { timer_sleep(); }
+    }
+}
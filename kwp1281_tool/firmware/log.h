@@ -0,0 +1,61 @@
+#ifndef LOG_H
+#define LOG_H
+
+#include <stdint.h>
+
+// Debug log records are queued in a ring and sent later on UART_DEBUG as
+// DUMP_FRAME_LOG frames (see dump.h), only when the K-line is idle and
+// only as many as fit in the UART's transmit buffer.  host/kwplog.py
+// renders them as text.
+//
+// Frame data: <level> <event> <tick: 4> <args...>
+// The frame address is a sequence number; a gap means records were
+// dropped because the ring was full.
+
+// Levels
+#define LOG_LEVEL_OFF       0
+#define LOG_LEVEL_ERROR     1
+#define LOG_LEVEL_WARN      2
+#define LOG_LEVEL_INFO      3
+#define LOG_LEVEL_DEBUG     4
+
+// Records above this level are not compiled in
+#ifndef LOG_LEVEL_MAX
+#define LOG_LEVEL_MAX       LOG_LEVEL_DEBUG
+#endif
+
+// Events                                args
+#define LOG_EV_TEXT         0x00    /* ASCII text */
+#define LOG_EV_SEND         0x01    /* block sent */
+#define LOG_EV_RECV         0x02    /* block received */
+#define LOG_EV_CONNECT      0x03    /* <address> <baud: 4> */
+#define LOG_EV_UNEXPECTED   0x04    /* <expected title> <received title> */
+#define LOG_EV_CHUNK_SIZE   0x05    /* <chunk size> */
+#define LOG_EV_DUMP_ERROR   0x06    /* <address: 2> <kwp_result_t> */
+#define LOG_EV_RESULT       0x07    /* <kwp_result_t> */
+#define LOG_EV_KEEPALIVE    0x08    /* <round trip in 100 us ticks: 2> */
+#define LOG_EV_WRITE        0x09    /* <address: 2> <length> */
+#define LOG_EV_VERIFY_ERROR 0x0A    /* <address: 2> <written> <read back> */
+
+#define LOG_RING_SIZE       1024    // power of 2
+#define LOG_MAX_ARGS        240     // longer args are cut off so a frame fits
+                                    // in the 255 free bytes of the UART ring
+
+#define LOG(level, event, args, length) \
+    do { if (((level) <= LOG_LEVEL_MAX) && ((level) <= log_level)) \
+        { log_write((level), (event), (args), (length)); } } while (0)
+
+#define LOG_TEXT(level, str) \
+    do { if (((level) <= LOG_LEVEL_MAX) && ((level) <= log_level)) \
+        { log_text((level), (str)); } } while (0)
+
+uint8_t log_level;          // records above this level are discarded
+uint16_t log_dropped;       // records discarded because the ring was full
+
+void log_init(uint8_t level);
+void log_write(uint8_t level, uint8_t event, const uint8_t *args, uint8_t length);
+void log_text(uint8_t level, const char *str);
+void log_drain();
+void log_flush();
+
+#endif
@@ -1,7 +1,11 @@
 #include "main.h"
 #include "uart.h"
 #include "kwp1281.h"
+#include "log.h"
+#include "cmd.h"
 #include "crack.h"
+#include "sniff.h"
+#include "timer.h"
 #include <string.h>
 #include <stdint.h>
 #include <avr/interrupt.h>
@@ -11,23 +15,46 @@
 
 int main()
 {
-    uart_init(UART_DEBUG, 115200);  // debug messages
+    uart_init(UART_DEBUG, 115200);  // debug messages or host commands
     uart_init(UART_KLINE,  10400);  // obd-ii kwp1281
+    timer_init();                   // system tick for kwp1281 timing
+    cmd_init();
+    log_init(LOG_LEVEL_OFF);        // UART_DEBUG carries commands
     sei();
 
-    uart_puts(UART_DEBUG, "\n\nRESET\n");
-
-    kwp_result_t result = kwp_autoconnect(KWP_RADIO);
-    kwp_panic_if_error(result);
-    kwp_print_module_info();
-
+    // UART_DEBUG carries the command interface (host/kwpclient.py), so
+    // the transcript is turned off.  To run a fixed sequence instead,
+    // replace the loop below with e.g.:
+    //
+    // log_level = LOG_LEVEL_DEBUG;  // view with host/kwplog.py
+    // uart_puts(UART_DEBUG, "\n\nRESET\n");
+    // kwp_result_t result = kwp_autoconnect(KWP_RADIO);
+    // kwp_panic_if_error(result);
+    // kwp_print_module_info();
+    //
+    // kwp_binary_dump = 1;  // receive with host/dumpmem.py
     // result = kwp_login_safe(1866);
     // kwp_panic_if_error(result);
-    // result = kwp_read_ram(0, 0xffff, 32);
+    // result = kwp_read_ram(0, 0xffff, KWP_CHUNK_AUTO);
     // kwp_panic_if_error(result);
+    //
+    // result = kwp_login_safe(1866);
+    // kwp_panic_if_error(result);
+    // result = kwp_read_mem_resumable(KWP_RADIO, 1866, KWP_READ_RAM, 0, 0xffff, KWP_CHUNK_AUTO);
+    // kwp_panic_if_error(result);
+    //
+    // sniff_run(KWP_BAUD_AUTO);  // watch another tester; view with host/sniff.py
+    //
+    // crack();
+    // log_flush();
+    // kwp_print_timing();
 
-    crack();
-
-    uart_puts(UART_DEBUG, "\nDONE\n");
-    while(1);
+    while (1) {
+        uint8_t c;
+        if (uart_blocking_get_with_timeout(UART_DEBUG, CMD_TIMEOUT_MS, &c) == UART_READY) {
+            cmd_receive_byte(c);
+        } else {
+            cmd_init();  // forget a partial command so the client can resync
+        }
+    }
 }
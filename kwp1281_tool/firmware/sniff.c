@@ -0,0 +1,294 @@
+#include "main.h"
+#include "autobaud.h"
+#include "dump.h"
+#include "sniff.h"
+#include "timer.h"
+#include "uart.h"
+#include <stdint.h>
+#include <string.h>
+#include <avr/io.h>
+#include <util/atomic.h>
+
+/*************************************************************************
+ * K-Line Sniffer
+ *
+ * Each byte of a block except the block end is answered by its
+ * complement from the other side, so both directions can be followed
+ * on the one wire without knowing who is sending.  The first block
+ * after 0x55 0x01 0x8A 0x75 is from the module and the directions
+ * alternate after that; the host works out the direction from the
+ * block counter.  After an error, bytes are discarded until the line
+ * has been quiet for SNIFF_RESYNC_GAP_MS, which happens between blocks.
+ *************************************************************************/
+
+typedef enum {
+    SNIFF_STATE_AUTOBAUD = 0,   // timing a sync byte
+    SNIFF_STATE_SYNC = 1,       // waiting for 0x55 0x01 0x8A 0x75
+    SNIFF_STATE_BLOCK = 2,      // following blocks
+    SNIFF_STATE_RESYNC = 3,     // waiting for a gap after an error
+} sniff_state_t;
+
+#define SNIFF_HEADER_SIZE   11  // length, seq, kind, status, tick, duration
+#define SNIFF_MAX_BYTES     247 // frame length 255 - kind, status, tick, duration
+
+static const uint8_t _sync_bytes[4] = { 0x55, 0x01, 0x8A, 0x75 };
+
+static volatile sniff_state_t _state;
+static uint32_t _baud;              // KWP_BAUD_AUTO (0) to measure each session
+static uint8_t _sync_index;
+static uint32_t _last_tick;         // tick of the last byte received
+
+static uint8_t _block[256];
+static uint16_t _count;             // bytes of the block received so far
+static uint8_t _want_complement;    // flag: next byte is a complement
+static uint32_t _first_tick;        // tick of the block's first byte
+
+static uint8_t _ring[SNIFF_RING_SIZE];
+static volatile uint16_t _read_index;
+static volatile uint16_t _write_index;
+static uint16_t _seq;
+
+// Ring ======================================================================
+
+static uint16_t _used()
+{
+    return (_write_index - _read_index) & (SNIFF_RING_SIZE - 1);
+}
+
+static void _ring_put(uint8_t c)
+{
+    _ring[_write_index] = c;
+    _write_index = (_write_index + 1) & (SNIFF_RING_SIZE - 1);
+}
+
+static uint8_t _ring_peek(uint16_t offset)
+{
+    return _ring[(_read_index + offset) & (SNIFF_RING_SIZE - 1)];
+}
+
+// Queue a record.  Called from the timer interrupt.
+static void _emit(uint8_t kind, uint8_t status, uint32_t tick,
+                  uint32_t duration, const uint8_t *bytes, uint8_t length)
+{
+    if (length > SNIFF_MAX_BYTES) { length = SNIFF_MAX_BYTES; }
+    if (duration > 0xFFFF) { duration = 0xFFFF; }
+
+    uint16_t free = (SNIFF_RING_SIZE - 1) - _used();
+    if (free < (uint16_t)SNIFF_HEADER_SIZE + length) {
+        sniff_dropped++;
+    } else {
+        _ring_put(length);
+        _ring_put(HIGH(_seq));
+        _ring_put(LOW(_seq));
+        _ring_put(kind);
+        _ring_put(status);
+        _ring_put(tick >> 24);
+        _ring_put(tick >> 16);
+        _ring_put(tick >> 8);
+        _ring_put(tick);
+        _ring_put(HIGH(duration));
+        _ring_put(LOW(duration));
+        for (uint8_t i=0; i<length; i++) {
+            _ring_put(bytes[i]);
+        }
+    }
+    _seq++;
+}
+
+// Reassembly ================================================================
+
+static void _wait_for_session()
+{
+    _sync_index = 0;
+    if (_baud == 0) {
+        UCSR1B &= ~_BV(RXEN1);  // Disable RX (PD2/TXD1) while 0x55 is timed
+        autobaud_start();
+        _state = SNIFF_STATE_AUTOBAUD;
+    } else {
+        _state = SNIFF_STATE_SYNC;
+    }
+}
+
+static void _block_done(uint8_t status)
+{
+    uint8_t length = (_count > SNIFF_MAX_BYTES) ? SNIFF_MAX_BYTES : _count;
+    _emit(SNIFF_KIND_BLOCK, status, _first_tick, _last_tick - _first_tick,
+          _block, length);
+    if (status == SNIFF_OK) {
+        sniff_blocks++;
+        _state = SNIFF_STATE_BLOCK;
+    } else {
+        sniff_errors++;
+        _state = SNIFF_STATE_RESYNC;
+    }
+    _count = 0;
+    _want_complement = 0;
+}
+
+static void _end_session()
+{
+    if (_count != 0) { _block_done(SNIFF_TIMEOUT); }
+    _emit(SNIFF_KIND_END, SNIFF_OK, _last_tick, 0, NULL, 0);
+    _wait_for_session();
+}
+
+static void _rx_block_byte(uint8_t c, uint32_t tick)
+{
+    if (_count == 0) { _first_tick = tick; }
+
+    if (_want_complement) {
+        if (c != (_block[_count - 1] ^ 0xFF)) { _block_done(SNIFF_BAD_COMPLEMENT); return; }
+        _want_complement = 0;
+        return;
+    }
+
+    _block[_count++] = c;
+    if (_count == 1) {          // block length
+        if (c < 3) { _block_done(SNIFF_BAD_BLK_LENGTH); return; }
+        _want_complement = 1;
+    } else if (_count == (uint16_t)_block[0] + 1) {
+        _block_done((c == 0x03) ? SNIFF_OK : SNIFF_BAD_BLK_END);
+    } else {
+        _want_complement = 1;
+    }
+}
+
+static void _rx_sync_byte(uint8_t c, uint32_t tick)
+{
+    if (c == _sync_bytes[_sync_index]) {
+        if (++_sync_index == 4) {
+            uint32_t baud = _baud;
+            if (baud == 0) { baud = autobaud_baud(); }
+            uint8_t bytes[] = { baud >> 24, baud >> 16, baud >> 8, baud };
+            _emit(SNIFF_KIND_SYNC, SNIFF_OK, tick, 0, bytes, sizeof(bytes));
+            _count = 0;
+            _want_complement = 0;
+            _state = SNIFF_STATE_BLOCK;
+        }
+    } else if (_baud == 0) {
+        _wait_for_session();    // measured rate was probably wrong
+    } else {
+        _sync_index = (c == _sync_bytes[0]) ? 1 : 0;
+    }
+}
+
+// Step the sniffer.  Called from the timer interrupt on every tick.
+void sniff_tick()
+{
+    if (!sniff_running) { return; }
+    uint32_t now = timer_now();
+
+    if (_state == SNIFF_STATE_AUTOBAUD) {
+        if (!autobaud_done()) { return; }
+        uint32_t baud = autobaud_baud();
+        autobaud_stop();
+        if (baud == 0) { autobaud_start(); return; }
+        uart_init(UART_KLINE, baud);    // also enables RX
+        _sync_index = 1;                // 0x55 was timed, not received
+        _last_tick = now;
+        _state = SNIFF_STATE_SYNC;
+        return;
+    }
+
+    while (uart_rx_ready(UART_KLINE)) {
+        uint8_t c = uart_blocking_get(UART_KLINE);
+        uint32_t gap = now - _last_tick;
+        _last_tick = now;
+
+        switch (_state) {
+            case SNIFF_STATE_SYNC:
+                _rx_sync_byte(c, now);
+                break;
+            case SNIFF_STATE_RESYNC:
+                if (gap < TIMER_MS(SNIFF_RESYNC_GAP_MS)) { break; }
+                _state = SNIFF_STATE_BLOCK;
+                // fall through
+            case SNIFF_STATE_BLOCK:
+                _rx_block_byte(c, now);
+                break;
+            default:
+                break;
+        }
+    }
+
+    uint32_t silence = now - _last_tick;
+    if (silence < TIMER_MS(SNIFF_BYTE_TIMEOUT_MS)) { return; }
+    switch (_state) {
+        case SNIFF_STATE_BLOCK:
+        case SNIFF_STATE_RESYNC:
+            _end_session();
+            break;
+        case SNIFF_STATE_SYNC:
+            if (_baud == 0) { _wait_for_session(); }
+            _last_tick = now;
+            break;
+        default:
+            break;
+    }
+}
+
+// Start listening at baud, or KWP_BAUD_AUTO (0) to measure the sync
+// byte of each session.  The protocol engine must be idle.
+void sniff_start(uint32_t baud)
+{
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        _read_index = 0;
+        _write_index = 0;
+        _seq = 0;
+        sniff_blocks = 0;
+        sniff_errors = 0;
+        sniff_dropped = 0;
+        _baud = baud;
+        _count = 0;
+        _want_complement = 0;
+        _last_tick = timer_now();
+        if (baud != 0) { uart_init(UART_KLINE, baud); }
+        _wait_for_session();
+        sniff_running = 1;
+    }
+}
+
+void sniff_stop()
+{
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        sniff_running = 0;
+        autobaud_stop();
+    }
+}
+
+// Send all queued records
+void sniff_drain()
+{
+    uint8_t frame[SNIFF_MAX_BYTES + 8];
+
+    while (1) {
+        uint8_t length;
+        uint16_t seq;
+
+        ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+            if (_used() == 0) { return; }
+            length = _ring_peek(0) + (SNIFF_HEADER_SIZE - 3);
+            seq = (_ring_peek(1) << 8) | _ring_peek(2);
+            for (uint8_t i=0; i<length; i++) {
+                frame[i] = _ring_peek(3 + i);
+            }
+            _read_index = (_read_index + 3 + length) & (SNIFF_RING_SIZE - 1);
+        }
+
+        dump_sniff(seq, frame, length);
+    }
+}
+
+// Sniff until a byte is received on UART_DEBUG (it is discarded),
+// sending the records as they are queued
+void sniff_run(uint32_t baud)
+{
+    sniff_start(baud);
+    while (!uart_rx_ready(UART_DEBUG)) {
+        sniff_drain();
+        timer_sleep();
+    }
+    uart_blocking_get(UART_DEBUG);
+    sniff_stop();
+    sniff_drain();
+}
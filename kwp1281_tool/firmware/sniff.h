@@ -0,0 +1,43 @@
+#ifndef SNIFF_H
+#define SNIFF_H
+
+#include <stdint.h>
+
+// Passive K-line sniffer.  While it runs, the K-line is only received,
+// never driven.  Every byte is timestamped in the timer interrupt, the
+// echo/complement handshake is followed to find block boundaries, and
+// each block is queued as a record.  sniff_drain() sends the records to
+// UART_DEBUG as DUMP_FRAME_SNIFF frames (see dump.h).
+//
+// Frame data: <kind> <status> <tick: 4> <duration: 2> <bytes...>
+// The frame address is a sequence number; a gap means records were
+// dropped because the ring was full.
+
+// Record kinds
+#define SNIFF_KIND_SYNC     'S'     /* session started; bytes: <baud: 4> */
+#define SNIFF_KIND_BLOCK    'B'     /* bytes: the block without complements */
+#define SNIFF_KIND_END      'E'     /* session ended: no bytes for a timeout */
+
+// Record status
+#define SNIFF_OK                0
+#define SNIFF_BAD_COMPLEMENT    1   /* block cut off at the bad complement */
+#define SNIFF_BAD_BLK_END       2
+#define SNIFF_TIMEOUT           3   /* block cut off by the byte timeout */
+#define SNIFF_BAD_BLK_LENGTH    4   /* block length less than 3 */
+
+#define SNIFF_RING_SIZE         1024    // power of 2
+#define SNIFF_BYTE_TIMEOUT_MS   3000    // silence that ends a session
+#define SNIFF_RESYNC_GAP_MS     25      // silence that ends a block after an error
+
+void sniff_start(uint32_t baud);
+void sniff_stop();
+void sniff_tick();
+void sniff_drain();
+void sniff_run(uint32_t baud);
+
+uint8_t sniff_running;      // flag: sniff_tick() is receiving
+uint16_t sniff_blocks;      // blocks received without errors
+uint16_t sniff_errors;      // blocks cut off by an error
+uint16_t sniff_dropped;     // records discarded because the ring was full
+
+#endif
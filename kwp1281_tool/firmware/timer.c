@@ -0,0 +1,72 @@
+#include "main.h"
+#include "timer.h"
+#include "kwp1281.h"
+#include "sniff.h"
+#include <stdint.h>
+#include <avr/interrupt.h>
+#include <avr/io.h>
+#include <avr/sleep.h>
+#include <util/atomic.h>
+
+/*************************************************************************
+ * System Tick
+ *************************************************************************/
+
+static volatile uint32_t _ticks;
+
+// Start Timer3 as a free-running 10 kHz tick
+void timer_init()
+{
+    _ticks = 0;
+    TCCR3A = 0;
+    TCCR3B = _BV(WGM32) | _BV(CS31);            // CTC mode, prescaler 8
+    OCR3A = (F_CPU / 8 / TIMER_TICKS_PER_SEC) - 1;
+    TCNT3 = 0;
+    TIMSK3 = _BV(OCIE3A);                       // Enable compare A int
+    set_sleep_mode(SLEEP_MODE_IDLE);            // UARTs and timers keep running
+}
+
+// Number of ticks since timer_init(); wraps after about 5 days
+uint32_t timer_now()
+{
+    uint32_t ticks;
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        ticks = _ticks;
+    }
+    return ticks;
+}
+
+// Returns true if the deadline (in ticks) has been reached.  Safe across
+// wraparound as long as deadlines are less than half the range away.
+uint8_t timer_expired(uint32_t deadline)
+{
+    return (int32_t)(timer_now() - deadline) >= 0;
+}
+
+// Sleep until the next interrupt.  The tick guarantees a wakeup within
+// one tick even if nothing else happens.
+void timer_sleep()
+{
+    sleep_mode();
+}
+
+// Wait at least the given number of milliseconds
+void timer_delay_ms(uint16_t ms)
+{
+    uint32_t deadline = timer_now() + TIMER_MS(ms) + 1;
+    while (!timer_expired(deadline)) {
+        timer_sleep();
+    }
+}
+
+/*************************************************************************
+ * Timer Interrupt Service Routines
+ *************************************************************************/
+
+// Timer3 Compare A: one system tick
+ISR(TIMER3_COMPA_vect)
+{
+    _ticks++;
+    kwp_tick();
+    sniff_tick();
+}
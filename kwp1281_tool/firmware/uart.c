@@ -1,7 +1,8 @@
 #include "main.h"
 #include <stdint.h>
 #include <avr/interrupt.h>
-#include <util/delay.h>
+#include <avr/sleep.h>
+#include "timer.h"
 #include "uart.h"
 
 /*************************************************************************
@@ -32,6 +33,11 @@ static uint8_t _buf_has_byte(volatile uart_ringbuffer_t *buf)
     return buf->read_index != buf->write_index;
 }
 
+static uint8_t _buf_is_full(volatile uart_ringbuffer_t *buf)
+{
+    return (uint8_t)(buf->write_index + 1) == buf->read_index;
+}
+
 /*************************************************************************
  * UART
  *************************************************************************/
@@ -42,7 +48,8 @@ static uint16_t _baud_to_ubrr(uint32_t baud)
         case 115200:    return UART_UBRR_115200;
         case 10400:     return UART_UBRR_10400;
         case 9600:      return UART_UBRR_9600;
-        default:        while(1);
+        default:        // other rates, e.g. measured by autobaud.c
+            return ((F_CPU + (8 * baud)) / (16 * baud)) - 1;
     }
 }
 
@@ -77,6 +84,8 @@ void uart_init(uart_num_t uartnum, uint32_t baud)
 
 void uart_put(uart_num_t uartnum, uint8_t c)
 {
+    // wait for room instead of overwriting bytes not yet sent
+    while (_buf_is_full(&_tx_buffers[uartnum]));
     _buf_write_byte(&_tx_buffers[uartnum], c);
     // Enable UDRE interrupt
     switch (uartnum) {
@@ -86,6 +95,13 @@ void uart_put(uart_num_t uartnum, uint8_t c)
     }
 }
 
+// Number of bytes uart_put() can take without waiting
+uint8_t uart_tx_free(uart_num_t uartnum)
+{
+    volatile uart_ringbuffer_t *buf = &_tx_buffers[uartnum];
+    return (uint8_t)(buf->read_index - buf->write_index - 1);
+}
+
 void uart_put16(uart_num_t uartnum, uint16_t w)
 {
     uart_put(uartnum, w & 0x00FF);
@@ -145,28 +161,42 @@ uart_status_t uart_rx_ready(uart_num_t uartnum)
     }
 }
 
+// Sleep until an interrupt occurs, unless a byte has already been received.
+// The RX interrupt or the next timer tick (at most 100 us) wakes the CPU.
+static void _sleep_until_rx(uart_num_t uartnum)
+{
+    cli();
+    if (uart_rx_ready(uartnum) == UART_NOT_READY) {
+        sleep_enable();
+        sei();          // sei() takes effect after the next instruction, so
+        sleep_cpu();    // an interrupt can't be missed before sleeping
+        sleep_disable();
+    }
+    sei();
+}
+
 // Receive a byte; block until one is available
 uint8_t uart_blocking_get(uart_num_t uartnum)
 {
-    while (uart_rx_ready(uartnum) == UART_NOT_READY);
+    while (uart_rx_ready(uartnum) == UART_NOT_READY) {
+        _sleep_until_rx(uartnum);
+    }
     return _buf_read_byte(&_rx_buffers[uartnum]);
 }
 
 // Wrapper around uart_blocking_get() and uart_rx_ready() to provide a timeout
+// The deadline is measured by the timer tick, and the CPU sleeps until a
+// byte is received or the deadline passes.
 // Returns true if byte has been received into rx_byte_out
 uart_status_t uart_blocking_get_with_timeout(uart_num_t uartnum, uint16_t timeout_ms, uint8_t *rx_byte_out)
 {
-    uint16_t millis = 0;
-    uint8_t submillis = 0;
+    uint32_t deadline = timer_now() + TIMER_MS(timeout_ms);
     while (uart_rx_ready(uartnum) == UART_NOT_READY) {
-        _delay_us(50); // 50 us = 0.05 ms
-        if (++submillis == 20) {  // 1 ms
-            submillis = 0;
-            if (++millis == timeout_ms) { return 0; }  // timeout
-        }
+        if (timer_expired(deadline)) { return UART_NOT_READY; }  // timeout
+        _sleep_until_rx(uartnum);
     }
     *rx_byte_out = uart_blocking_get(uartnum);
-    return 1;  // success
+    return UART_READY;  // success
 }
 
 /*************************************************************************
@@ -28,6 +28,7 @@ typedef struct
 void uart_init(uart_num_t uartnum, uint32_t baud);
 void uart_flush_tx(uart_num_t uartnum);
 void uart_put(uart_num_t uartnum, uint8_t c);
+uint8_t uart_tx_free(uart_num_t uartnum);
 void uart_put16(uart_num_t uartnum, uint16_t w);
 void uart_puts(uart_num_t uartnum, char *str);
 void uart_puthex(uart_num_t uartnum, uint8_t c);
@@ -0,0 +1,138 @@
+#!/usr/bin/env python3 -u
+'''
+Receives binary memory dump frames from the KWP1281 tool (kwp_binary_dump
+set in the firmware) and assembles them into an image file.  Any text
+between frames, like debug messages, is passed through to stdout.
+
+Frame format (see firmware/dump.h):
+  A5 5A <type> <address hi> <address lo> <length> <data...> <crc hi> <crc lo>
+
+Usage: %s <output.bin>
+'''
+
+import binascii
+import sys
+import time
+import serial # pyserial
+
+SYNC = b'\xa5\x5a'
+
+FRAME_START = ord('S')
+FRAME_DATA = ord('D')
+FRAME_END = ord('E')
+
+KWP_SUCCESS = 0
+
+def make_serial():
+    from serial.tools.list_ports import comports
+    names = [ x.device for x in comports() if 'Bluetooth' not in x.device ]
+    if not names:
+        raise Exception("No serial port found")
+    return serial.Serial(port=names[0], baudrate=115200, timeout=None)
+
+def crc16_xmodem(data):
+    return binascii.crc_hqx(bytes(data), 0)
+
+def read_frame(ser, text_out):
+    '''Read bytes until a frame with a good CRC is received.  Returns
+    (type, address, data), or None if a frame had a bad CRC.'''
+    while True:
+        c = ser.read(1)
+        if c == SYNC[0:1]:
+            if ser.read(1) == SYNC[1:2]:
+                break
+        else:
+            text_out.write(c.decode('latin-1'))
+
+    header = bytearray(ser.read(4))
+    frame_type, length = header[0], header[3]
+    address = (header[1] << 8) + header[2]
+    data = bytearray(ser.read(length))
+    crc = bytearray(ser.read(2))
+    if crc16_xmodem(header + data) != ((crc[0] << 8) + crc[1]):
+        return None
+    return frame_type, address, data
+
+class Dump(object):
+    def __init__(self):
+        self.title = None
+        self.start_address = 0
+        self.image = bytearray()
+        self.received = []
+        self.bad_frames = 0
+        self.start_time = None
+        self.end_time = None
+        self.result = None
+        self.retries = 0
+        self.reconnects = 0
+
+    def start(self, address, data):
+        self.title = data[0]
+        self.start_address = address
+        total_size = (data[1] << 8) + data[2]
+        self.image = bytearray(b'\xff' * total_size)
+        self.received = [False] * total_size
+        self.start_time = time.time()
+
+    def add(self, address, data):
+        offset = address - self.start_address
+        for i, b in enumerate(data):
+            if 0 <= offset + i < len(self.image):
+                self.image[offset + i] = b
+                self.received[offset + i] = True
+
+    def end(self, data):
+        self.result = data[0]
+        if len(data) >= 5:
+            self.retries = (data[1] << 8) + data[2]
+            self.reconnects = (data[3] << 8) + data[4]
+        self.end_time = time.time()
+
+    @property
+    def num_received(self):
+        return sum(self.received)
+
+    def report(self):
+        elapsed = (self.end_time or time.time()) - (self.start_time or time.time())
+        rate = self.num_received / elapsed if elapsed > 0 else 0
+        lines = [
+            "Received %d of %d bytes in %0.1f s (%0.1f bytes/sec)" % (
+                self.num_received, len(self.image), elapsed, rate),
+            "Bad frames: %d" % self.bad_frames,
+            "Retries: %d, Reconnects: %d" % (self.retries, self.reconnects),
+            "Result: %s" % ("Success" if self.result == KWP_SUCCESS
+                            else "Error %r" % self.result),
+        ]
+        return '\n'.join(lines)
+
+def main():
+    if len(sys.argv) != 2:
+        sys.stderr.write((__doc__.strip() + '\n') % sys.argv[0])
+        sys.exit(1)
+    filename = sys.argv[1]
+
+    ser = make_serial()
+    dump = Dump()
+    try:
+        while dump.result is None:
+            frame = read_frame(ser, sys.stdout)
+            if frame is None:
+                dump.bad_frames += 1
+                continue
+            frame_type, address, data = frame
+            if frame_type == FRAME_START:
+                dump.start(address, data)
+            elif frame_type == FRAME_DATA:
+                dump.add(address, data)
+                sys.stderr.write("\r%04X (%d bytes)" % (address, dump.num_received))
+            elif frame_type == FRAME_END:
+                dump.end(data)
+    except KeyboardInterrupt:
+        pass
+
+    with open(filename, 'wb') as f:
+        f.write(dump.image)
+    sys.stderr.write("\n%s\n" % dump.report())
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,55 @@
+#!/usr/bin/env python3 -u
+'''
+Streams measuring group readings from a module through the KWP1281 tool's
+command interface (see kwpclient.py) until Ctrl-C, then prints the sample
+rate achieved for each group.
+
+Usage: %s [-a address] [-s safe code] <group> [group...]
+  address     module address in hex (default 56)
+  safe code   log in first with this SAFE code (decimal)
+  group       measuring group number in hex (up to 8)
+'''
+
+import signal
+import sys
+from kwpclient import KWP_RADIO, KWP_STREAM_MAX_GROUPS, make_client
+
+def usage():
+    sys.stderr.write((__doc__.strip() + '\n') % sys.argv[0])
+    sys.exit(1)
+
+def main():
+    args = sys.argv[1:]
+    address = KWP_RADIO
+    safe_code = None
+    while args[:1] in (['-a'], ['-s']) and len(args) > 1:
+        if args[0] == '-a':
+            address = int(args[1], 16)
+        else:
+            safe_code = int(args[1])
+        args = args[2:]
+    if not (1 <= len(args) <= KWP_STREAM_MAX_GROUPS):
+        usage()
+    groups = [int(x, 16) for x in args]
+
+    client = make_client()
+    client.connect(address)
+    if safe_code is not None:
+        client.login_safe(safe_code)
+
+    # Ctrl-C stops the stream after the next response
+    interrupted = []
+    signal.signal(signal.SIGINT, lambda signum, frame: interrupted.append(True))
+
+    def show(group, secs, data):
+        print("%10.4f %02X: %s" % (secs, group, ' '.join('%02X' % b for b in data)))
+        return bool(interrupted)
+
+    rates = client.stream_groups(groups, show)
+
+    for group in groups:
+        print("Group %02X: %0.2f samples/sec" % (group, rates[group]))
+    client.disconnect()
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,307 @@
+'''
+Client for the command interface of the KWP1281 tool firmware
+(see firmware/cmd.c).  Commands are sent to the debug serial port.
+
+Example:
+  client = make_client()
+  client.connect(KWP_RADIO)
+  print(client.module_info())
+  client.login_safe(1234)
+  data = client.read_memory(KWP_READ_RAM, 0x0000, 0x80)
+  client.disconnect()
+'''
+
+import binascii
+import struct
+import time
+import serial # pyserial
+
+CMD_ECHO = 0x02
+CMD_KWP_CONNECT = 0x10
+CMD_KWP_DISCONNECT = 0x11
+CMD_KWP_SEND_BLOCK = 0x12
+CMD_KWP_RECEIVE_BLOCK = 0x13
+CMD_KWP_READ_MEMORY = 0x14
+CMD_KWP_LOGIN_SAFE = 0x15
+CMD_KWP_P5_LOGIN_MFG = 0x16
+CMD_KWP_MODULE_INFO = 0x17
+CMD_KWP_SESSION_INFO = 0x18
+CMD_KWP_SET_KEEPALIVE = 0x19
+CMD_KWP_P5_WRITE_EEPROM = 0x1A
+CMD_KWP_STREAM_GROUPS = 0x1B
+CMD_KWP_SNIFF = 0x1C
+
+ERROR_OK = 0x00
+ERROR_NO_COMMAND = 0x01
+ERROR_BAD_COMMAND = 0x02
+ERROR_BAD_ARGS_LENGTH = 0x03
+ERROR_BAD_ARGS_VALUE = 0x04
+ERROR_KWP = 0x05
+
+# kwp_result_t
+KWP_RESULTS = {
+    0: 'Success',
+    1: 'Timeout',
+    2: 'Bad Echo',
+    3: 'Bad Complement',
+    4: 'Bad Block Length',
+    5: 'Bad Block End',
+    6: 'Bad Block Counter',
+    7: 'RX Overflow',
+    8: 'Unexpected',
+    9: 'Memory Too Short',
+    10: 'Memory Too Long',
+    11: 'Busy',
+    12: 'NAK Received',
+    13: 'Verify Failed',
+}
+
+KWP_RADIO = 0x56
+KWP_RADIO_MFG = 0x7C
+
+KWP_READ_RAM = 0x01
+KWP_READ_ROM_EEPROM = 0x03
+KWP_READ_EEPROM = 0x19
+KWP_MAX_CHUNK_SIZE = 251
+KWP_P5_EEPROM_SIZE = 0x200
+KWP_STREAM_MAX_GROUPS = 8
+
+# binary frames (see firmware/dump.h)
+FRAME_SYNC = b'\xa5\x5a'
+FRAME_GROUP = ord('G')
+FRAME_SNIFF = ord('K')
+TICKS_PER_SEC = 10000
+
+# seconds to wait for replies to commands that take a long time
+CONNECT_TIMEOUT = 20    # autoconnect tries 4 times with 2 second pauses
+DISCONNECT_TIMEOUT = 8  # firmware waits 5 seconds
+KWP_TIMEOUT = 5         # one block exchange, 3 second byte timeout
+
+
+class KwpError(Exception):
+    '''The command was valid but the KWP1281 exchange failed'''
+    def __init__(self, result):
+        self.result = result
+        desc = KWP_RESULTS.get(result, '???')
+        Exception.__init__(self, "KWP1281 error 0x%02X: %s" % (result, desc))
+
+
+class Client(object):
+    def __init__(self, ser):
+        self.serial = ser
+
+    # High level ==============================================================
+
+    def echo(self, data):
+        rx_bytes = self.command(bytearray([CMD_ECHO]) + bytearray(data))
+        return rx_bytes[1:]
+
+    def connect(self, address, baud=0):
+        '''Connect to the module.  A baud rate of 0 measures the module's
+        rate, falling back to 9600 and 10400 baud.'''
+        self.command([CMD_KWP_CONNECT, address, baud >> 8, baud & 0xFF],
+                     timeout=CONNECT_TIMEOUT)
+
+    def disconnect(self):
+        self.command([CMD_KWP_DISCONNECT], timeout=DISCONNECT_TIMEOUT)
+
+    def module_info(self):
+        '''Returns (vag number, component) received by the last connect'''
+        data = self.command([CMD_KWP_MODULE_INFO])[1:]
+        vag_number = bytes(data[0:12]).decode('latin-1')
+        component = bytes(data[12:36]).decode('latin-1')
+        return vag_number, component
+
+    def session_info(self):
+        '''Returns a dict with the session uptime (0 if closed) and the
+        keep-alive count and round trips'''
+        data = self.command([CMD_KWP_SESSION_INFO])[1:]
+        uptime_ms, count, rtt, rtt_max = struct.unpack('>LHHH', bytes(data))
+        return {'uptime_ms': uptime_ms,
+                'keepalives': count,
+                'rtt_ms': rtt / 10.0,
+                'rtt_max_ms': rtt_max / 10.0}
+
+    def set_keepalive(self, interval_ms):
+        '''Set the idle time before a keep-alive.  0 turns them off.'''
+        self.command([CMD_KWP_SET_KEEPALIVE, interval_ms >> 8, interval_ms & 0xFF])
+
+    def login_safe(self, safe_code):
+        self.command([CMD_KWP_LOGIN_SAFE, safe_code >> 8, safe_code & 0xFF],
+                     timeout=KWP_TIMEOUT * 4)
+
+    def p5_login_mfg(self):
+        self.command([CMD_KWP_P5_LOGIN_MFG], timeout=KWP_TIMEOUT * 2)
+
+    def send_block(self, title, data=()):
+        '''Send a block.  The length, counter, and end are added.'''
+        self.command(bytearray([CMD_KWP_SEND_BLOCK, title]) + bytearray(data),
+                     timeout=KWP_TIMEOUT)
+
+    def receive_block(self):
+        '''Receive a block.  Returns (title, data).'''
+        block = self.command([CMD_KWP_RECEIVE_BLOCK], timeout=KWP_TIMEOUT)[1:]
+        return block[2], block[3:-1]
+
+    def read_memory(self, title, address, length, chunk_size=KWP_MAX_CHUNK_SIZE):
+        '''Read any length of memory, one chunk per command'''
+        data = bytearray()
+        while len(data) < length:
+            size = min(chunk_size, length - len(data))
+            rx_bytes = self.command(
+                [CMD_KWP_READ_MEMORY, title, address >> 8, address & 0xFF, size],
+                timeout=KWP_TIMEOUT * 4)
+            data.extend(rx_bytes[1:])
+            address = (address + size) & 0xFFFF
+        return data
+
+    def p5_write_eeprom(self, address, data, span=KWP_MAX_CHUNK_SIZE):
+        '''Write any length of Premium 5 EEPROM, one span per command.
+        Only the bytes that differ are written, and they are verified.
+        Returns (bytes written, write blocks sent).'''
+        written = blocks = 0
+        for offset in range(0, len(data), span):
+            part = bytearray(data[offset:offset + span])
+            rx_bytes = self.command(
+                bytearray([CMD_KWP_P5_WRITE_EEPROM, address >> 8, address & 0xFF]) + part,
+                timeout=KWP_TIMEOUT * 8)
+            written += (rx_bytes[1] << 8) + rx_bytes[2]
+            blocks += (rx_bytes[3] << 8) + rx_bytes[4]
+            address += len(part)
+        return written, blocks
+
+    def stream_groups(self, groups, callback, cycles=0):
+        '''Read measuring groups over and over.  callback(group, seconds,
+        data) is called for each response, with the firmware's time of
+        receipt.  If cycles is 0, the stream runs until the callback
+        returns True.  Returns a dict of group: samples per second.'''
+        self.send(bytearray([CMD_KWP_STREAM_GROUPS, cycles >> 8, cycles & 0xFF]) +
+                  bytearray(groups))
+        stopping = False
+        while True:
+            head = self._read_head(KWP_TIMEOUT)
+            if head != FRAME_SYNC[0]:
+                break   # reply to the command
+            frame = self._read_frame()
+            if frame is None or frame[0] != FRAME_GROUP:
+                continue
+            _, group, data = frame
+            tick = struct.unpack('>L', bytes(data[0:4]))[0]
+            if callback(group, tick / float(TICKS_PER_SEC), data[4:]) and not stopping:
+                self.serial.write(b'\x00')
+                stopping = True
+
+        rx_bytes = self._read_reply(head, False)
+        elapsed_ms = struct.unpack('>L', bytes(rx_bytes[1:5]))[0]
+        secs = max(elapsed_ms, 1) / 1000.0
+        rates = {}
+        for i, group in enumerate(groups):
+            samples = (rx_bytes[5 + i*2] << 8) + rx_bytes[6 + i*2]
+            rates[group] = samples / secs
+        return rates
+
+    def sniff(self, callback, baud=0):
+        '''Listen to the K-line without driving it.  callback(seq, kind,
+        status, seconds, duration, data) is called for each record (see
+        firmware/sniff.h), with the firmware's time the record started
+        and its duration in seconds.  The sniffer runs until the callback
+        returns True.  While the line is quiet, it is also called with
+        all None every serial timeout so it can stop an idle sniffer.
+        A baud rate of 0 measures it for each session.
+        Returns (blocks, errors, dropped).'''
+        self.send([CMD_KWP_SNIFF, baud >> 8, baud & 0xFF])
+        stopping = False
+        while True:
+            head = self.serial.read(1)
+            if len(head) == 0:
+                stop = callback(None, None, None, None, None, None)
+            else:
+                head = ord(head)
+                if head != FRAME_SYNC[0]:
+                    break   # reply to the command
+                frame = self._read_frame()
+                if frame is None or frame[0] != FRAME_SNIFF:
+                    continue
+                _, seq, data = frame
+                tick, duration = struct.unpack('>LH', bytes(data[2:8]))
+                stop = callback(seq, chr(data[0]), data[1],
+                                tick / float(TICKS_PER_SEC),
+                                duration / float(TICKS_PER_SEC), data[8:])
+            if stop and not stopping:
+                self.serial.write(b'\x00')
+                stopping = True
+
+        rx_bytes = self._read_reply(head, False)
+        return struct.unpack('>HHH', bytes(rx_bytes[1:7]))
+
+    # Low level ===============================================================
+
+    def command(self, data, ignore_error=False, timeout=None):
+        self.send(data)
+        return self.receive(ignore_error, timeout)
+
+    def send(self, data):
+        self.serial.write(bytearray([len(data)] + list(data)))
+        self.serial.flush()
+
+    def receive(self, ignore_error=False, timeout=None):
+        return self._read_reply(self._read_head(timeout), ignore_error)
+
+    def _read_head(self, timeout):
+        saved_timeout = self.serial.timeout
+        if timeout is not None:
+            self.serial.timeout = timeout
+        try:
+            head = self.serial.read(1)
+        finally:
+            self.serial.timeout = saved_timeout
+        if len(head) == 0:
+            raise Exception("Timeout: No reply header byte received")
+        return ord(head)
+
+    def _read_frame(self):
+        '''Read the rest of a binary frame after its first sync byte.
+        Returns (type, address, data), or None if the CRC is bad.'''
+        rest = bytearray(self.serial.read(5))
+        if len(rest) < 5 or rest[0] != FRAME_SYNC[1]:
+            raise Exception("Timeout: Incomplete frame header %r" % rest)
+        header = rest[1:5]
+        data = bytearray(self.serial.read(header[3]))
+        crc = bytearray(self.serial.read(2))
+        if len(data) < header[3] or len(crc) < 2:
+            raise Exception("Timeout: Incomplete frame")
+        if binascii.crc_hqx(bytes(header + data), 0) != (crc[0] << 8) + crc[1]:
+            return None
+        return header[0], (header[1] << 8) + header[2], data
+
+    def _read_reply(self, expected_num_bytes, ignore_error):
+        rx_bytes = bytearray(self.serial.read(expected_num_bytes))
+        if len(rx_bytes) < expected_num_bytes:
+            raise Exception("Timeout: Expected reply of %d bytes, got %d: %r" % (
+                expected_num_bytes, len(rx_bytes), rx_bytes))
+
+        if not ignore_error:
+            if rx_bytes[0] == ERROR_KWP:
+                raise KwpError(rx_bytes[1])
+            if rx_bytes[0] != ERROR_OK:
+                raise Exception("Command error: %d" % rx_bytes[0])
+        return rx_bytes
+
+    def resync(self):
+        '''Wait out the firmware's command timeout and discard anything
+        received, e.g. after the client was interrupted mid-command.'''
+        time.sleep(2.5)
+        self.serial.reset_input_buffer()
+
+
+def make_serial():
+    from serial.tools.list_ports import comports
+    names = [ x.device for x in comports() if 'Bluetooth' not in x.device ]
+    if not names:
+        raise Exception("No serial port found")
+    return serial.Serial(port=names[0], baudrate=115200, timeout=2)
+
+def make_client(serial=None):
+    if serial is None:
+        serial = make_serial()
+    return Client(serial)
@@ -0,0 +1,160 @@
+#!/usr/bin/env python3 -u
+'''
+Renders the debug log frames sent by the KWP1281 tool (see firmware/log.h)
+as a text transcript.  Text between frames is passed through.  Reads
+from the serial port, or from a file ("-" for stdin) such as the output
+of native/kwp1281_bench.
+
+Log frame data: <level> <event> <tick: 4> <args...>
+The frame address is a sequence number; gaps are reported as drops.
+
+Usage: %s [-l level] [file]
+  level   highest level shown: error, warn, info, debug (default debug)
+'''
+
+import sys
+from dumpmem import SYNC, crc16_xmodem, make_serial
+from kwpclient import KWP_RESULTS
+
+FRAME_LOG = ord('L')
+
+LEVELS = {1: 'ERROR', 2: 'WARN', 3: 'INFO', 4: 'DEBUG'}
+
+EV_TEXT = 0x00
+EV_SEND = 0x01
+EV_RECV = 0x02
+EV_CONNECT = 0x03
+EV_UNEXPECTED = 0x04
+EV_CHUNK_SIZE = 0x05
+EV_DUMP_ERROR = 0x06
+EV_RESULT = 0x07
+EV_KEEPALIVE = 0x08
+EV_WRITE = 0x09
+EV_VERIFY_ERROR = 0x0A
+
+TICKS_PER_SEC = 10000
+
+def hexbytes(data):
+    return ' '.join('%02X' % b for b in data)
+
+def describe_result(result):
+    return KWP_RESULTS.get(result, '???')
+
+def describe(event, args):
+    '''Returns the transcript line for a record'''
+    if event == EV_TEXT:
+        return args.decode('latin-1')
+    if event == EV_SEND:
+        return 'SEND: ' + hexbytes(args)
+    if event == EV_RECV:
+        return 'RECV: ' + hexbytes(args)
+    if event == EV_CONNECT:
+        baud = int.from_bytes(args[1:5], 'big')
+        return 'CONNECT %02X: %d baud' % (args[0], baud)
+    if event == EV_UNEXPECTED:
+        return 'Expected to receive title 0x%02X, got 0x%02X' % (args[0], args[1])
+    if event == EV_CHUNK_SIZE:
+        return 'CHUNK SIZE: %02X' % args[0]
+    if event == EV_DUMP_ERROR:
+        return 'DUMP ERROR AT %04X: %s' % ((args[0] << 8) + args[1],
+                                          describe_result(args[2]))
+    if event == EV_RESULT:
+        return 'RESULT: %s' % describe_result(args[0])
+    if event == EV_KEEPALIVE:
+        return 'KEEP-ALIVE: %0.1f ms' % (((args[0] << 8) + args[1]) / 10.0)
+    if event == EV_WRITE:
+        return 'WRITE %04X: %d bytes' % ((args[0] << 8) + args[1], args[2])
+    if event == EV_VERIFY_ERROR:
+        return 'VERIFY ERROR AT %04X: wrote %02X, read %02X' % (
+            (args[0] << 8) + args[1], args[2], args[3])
+    return 'EVENT %02X: %s' % (event, hexbytes(args))
+
+def read_frame(f, text_out):
+    '''Read bytes until a frame is received.  Returns (type, address, data),
+    or None if a frame had a bad CRC.  Raises EOFError at end of input.'''
+    def read(n):
+        data = f.read(n)
+        if len(data) < n:
+            raise EOFError()
+        return bytearray(data)
+
+    while True:
+        c = read(1)
+        if c == SYNC[0:1]:
+            if read(1) == SYNC[1:2]:
+                break
+        else:
+            text_out.write(c.decode('latin-1'))
+
+    header = read(4)
+    frame_type, length = header[0], header[3]
+    address = (header[1] << 8) + header[2]
+    data = read(length)
+    crc = read(2)
+    if crc16_xmodem(header + data) != ((crc[0] << 8) + crc[1]):
+        return None
+    return frame_type, address, data
+
+class Renderer(object):
+    def __init__(self, out, max_level=4):
+        self.out = out
+        self.max_level = max_level
+        self.next_seq = None
+        self.dropped = 0
+        self.bad_frames = 0
+
+    def record(self, seq, data):
+        if self.next_seq is not None and seq != self.next_seq:
+            lost = (seq - self.next_seq) & 0xFFFF
+            self.dropped += lost
+            self.out.write('*** %d LOG RECORDS DROPPED\n' % lost)
+        self.next_seq = (seq + 1) & 0xFFFF
+
+        level, event = data[0], data[1]
+        if level > self.max_level:
+            return
+        tick = int.from_bytes(data[2:6], 'big')
+        self.out.write('%10.4f %-5s %s\n' % (tick / TICKS_PER_SEC,
+            LEVELS.get(level, '?'), describe(event, data[6:])))
+
+    def run(self, f):
+        try:
+            while True:
+                frame = read_frame(f, self.out)
+                if frame is None:
+                    self.bad_frames += 1
+                    self.out.write('*** BAD FRAME\n')
+                elif frame[0] == FRAME_LOG:
+                    self.record(frame[1], frame[2])
+        except (EOFError, KeyboardInterrupt):
+            pass
+
+def main():
+    args = sys.argv[1:]
+    max_level = 4
+    if args[:1] == ['-l'] and len(args) > 1:
+        names = dict((v.lower(), k) for k, v in LEVELS.items())
+        if args[1] not in names:
+            sys.stderr.write((__doc__.strip() + '\n') % sys.argv[0])
+            sys.exit(1)
+        max_level = names[args[1]]
+        args = args[2:]
+    if len(args) > 1:
+        sys.stderr.write((__doc__.strip() + '\n') % sys.argv[0])
+        sys.exit(1)
+
+    if not args:
+        f = make_serial()
+    elif args[0] == '-':
+        f = sys.stdin.buffer
+    else:
+        f = open(args[0], 'rb')
+
+    renderer = Renderer(sys.stdout, max_level)
+    renderer.run(f)
+    if renderer.dropped or renderer.bad_frames:
+        sys.stderr.write('Dropped records: %d, Bad frames: %d\n' % (
+            renderer.dropped, renderer.bad_frames))
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,399 @@
+#!/usr/bin/env python3 -u
+'''
+KWP1281 Module Simulator
+
+Emulates the Premium 4 radio (" RADIO 3CP"), the Premium 5 radio ("DE2"),
+and the Premium 5 manufacturing mode (address 0x7C) on a pseudo-terminal.
+The host build of the firmware (../native) connects to the pty printed at
+startup, so the protocol engine can be run and benchmarked without a radio.
+
+The simulator does the module's side of the protocol: complements of the
+bytes it receives, block counters, and the identification blocks and
+responses recorded in reverse_engineering/premium_4/captures/kwp1281.
+A pty can't carry the 5 baud address, so the first byte received while
+disconnected is taken as the address.
+
+Usage: %s [options]
+'''
+
+import argparse
+import os
+import pty
+import random
+import select
+import sys
+import time
+import tty
+
+# Block titles (see firmware/kwp1281.h)
+KWP_READ_ID = 0x00
+KWP_READ_RAM = 0x01
+KWP_READ_ROM_EEPROM = 0x03
+KWP_END_SESSION = 0x06
+KWP_ACK = 0x09
+KWP_NAK = 0x0A
+KWP_WRITE_EEPROM = 0x0C
+KWP_CUSTOM = 0x1B
+KWP_READ_EEPROM = 0x19
+KWP_GROUP_READING = 0x29
+KWP_LOGIN = 0x2B
+KWP_R_GROUP_READING = 0xE7
+KWP_SAFE_CODE = 0xF0
+KWP_R_ASCII_DATA = 0xF6
+KWP_R_WRITE_EEPROM = 0xF9
+KWP_R_READ_ROM_EEPROM = 0xFD
+KWP_R_READ_RAM = 0xFE
+
+KWP_RADIO = 0x56
+KWP_RADIO_MFG = 0x7C
+
+
+class Timeout(Exception):
+    pass
+
+class ProtocolError(Exception):
+    pass
+
+
+class Line(object):
+    '''Module side of the K-line.  Every byte costs the time it would take
+    on the wire at the baud rate, and the module waits latency seconds
+    before each byte it sends.'''
+
+    def __init__(self, fd, baud, latency, block_latency, timeout,
+                 error_rate, rng):
+        self.fd = fd
+        self.byte_time = 10.0 / baud
+        self.latency = latency
+        self.block_latency = block_latency
+        self.timeout = timeout
+        self.error_rate = error_rate
+        self.rng = rng
+        self.errors_injected = 0
+
+    def read_byte(self, wait_forever=False):
+        timeout = None if wait_forever else self.timeout
+        ready, _, _ = select.select([self.fd], [], [], timeout)
+        if not ready:
+            raise Timeout()
+        time.sleep(self.byte_time)
+        return bytearray(os.read(self.fd, 1))[0]
+
+    def write_byte(self, b):
+        time.sleep(self.latency)
+        os.write(self.fd, bytearray([b]))
+        time.sleep(self.byte_time)
+
+    def inject_error(self):
+        if self.error_rate and (self.rng.random() < self.error_rate):
+            self.errors_injected += 1
+            return True
+        return False
+
+    def flush(self):
+        while select.select([self.fd], [], [], 0)[0]:
+            os.read(self.fd, 256)
+
+
+class Module(object):
+    '''Base class for a simulated module.  Subclasses fill in the
+    identification blocks and handle request blocks.'''
+
+    address = None
+    ident_blocks = ()           # data of each 0xF6 block sent on connect
+    max_chunk_size = 251
+
+    def __init__(self, rng, safe_code, max_chunk_size=None):
+        self.rng = rng
+        self.safe_code = safe_code
+        if max_chunk_size is not None:
+            self.max_chunk_size = max_chunk_size
+        self.logged_in = False
+        self.unlocked = False
+
+    def memory(self, title, address, length):
+        '''Contents of memory for a read memory request.  The default is
+        a pattern derived from the address.'''
+        return [((a >> 8) ^ (a & 0xFF)) & 0xFF
+                for a in range(address, address + length)]
+
+    def handle(self, title, data):
+        '''Handle a request block.  Returns (title, data) of the response,
+        or None to end the session.'''
+        if title == KWP_ACK:
+            return KWP_ACK, []
+        elif title == KWP_END_SESSION:
+            return None
+        elif title == KWP_LOGIN:
+            return self.login(data)
+        elif title == KWP_GROUP_READING:
+            return self.group_reading(data[0])
+        elif title in (KWP_READ_RAM, KWP_READ_ROM_EEPROM, KWP_READ_EEPROM):
+            return self.read_mem(title, data)
+        return KWP_NAK, []
+
+    def login(self, data):
+        code = (data[0] << 8) + data[1]
+        if code == self.safe_code:
+            self.logged_in = True
+            return KWP_ACK, []
+        return KWP_NAK, []
+
+    def group_reading(self, group):
+        if group == 0x19:
+            self.unlocked = self.logged_in
+            return KWP_ACK, []
+        # group 1 as recorded from a Premium 4, with a little noise
+        noise = self.rng.randint(0, 1)
+        return KWP_R_GROUP_READING, [0x25, 0x00, 0x00,
+                                     0x06, 0x64, 0x8C + noise,
+                                     0x17, 0xFF, 0x00,
+                                     0x25, 0x00, 0x87]
+
+    def read_mem_titles(self):
+        return {KWP_READ_RAM: KWP_R_READ_RAM,
+                KWP_READ_ROM_EEPROM: KWP_R_READ_ROM_EEPROM}
+
+    def read_mem(self, title, data):
+        titles = self.read_mem_titles()
+        if (not self.unlocked) or (title not in titles):
+            return KWP_NAK, []
+        length, address = data[0], (data[1] << 8) + data[2]
+        if length > self.max_chunk_size:
+            return KWP_NAK, []
+        return titles[title], self.memory(title, address, length)
+
+
+class Premium4(Module):
+    address = KWP_RADIO
+    ident_blocks = (
+        list(b'1J0035180D  '),
+        list(b' RADIO 3CP  '),
+        list(b'        0001'),
+        [0x00, 0x0A, 0xF8, 0x00, 0x00],
+    )
+
+    def read_mem_titles(self):
+        return {KWP_READ_RAM: KWP_R_READ_RAM,
+                KWP_READ_ROM_EEPROM: KWP_R_READ_ROM_EEPROM,
+                KWP_READ_EEPROM: KWP_R_READ_ROM_EEPROM}
+
+    def handle(self, title, data):
+        if title == KWP_SAFE_CODE:  # read safe code as bcd
+            bcd = int(str(self.safe_code), 16)
+            return KWP_SAFE_CODE, [bcd >> 8, bcd & 0xFF]
+        return Module.handle(self, title, data)
+
+
+class Premium5(Module):
+    address = KWP_RADIO
+    ident_blocks = (
+        list(b'1J0035180B  '),
+        list(b' Radio DE2  '),
+        list(b'        0001'),
+        [0x00, 0x03, 0x21, 0x86, 0x9F],
+    )
+    # writes here are skipped but reported as successful (SAFE code and
+    # an unknown area).  The radio checks a flag we assume is set when
+    # logged in at 0x56.
+    protected = (range(0x14, 0x16), range(0x58, 0x61))
+
+    def __init__(self, rng, safe_code, max_chunk_size=None):
+        Module.__init__(self, rng, safe_code, max_chunk_size)
+        self.eeprom = [0xFF] * 512  # 24C04
+        bcd = int(str(safe_code), 16)
+        self.eeprom[0x14:0x16] = [bcd >> 8, bcd & 0xFF]
+
+    def memory(self, title, address, length):
+        if title == KWP_READ_ROM_EEPROM:
+            return [self.eeprom[(address + i) % len(self.eeprom)]
+                    for i in range(length)]
+        return Module.memory(self, title, address, length)
+
+    def handle(self, title, data):
+        if title == KWP_WRITE_EEPROM:
+            return self.write_eeprom(data)
+        return Module.handle(self, title, data)
+
+    def write_eeprom(self, data):
+        length, address = data[0], (data[1] << 8) + data[2]
+        values = data[3:]
+        if (not self.unlocked) or (length != len(values)) or (length == 0):
+            return KWP_NAK, []
+        if (length > self.max_chunk_size) or (address + length > len(self.eeprom)):
+            return KWP_NAK, []
+        for i, b in enumerate(values):
+            if not any((address + i) in r for r in self.protected):
+                self.eeprom[address + i] = b
+        return KWP_R_WRITE_EEPROM, [length, address >> 8, address & 0xFF, values[0]]
+
+    def group_reading(self, group):
+        if group == 0x19:   # naks but unlocks anyway
+            self.unlocked = self.logged_in
+            return KWP_NAK, []
+        return Module.group_reading(self, group)
+
+
+class Premium5Mfg(Premium5):
+    address = KWP_RADIO_MFG
+    ident_blocks = ()
+    protected = ()
+
+    def login(self, data):
+        if bytes(bytearray(data[0:5])) == b'OCLED':
+            self.logged_in = self.unlocked = True
+            return KWP_ACK, []
+        return KWP_NAK, []
+
+    def handle(self, title, data):
+        if (title == KWP_CUSTOM) and (data[0:2] == [0x31, 0x32]):
+            return KWP_CUSTOM, [0x31, 0x32, 0x12, 0x34]  # rom checksum
+        return Premium5.handle(self, title, data)
+
+
+class Session(object):
+    '''One connection from the 5 baud address until a timeout, an error,
+    or an End Session block.'''
+
+    def __init__(self, line, module, verbose):
+        self.line = line
+        self.module = module
+        self.verbose = verbose
+        self.counter = 0xF0
+
+    def log(self, msg):
+        if self.verbose:
+            sys.stderr.write(msg + '\n')
+
+    def run(self):
+        line = self.line
+        time.sleep(0.05)
+        for b in (0x55, 0x01, 0x8A):
+            line.write_byte(b)
+        if line.read_byte() != (0x8A ^ 0xFF):
+            raise ProtocolError("Expected 0x75")
+
+        for data in self.module.ident_blocks:
+            self.send_block(KWP_R_ASCII_DATA, data)
+            title, _ = self.receive_block()
+            if title != KWP_ACK:
+                raise ProtocolError("Expected ACK, got 0x%02X" % title)
+        self.send_block(KWP_ACK, [])
+
+        while True:
+            title, data = self.receive_block()
+            response = self.module.handle(title, data)
+            if response is None:
+                return
+            time.sleep(line.block_latency)
+            self.send_block(*response)
+
+    def send_block(self, title, data):
+        self.counter = (self.counter + 1) & 0xFF
+        block = [len(data) + 3, self.counter, title] + list(data) + [0x03]
+        self.log("SEND: " + ' '.join('%02X' % b for b in block))
+        for i, b in enumerate(block):
+            if i == len(block) - 1:     # block end, no complement
+                self.line.write_byte(b)
+                break
+            if self.line.inject_error():
+                self.log("INJECT: drop byte")
+                return  # stop sending; the tester will time out
+            self.line.write_byte(b)
+            complement = self.line.read_byte()
+            if complement != (b ^ 0xFF):
+                raise ProtocolError("Bad complement 0x%02X for 0x%02X" %
+                                    (complement, b))
+
+    def receive_block(self):
+        block = []
+        length = None
+        while True:
+            b = self.line.read_byte()
+            block.append(b)
+            if (length is not None) and (len(block) == length + 1):
+                if b != 0x03:
+                    raise ProtocolError("Bad block end 0x%02X" % b)
+                break
+            if len(block) == 1:
+                length = b
+            elif len(block) == 2:
+                expected = (self.counter + 1) & 0xFF
+                if b != expected:
+                    raise ProtocolError("Bad block counter 0x%02X" % b)
+                self.counter = b
+            complement = b ^ 0xFF
+            if self.line.inject_error():
+                self.log("INJECT: bad complement")
+                complement ^= 0x01
+            self.line.write_byte(complement)
+        self.log("RECV: " + ' '.join('%02X' % b for b in block))
+        return block[2], block[3:-1]
+
+
+def parse_args(argv):
+    usage = __doc__.strip().splitlines()[-1].replace('Usage: ', '')
+    parser = argparse.ArgumentParser(usage=usage % 'simulator.py')
+    parser.add_argument('--radio', choices=('premium4', 'premium5'),
+                        default='premium4', help='radio at address 0x56')
+    parser.add_argument('--safe-code', type=int, default=1234,
+                        help='SAFE code for login (decimal)')
+    parser.add_argument('--baud', type=int, default=10400,
+                        help='baud rate used for byte timing')
+    parser.add_argument('--latency', type=float, default=0.5,
+                        help='delay before each byte sent (ms)')
+    parser.add_argument('--block-latency', type=float, default=5.0,
+                        help='delay before each response block (ms)')
+    parser.add_argument('--timeout', type=float, default=1.0,
+                        help='inter-byte timeout before disconnecting (s)')
+    parser.add_argument('--max-chunk', type=int, default=None,
+                        help='largest memory read or write allowed (bytes)')
+    parser.add_argument('--error-rate', type=float, default=0.0,
+                        help='probability of an error per byte')
+    parser.add_argument('--seed', type=int, default=None,
+                        help='random seed for error injection')
+    parser.add_argument('-v', '--verbose', action='store_true',
+                        help='print blocks sent and received')
+    return parser.parse_args(argv)
+
+def make_module(args, address, rng):
+    if address == KWP_RADIO_MFG:
+        cls = Premium5Mfg
+    elif address == KWP_RADIO:
+        cls = Premium4 if args.radio == 'premium4' else Premium5
+    else:
+        return None
+    return cls(rng, args.safe_code, args.max_chunk)
+
+def main():
+    args = parse_args(sys.argv[1:])
+    rng = random.Random(args.seed)
+
+    master, slave = pty.openpty()
+    tty.setraw(slave)
+    sys.stdout.write("%s\n" % os.ttyname(slave))
+    sys.stdout.flush()
+
+    line = Line(master, args.baud, args.latency / 1000.0,
+                args.block_latency / 1000.0, args.timeout,
+                args.error_rate, rng)
+    try:
+        while True:
+            address = line.read_byte(wait_forever=True)
+            module = make_module(args, address, rng)
+            if module is None:
+                sys.stderr.write("Ignored address 0x%02X\n" % address)
+                continue
+            sys.stderr.write("Connect 0x%02X\n" % address)
+            try:
+                Session(line, module, args.verbose).run()
+                sys.stderr.write("End session\n")
+            except (Timeout, ProtocolError) as exc:
+                sys.stderr.write("Disconnect: %s\n" % (str(exc) or 'Timeout'))
+            line.flush()
+    except KeyboardInterrupt:
+        pass
+    sys.stderr.write("Errors injected: %d\n" % line.errors_injected)
+
+if __name__ == '__main__':
+    main()
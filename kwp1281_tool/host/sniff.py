@@ -0,0 +1,128 @@
+#!/usr/bin/env python3 -u
+'''
+Watches the K-line between another tester and a module through the KWP1281
+tool's command interface (see kwpclient.py) until Ctrl-C.  The tool only
+listens; it must not be connected to a module itself.
+
+Usage: %s [-b baud]
+  baud        K-line baud rate (default: measure it for each session)
+
+Each block is printed with the time it started, how long it took to
+receive, who sent it, and its title.  The module sends the first block
+after the sync byte, and the sender alternates with the block counter.
+'''
+
+import signal
+import sys
+from kwpclient import make_client
+
+SNIFF_KIND_SYNC = 'S'
+SNIFF_KIND_BLOCK = 'B'
+SNIFF_KIND_END = 'E'
+
+SNIFF_STATUS = {
+    0: '',
+    1: 'BAD COMPLEMENT',
+    2: 'BAD BLOCK END',
+    3: 'TIMEOUT',
+    4: 'BAD BLOCK LENGTH',
+}
+
+# block titles (see firmware/kwp1281.h)
+TITLES = {
+    0x00: 'READ ID',
+    0x01: 'READ RAM',
+    0x03: 'READ ROM/EEPROM',
+    0x04: 'OUTPUT TESTS',
+    0x05: 'CLEAR FAULTS',
+    0x06: 'END SESSION',
+    0x07: 'READ FAULTS',
+    0x08: 'SINGLE READING',
+    0x09: 'ACK',
+    0x0A: 'NAK',
+    0x0C: 'WRITE EEPROM',
+    0x10: 'RECODING',
+    0x19: 'READ EEPROM',
+    0x1B: 'CUSTOM',
+    0x21: 'ADAPTATION',
+    0x28: 'BASIC SETTING',
+    0x29: 'GROUP READING',
+    0x2B: 'LOGIN',
+    0xE7: 'R GROUP READING',
+    0xF0: 'SAFE CODE',
+    0xF5: 'R OUTPUT TEST',
+    0xF6: 'R ASCII DATA',
+    0xF9: 'R WRITE EEPROM',
+    0xFC: 'R FAULTS',
+    0xFD: 'R READ ROM/EEPROM',
+    0xFE: 'R READ RAM',
+}
+
+def usage():
+    sys.stderr.write((__doc__.strip() + '\n') % sys.argv[0])
+    sys.exit(1)
+
+class Printer(object):
+    def __init__(self, out):
+        self.out = out
+        self.first_counter = None   # counter of the module's first block
+        self.last_seq = None
+
+    def record(self, seq, kind, status, secs, duration, data):
+        if self.last_seq is not None and seq != ((self.last_seq + 1) & 0xFFFF):
+            self.out.write("*** %d records dropped\n" %
+                           ((seq - self.last_seq - 1) & 0xFFFF))
+        self.last_seq = seq
+
+        if kind == SNIFF_KIND_SYNC:
+            baud = (data[0] << 24) + (data[1] << 16) + (data[2] << 8) + data[3]
+            self.out.write("%10.4f SYNC: %d baud\n" % (secs, baud))
+            self.first_counter = None
+        elif kind == SNIFF_KIND_END:
+            self.out.write("%10.4f END\n" % secs)
+            self.first_counter = None
+        elif kind == SNIFF_KIND_BLOCK:
+            line = "%10.4f %6.1fms %s %-17s %s %s" % (
+                secs, duration * 1000, self.sender(data), self.title(data),
+                ' '.join('%02X' % b for b in data), SNIFF_STATUS.get(status, '???'))
+            self.out.write(line.rstrip() + '\n')
+
+    def sender(self, data):
+        if len(data) < 2:
+            return '??????'
+        if self.first_counter is None:
+            self.first_counter = data[1]
+        if ((data[1] - self.first_counter) & 1) == 0:
+            return 'MODULE'
+        return 'TESTER'
+
+    def title(self, data):
+        if len(data) < 3:
+            return ''
+        return TITLES.get(data[2], '%02X' % data[2])
+
+def main():
+    args = sys.argv[1:]
+    baud = 0
+    if args[:1] == ['-b'] and len(args) > 1:
+        baud = int(args[1])
+        args = args[2:]
+    if args:
+        usage()
+
+    # Ctrl-C stops the sniffer
+    interrupted = []
+    signal.signal(signal.SIGINT, lambda signum, frame: interrupted.append(True))
+
+    printer = Printer(sys.stdout)
+    def show(seq, kind, status, secs, duration, data):
+        if kind is not None:
+            printer.record(seq, kind, status, secs, duration, data)
+        return bool(interrupted)
+
+    client = make_client()
+    blocks, errors, dropped = client.sniff(show, baud)
+    print("%d blocks, %d errors, %d records dropped" % (blocks, errors, dropped))
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,39 @@
+#include "autobaud.h"
+#include "main.h"
+#include "uart.h"
+
+/*************************************************************************
+ * Host Auto-Baud
+ *
+ * Implements autobaud.h for the host build.  The pseudo-terminal has no
+ * edges to time, so the 0x55 sync byte is taken from the receive buffer
+ * and the simulator's rate is assumed.
+ *************************************************************************/
+
+#define NATIVE_BAUD 10400
+
+static uint8_t _sync_byte;
+static uint8_t _done;
+
+void autobaud_start()
+{
+    _done = 0;
+}
+
+void autobaud_stop()
+{
+}
+
+uint8_t autobaud_done()
+{
+    if (!_done && uart_rx_ready(UART_KLINE)) {
+        _sync_byte = uart_blocking_get(UART_KLINE);
+        _done = 1;
+    }
+    return _done;
+}
+
+uint32_t autobaud_baud()
+{
+    return (_sync_byte == 0x55) ? NATIVE_BAUD : 0;
+}
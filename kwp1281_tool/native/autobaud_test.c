@@ -0,0 +1,146 @@
+#include "autobaud.h"
+#include <avr/interrupt.h>
+#include <avr/io.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+/*************************************************************************
+ * Auto-Baud Test
+ *
+ * Runs ../firmware/autobaud.c against a simulated K-line.  Timer1 and
+ * its compare match A and INT0 edge interrupts are modeled on the
+ * register variables from avr/io.h.  Each case arms the measurement,
+ * puts a tester's 5 baud address and/or the module's 0x55 sync byte on
+ * the line, and checks the baud rate that is measured.
+ *************************************************************************/
+
+volatile uint8_t UCSR1B;
+volatile uint8_t DDRD;
+volatile uint8_t PORTD;
+volatile uint8_t TCCR1A;
+volatile uint8_t TCCR1B;
+volatile uint16_t TCNT1;
+volatile uint16_t OCR1A;
+volatile uint8_t TIFR1;
+volatile uint8_t TIMSK1;
+volatile uint8_t EICRA;
+volatile uint8_t EIFR;
+volatile uint8_t EIMSK;
+volatile uint8_t PIND;
+
+#define W1_TICKS    (AUTOBAUD_TIMER_HZ / 1000 * 60) // address to 0x55 (60 ms)
+
+static uint64_t _now;           // Timer1 ticks since the simulation began
+static uint64_t _timer_base;    // _now when Timer1 was cleared
+static double _at;              // time of the next bit
+static int _failures;
+
+// Move the simulation to tick, interrupting if Timer1 passes OCR1A
+static void _advance(uint64_t tick)
+{
+    if (TCCR1B != 0) {
+        uint64_t count = _now - _timer_base;
+        uint64_t match = (count & ~0xFFFFULL) + OCR1A;
+        if (match <= count) { match += 0x10000; }
+        TCNT1 = (tick - _timer_base) & 0xFFFF;
+        if ((match <= tick - _timer_base) && (TIMSK1 & _BV(OCIE1A))) {
+            TIMER1_COMPA_vect();
+        }
+    }
+    _now = tick;
+}
+
+static void _line(uint8_t level)
+{
+    uint64_t tick = (uint64_t)(_at + 0.5);
+    if (level == ((PIND & _BV(PD2)) != 0)) { return; }
+    _advance(tick);
+    PIND = level ? _BV(PD2) : 0;
+    if (EIMSK & _BV(INT0)) { INT0_vect(); }
+}
+
+// Send the bits of frame, LSB first, at baud
+static void _send(uint16_t frame, uint8_t num_bits, double baud)
+{
+    for (uint8_t i=0; i<num_bits; i++) {
+        _line((frame >> i) & 1);
+        _at += AUTOBAUD_TIMER_HZ / baud;
+    }
+}
+
+// 7O1 at 5 baud, as sent by a tester to wake up a module
+static void _send_address(uint8_t address)
+{
+    uint8_t parity = 1;
+    for (uint8_t i=0; i<7; i++) { parity ^= (address >> i) & 1; }
+    uint16_t frame = ((address & 0x7F) << 1) | (parity << 8) | (1 << 9);
+    _send(frame, 10, 5);
+}
+
+// 8N1 at baud
+static void _send_byte(uint8_t c, double baud)
+{
+    _send((c << 1) | (1 << 9), 10, baud);
+}
+
+static void _arm()
+{
+    _advance((uint64_t)(_at + 0.5));
+    autobaud_start();
+    _timer_base = _now;
+}
+
+static void _check(const char *name, uint32_t expected)
+{
+    uint32_t baud = autobaud_done() ? autobaud_baud() : 0;
+    autobaud_stop();
+    uint8_t ok = (expected == 0) ? (baud == 0) :
+                 (baud >= expected - (expected / 100)) &&
+                 (baud <= expected + (expected / 100));
+    printf("%s  %-40s expected %5lu, measured %5lu\n", ok ? "PASS" : "FAIL",
+           name, (unsigned long)expected, (unsigned long)baud);
+    if (!ok) { _failures++; }
+    _at += AUTOBAUD_TIMER_HZ;   // idle for a second before the next case
+}
+
+int main()
+{
+    const uint32_t rates[] = { 10400, 9600, 4800, 1200 };
+    char name[64];
+
+    PIND = _BV(PD2);    // K-line idles high
+
+    for (uint8_t i=0; i<sizeof(rates)/sizeof(rates[0]); i++) {
+        snprintf(name, sizeof(name), "0x55 at %lu", (unsigned long)rates[i]);
+        _arm();
+        _send_byte(0x55, rates[i]);
+        _check(name, rates[i]);
+
+        // a sniffer arms before the tester sends the address
+        snprintf(name, sizeof(name), "address 0x56, 0x55 at %lu", (unsigned long)rates[i]);
+        _arm();
+        _send_address(0x56);
+        _at += W1_TICKS;
+        _send_byte(0x55, rates[i]);
+        _check(name, rates[i]);
+    }
+
+    // armed after the start bit of the address
+    _at += AUTOBAUD_TIMER_HZ / 5;
+    _line(0);
+    _at += AUTOBAUD_TIMER_HZ / 5;
+    _arm();
+    _send(0x56 | (1 << 7) | (1 << 8), 9, 5);   // data, parity, stop
+    _at += W1_TICKS;
+    _send_byte(0x55, 10400);
+    _check("armed during address 0x56, 0x55 at 10400", 10400);
+
+    // edges that are not a sync byte
+    _arm();
+    _send_byte(0x01, 10400);
+    _send_byte(0x8A, 10400);
+    _check("0x01 0x8A at 10400", 0);
+
+    return (_failures == 0) ? 0 : 1;
+}
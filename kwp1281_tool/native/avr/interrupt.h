@@ -0,0 +1,12 @@
+#ifndef NATIVE_AVR_INTERRUPT_H
+#define NATIVE_AVR_INTERRUPT_H
+
+// Host build: an interrupt handler is a plain function that the test
+// calls when the event it handles is simulated
+
+#define ISR(vector) void vector(void)
+
+void INT0_vect(void);
+void TIMER1_COMPA_vect(void);
+
+#endif
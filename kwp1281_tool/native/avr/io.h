@@ -0,0 +1,39 @@
+#ifndef NATIVE_AVR_IO_H
+#define NATIVE_AVR_IO_H
+
+// Host build: the registers used by the protocol engine are plain
+// variables (see timer.c for how the 5 baud address line is sampled).
+// The Timer1 and INT0 registers are only used by autobaud_test.c.
+
+#include <stdint.h>
+
+#define _BV(bit) (1 << (bit))
+
+extern volatile uint8_t UCSR1B;
+extern volatile uint8_t DDRD;
+extern volatile uint8_t PORTD;
+
+extern volatile uint8_t TCCR1A;
+extern volatile uint8_t TCCR1B;
+extern volatile uint16_t TCNT1;
+extern volatile uint16_t OCR1A;
+extern volatile uint8_t TIFR1;
+extern volatile uint8_t TIMSK1;
+extern volatile uint8_t EICRA;
+extern volatile uint8_t EIFR;
+extern volatile uint8_t EIMSK;
+extern volatile uint8_t PIND;
+
+#define TXEN1   3
+#define RXEN1   4
+#define PD2     2
+#define PD3     3
+#define CS11    1
+#define OCF1A   1
+#define OCIE1A  1
+#define ISC00   0
+#define ISC01   1
+#define INTF0   0
+#define INT0    0
+
+#endif
@@ -0,0 +1,85 @@
+#include "main.h"
+#include "kwp1281.h"
+#include "log.h"
+#include "native.h"
+#include "timer.h"
+#include "uart.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+/*************************************************************************
+ * Host Benchmark
+ *
+ * Connects to host/simulator.py through its pseudo-terminal, logs in,
+ * and reads memory to measure the throughput of the protocol engine.
+ *************************************************************************/
+
+static const char *usage =
+    "Usage: %s [-q] <pty> [address] [safe code] [total size] [chunk size]\n"
+    "  address     module address in hex (default 56)\n"
+    "  safe code   login code in decimal (default 1234, unused for 7C)\n"
+    "  total size  bytes of RAM to read in hex (default 800)\n"
+    "  chunk size  bytes per block in hex (default 0 = probe)\n"
+    "  -q          do not print the block transcript\n"
+    "The transcript is binary log frames; pipe it to host/kwplog.py -\n";
+
+static void _check(kwp_result_t result, const char *what)
+{
+    if (result == KWP_SUCCESS) { return; }
+    log_flush();
+    fflush(stdout);
+    fprintf(stderr, "%s failed: %s\n", what, kwp_describe_result(result));
+    exit(1);
+}
+
+int main(int argc, char **argv)
+{
+    int arg = 1;
+    if ((argc > 1) && (argv[1][0] == '-') && (argv[1][1] == 'q')) {
+        native_quiet = 1;
+        arg++;
+    }
+    if (argc - arg < 1) {
+        fprintf(stderr, usage, argv[0]);
+        return 1;
+    }
+
+    const char *path = argv[arg];
+    uint8_t address = (argc > arg+1) ? strtoul(argv[arg+1], NULL, 16) : KWP_RADIO;
+    uint16_t safe_code = (argc > arg+2) ? strtoul(argv[arg+2], NULL, 10) : 1234;
+    uint16_t total_size = (argc > arg+3) ? strtoul(argv[arg+3], NULL, 16) : 0x800;
+    uint8_t chunk_size = (argc > arg+4) ? strtoul(argv[arg+4], NULL, 16) : KWP_CHUNK_AUTO;
+
+    if (native_uart_open(path) != 0) {
+        perror(path);
+        return 1;
+    }
+    timer_init();
+    log_init(native_quiet ? LOG_LEVEL_OFF : LOG_LEVEL_DEBUG);
+
+    kwp_result_t result = kwp_autoconnect(address);
+    _check(result, "Connect");
+    kwp_print_module_info();
+
+    if (address == KWP_RADIO_MFG) {
+        result = kwp_p5_login_mfg();
+    } else {
+        result = kwp_login_safe(safe_code);
+    }
+    _check(result, "Login");
+
+    uint32_t start = timer_now();
+    result = kwp_read_ram(0, total_size, chunk_size);
+    uint32_t elapsed = timer_now() - start;
+    _check(result, "Read RAM");
+
+    log_flush();
+    fflush(stdout);
+    double secs = (double)elapsed / TIMER_TICKS_PER_SEC;
+    printf("\nRead %u bytes in %.2f s: %.1f bytes/sec\n",
+           total_size, secs, total_size / secs);
+    native_quiet = 0;
+    kwp_print_timing();
+    fflush(stdout);
+    return 0;
+}
@@ -0,0 +1,15 @@
+#ifndef NATIVE_H
+#define NATIVE_H
+
+#include <stdint.h>
+
+// Host build of the protocol engine.  UART_KLINE is a pseudo-terminal
+// connected to host/simulator.py and UART_DEBUG is stdout.
+
+int native_uart_open(const char *path);
+void native_uart_poll(uint32_t timeout_us);
+void native_uart_send_address(uint8_t address);
+
+uint8_t native_quiet;   // flag: 1=discard UART_DEBUG output
+
+#endif
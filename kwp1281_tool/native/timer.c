@@ -0,0 +1,99 @@
+#include "main.h"
+#include "kwp1281.h"
+#include "native.h"
+#include "timer.h"
+#include <avr/io.h>
+#include <time.h>
+
+/*************************************************************************
+ * Host Timer
+ *
+ * Implements timer.h for the host build.  Ticks come from the monotonic
+ * clock.  There are no interrupts; instead, timer_sleep() polls the
+ * pseudo-terminal and then calls kwp_tick() once for every tick that
+ * has elapsed, like the Timer3 interrupt would have.
+ *************************************************************************/
+
+volatile uint8_t UCSR1B;
+volatile uint8_t DDRD;
+volatile uint8_t PORTD;
+
+static struct timespec _start;
+static uint32_t _ticked;            // last tick kwp_tick() was called for
+
+void timer_init()
+{
+    clock_gettime(CLOCK_MONOTONIC, &_start);
+    _ticked = 0;
+}
+
+uint32_t timer_now()
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    uint64_t us = (uint64_t)(now.tv_sec - _start.tv_sec) * 1000000 +
+                  (now.tv_nsec - _start.tv_nsec) / 1000;
+    return us / (1000000 / TIMER_TICKS_PER_SEC);
+}
+
+uint8_t timer_expired(uint32_t deadline)
+{
+    return (int32_t)(timer_now() - deadline) >= 0;
+}
+
+// Sample the 5 baud address while PD3 is an output.  Each bit is sampled
+// in its middle, measured from the falling edge of the start bit.
+static void _sample_address_line(uint32_t tick)
+{
+    static uint8_t active;
+    static uint32_t start_tick;
+    static uint8_t bits_sampled;
+    static uint8_t address;
+
+    if (!(DDRD & _BV(PD3))) {   // UART owns the line
+        active = 0;
+        return;
+    }
+
+    uint8_t level = (PORTD & _BV(PD3)) != 0;
+    if (!active) {
+        if (level == 0) {       // start bit
+            active = 1;
+            start_tick = tick;
+            bits_sampled = 1;
+            address = 0;
+        }
+        return;
+    }
+
+    const uint32_t bit_ticks = TIMER_MS(200);
+    uint32_t middle = start_tick + (bits_sampled * bit_ticks) + (bit_ticks / 2);
+    if (tick < middle) { return; }
+
+    if ((bits_sampled >= 1) && (bits_sampled <= 7)) {  // 7 data bits
+        address |= (level << (bits_sampled - 1));
+    }
+    if (++bits_sampled == 9) {  // data and parity bits done
+        native_uart_send_address(address);
+    }
+}
+
+void timer_sleep()
+{
+    native_uart_poll(1000000 / TIMER_TICKS_PER_SEC);
+
+    uint32_t now = timer_now();
+    do {
+        _sample_address_line(_ticked);
+        kwp_tick();
+    } while ((int32_t)(now - ++_ticked) > 0);
+    _ticked = now;
+}
+
+void timer_delay_ms(uint16_t ms)
+{
+    uint32_t deadline = timer_now() + TIMER_MS(ms) + 1;
+    while (!timer_expired(deadline)) {
+        timer_sleep();
+    }
+}
@@ -0,0 +1,150 @@
+#include "main.h"
+#include "native.h"
+#include "timer.h"
+#include "uart.h"
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/select.h>
+#include <termios.h>
+#include <unistd.h>
+
+/*************************************************************************
+ * Host UART
+ *
+ * Implements uart.h for the host build.  Bytes sent to UART_KLINE are
+ * written to the pseudo-terminal and also looped back into the receive
+ * buffer, like the echo from the L9637D transceiver on the real K-line.
+ *************************************************************************/
+
+static int _kline_fd = -1;
+static uart_ringbuffer_t _kline_rx;
+
+int native_uart_open(const char *path)
+{
+    _kline_fd = open(path, O_RDWR | O_NOCTTY | O_NONBLOCK);
+    if (_kline_fd < 0) { return -1; }
+
+    struct termios tio;
+    if (tcgetattr(_kline_fd, &tio) == 0) {
+        cfmakeraw(&tio);
+        tcsetattr(_kline_fd, TCSANOW, &tio);
+    }
+    return 0;
+}
+
+static void _rx_write(uint8_t c)
+{
+    _kline_rx.data[_kline_rx.write_index++] = c;
+}
+
+// Move any bytes from the pseudo-terminal into the receive buffer,
+// waiting up to timeout_us for the first one
+void native_uart_poll(uint32_t timeout_us)
+{
+    fd_set fds;
+    FD_ZERO(&fds);
+    FD_SET(_kline_fd, &fds);
+    struct timeval tv = { timeout_us / 1000000, timeout_us % 1000000 };
+    if (select(_kline_fd + 1, &fds, NULL, NULL, &tv) <= 0) { return; }
+
+    uint8_t buf[64];
+    ssize_t size = read(_kline_fd, buf, sizeof(buf));
+    for (ssize_t i=0; i<size; i++) {
+        _rx_write(buf[i]);
+    }
+}
+
+// The 5 baud address has been sampled off the line (see timer.c).
+// It is sent as an ordinary byte; the simulator treats the first byte
+// it receives while disconnected as the address.
+void native_uart_send_address(uint8_t address)
+{
+    if (write(_kline_fd, &address, 1) != 1) { exit(1); }
+}
+
+// The receive buffer is not cleared: the AVR receiver is off until
+// uart_init() is called again after the sync byte is timed, but here
+// the bytes after 0x55 may already have been read from the pty.
+void uart_init(uart_num_t uartnum, uint32_t baud)
+{
+}
+
+void uart_put(uart_num_t uartnum, uint8_t c)
+{
+    if (uartnum == UART_KLINE) {
+        if (write(_kline_fd, &c, 1) != 1) { exit(1); }
+        _rx_write(c);   // echo
+    } else if (!native_quiet) {
+        putchar(c);
+    }
+}
+
+// stdout never makes uart_put() wait
+uint8_t uart_tx_free(uart_num_t uartnum)
+{
+    return 0xFF;
+}
+
+void uart_put16(uart_num_t uartnum, uint16_t w)
+{
+    uart_put(uartnum, w & 0x00FF);
+    uart_put(uartnum, (w & 0xFF00) >> 8);
+}
+
+void uart_puts(uart_num_t uartnum, char *str)
+{
+    while (*str != '\0') {
+        uart_put(uartnum, *str);
+        str++;
+    }
+}
+
+void uart_puthex(uart_num_t uartnum, uint8_t c)
+{
+    const char *digits = "0123456789ABCDEF";
+    uart_put(uartnum, digits[c >> 4]);
+    uart_put(uartnum, digits[c & 0x0f]);
+}
+
+void uart_puthex16(uart_num_t uartnum, uint16_t w)
+{
+    uart_puthex(uartnum, (w & 0xff00) >> 8);
+    uart_puthex(uartnum, (w & 0x00ff));
+}
+
+void uart_flush_tx(uart_num_t uartnum)
+{
+    if (uartnum == UART_DEBUG) { fflush(stdout); }
+}
+
+void uart_blocking_put(uart_num_t uartnum, uint8_t c)
+{
+    uart_put(uartnum, c);
+}
+
+uart_status_t uart_rx_ready(uart_num_t uartnum)
+{
+    if (uartnum != UART_KLINE) { return UART_NOT_READY; }
+    if (_kline_rx.read_index != _kline_rx.write_index) { return UART_READY; }
+    return UART_NOT_READY;
+}
+
+uint8_t uart_blocking_get(uart_num_t uartnum)
+{
+    while (uart_rx_ready(uartnum) == UART_NOT_READY) {
+        timer_sleep();
+    }
+    return _kline_rx.data[_kline_rx.read_index++];
+}
+
+uart_status_t uart_blocking_get_with_timeout(uart_num_t uartnum, uint16_t timeout_ms, uint8_t *rx_byte_out)
+{
+    uint32_t deadline = timer_now() + TIMER_MS(timeout_ms);
+    while (uart_rx_ready(uartnum) == UART_NOT_READY) {
+        if (timer_expired(deadline)) { return UART_NOT_READY; }
+        timer_sleep();
+    }
+    *rx_byte_out = uart_blocking_get(uartnum);
+    return UART_READY;
+}
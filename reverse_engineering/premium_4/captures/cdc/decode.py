@@ -1,51 +1,93 @@
 '''
-Usage: %s <filename>
+Reads one or more logic analyzer CSV exports of the CD changer SPI
+bus and prints a timeline of (time, cd, track, mm:ss) changes.  The
+captures are streamed a line at a time so all tracks can be decoded
+in one run, e.g. "decode.py track*.csv.gz".
+
+Usage: %s <file.csv|file.csv.gz> [file.csv|file.csv.gz ...]
 '''
 
 import gzip
-import re
 import sys
 
-def read_file(filename):
-    # parse csv into byte stream
-    lines = [ l.strip() for l in gzip.open(filename, 'rt').readlines() ]
-    byte_stream = []
-    for line in lines:
-        matches = re.findall('\(0x(.{2})\)$', line)
-        if matches:
-            byte_stream.append(int(matches[0], 16))
-
-    # parse byte stream into packets
-    packets = []
+START_OF_FRAME = 0x34
+END_OF_FRAME = 0x3c
+FRAME_LENGTH = 8
+
+def read_bytes(f):
+    '''Yield (time, byte) for each SPI line in a capture file'''
+    for line in f:
+        # lines end with a hex value like "(0x3C)"
+        paren = line.rfind('(0x')
+        if paren == -1:
+            continue # heading or non-data line
+        try:
+            time = float(line[:line.index(',')])
+            byte = int(line[paren+3:paren+5], 16)
+        except ValueError:
+            continue
+        yield time, byte
+
+def read_packets(byte_stream):
+    '''Yield (time, packet) for each complete frame, dropping packets that
+    are identical to the one before them.  The time is that of the start
+    of frame byte.'''
+    last_packet = None
     current_packet = []
+    packet_time = None
     last_byte = None
-    for byte in byte_stream:
-        if (byte == 0x34) and (last_byte == 0x3c): # 0x34 = start of frame
-            current_packet = [0x34]
+    for time, byte in byte_stream:
+        if (byte == START_OF_FRAME) and (last_byte in (None, END_OF_FRAME)):
+            current_packet = [byte]
+            packet_time = time
         else:
             current_packet.append(byte)
-            if (byte == 0x3c) and (len(current_packet) == 8): # 0x3c = end of frame
-                if (len(packets) == 0) or (packets[-1] != current_packet):
-                    packets.append(current_packet)
+            if (byte == END_OF_FRAME) and (len(current_packet) == FRAME_LENGTH):
+                if current_packet != last_packet:
+                    yield packet_time, current_packet
+                    last_packet = current_packet
+                current_packet = []
         last_byte = byte
 
-    def inverted_bcd(byte):
-        try:
-            return int(hex(0xff - byte)[2:])
-        except ValueError:
-            return 0
+def inverted_bcd(byte):
+    try:
+        return int(hex(0xff - byte)[2:])
+    except ValueError:
+        return 0
 
-    for packet in packets:
-        cd = inverted_bcd(packet[1] | 0xf0)
-        track = inverted_bcd(packet[2])
-        minutes = inverted_bcd(packet[3])
-        seconds = inverted_bcd(packet[4])
+def decode_packet(packet):
+    '''Return (cd, track, minutes, seconds) for a packet'''
+    cd = inverted_bcd(packet[1] | 0xf0)
+    track = inverted_bcd(packet[2])
+    minutes = inverted_bcd(packet[3])
+    seconds = inverted_bcd(packet[4])
+    return cd, track, minutes, seconds
 
-        desc = "cd = %d, track = %d, time = %02d:%02d" % (cd, track, minutes, seconds)
-        print("[%s] %s" % (''.join(['%02x' % byte for byte in packet]), desc))
+def timeline(packets):
+    '''Yield (time, packet, decoded) only when the decoded status changes'''
+    last_decoded = None
+    for time, packet in packets:
+        decoded = decode_packet(packet)
+        if decoded != last_decoded:
+            yield time, packet, decoded
+            last_decoded = decoded
+
+def read_file(filename):
+    opener = gzip.open if filename.endswith('.gz') else open
+    with opener(filename, 'rt') as f:
+        packets = read_packets(read_bytes(f))
+        for time, packet, decoded in timeline(packets):
+            desc = "cd = %d, track = %d, time = %02d:%02d" % decoded
+            hexdump = ''.join(['%02x' % byte for byte in packet])
+            print("%0.6f [%s] %s" % (time, hexdump, desc))
 
 if __name__ == '__main__':
-    if len(sys.argv) != 2:
+    if len(sys.argv) < 2:
         sys.stderr.write((__doc__.strip() + '\n') % sys.argv[0])
         sys.exit(1)
-    read_file(sys.argv[1])
+    for i, filename in enumerate(sys.argv[1:]):
+        if len(sys.argv) > 2:
+            if i > 0:
+                print('')
+            print("# %s" % filename)
+        read_file(filename)
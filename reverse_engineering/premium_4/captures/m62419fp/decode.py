@@ -30,7 +30,8 @@ tone_to_db = (None, -2, -10, 6, None, 2, -6, 10,  # None = undefined
 fade_to_db = (-100, -10, -20, -3, -45, -6, -14, -1,  # -100 = infinity
                -60,  -8, -16, -2, -30, -4, -12,  0)
 
-def read_file(filename):
+def read_commands(filename):
+    '''Yields (seconds, command) for each 14-bit command in the capture'''
     opener = gzip.open if filename.endswith('.gz') else open
     with opener(filename, 'rt') as f:
         headings = [ col.strip() for col in f.readline().split(',') ]
@@ -46,10 +47,14 @@ def read_file(filename):
                 command = command | data
                 bit += 1
                 if bit == 14:
-                    display_command(command)
+                    yield float(row['Time[s]']), command
                     command, bit = 0, 0
             last_clock = clock
 
+def read_file(filename):
+    for secs, command in read_commands(filename):
+        display_command(command)
+
 def display_command(command):
     b = bin(command)[2:] # skip "0b" prefix
     b = b.rjust(16, '0') # pad leading zeros
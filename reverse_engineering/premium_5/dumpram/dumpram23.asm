@@ -1,4 +1,6 @@
-;Patched version of software23 that dumps RAM out UART on reset
+;Patched version of software23 that dumps RAM out UART on reset,
+;then streams the parts of RAM that change while it runs, or watches
+;RAM for triggers set by the host
 
     org 00000h
 
@@ -411,14 +413,14 @@
     dw sub_0d75             ;0010  75 0d       VECTOR INTP5
     dw lab_593b             ;0012  3b 59       VECTOR INTP6
     dw lab_883a             ;0014  3a 88       VECTOR INTP7
-    dw lab_32df             ;0016  df 32       VECTOR INTSER0
-    dw lab_30e8             ;0018  e8 30       VECTOR INTSR0
-    dw lab_307e             ;001a  7e 30       VECTOR INTST0
+    dw stream_sr            ;0016  df 32       VECTOR INTSER0
+    dw stream_sr            ;0018  e8 30       VECTOR INTSR0
+    dw stream_st            ;001a  7e 30       VECTOR INTST0
     dw lab_08a9             ;001c  a9 08       VECTOR INTCSI30
     dw lab_08f7             ;001e  f7 08       VECTOR INTCSI31
     dw sub_0d75             ;0020  75 0d       VECTOR INTIIC0
     dw sub_0d75             ;0022  75 0d       VECTOR INTC2
-    dw lab_0135             ;0024  35 01       VECTOR INTWTNI0
+    dw stream_tick          ;0024  35 01       VECTOR INTWTNI0
     dw lab_3b2b             ;0026  2b 3b       VECTOR INTTM000
     dw sub_0d75             ;0028  75 0d       VECTOR INTTM010
     dw sub_0d75             ;002a  75 0d       VECTOR INTTM001
@@ -54133,776 +54135,10 @@ sub_dadd:
     db 0bfh                 ;ebfd  bf          DATA 0xbf
     db 0bfh                 ;ebfe  bf          DATA 0xbf
     db 0bfh                 ;ebff  bf          DATA 0xbf
-    db 0bfh                 ;ec00  bf          DATA 0xbf
-    db 0bfh                 ;ec01  bf          DATA 0xbf
-    db 0bfh                 ;ec02  bf          DATA 0xbf
-    db 0bfh                 ;ec03  bf          DATA 0xbf
-    db 0bfh                 ;ec04  bf          DATA 0xbf
-    db 0bfh                 ;ec05  bf          DATA 0xbf
-    db 0bfh                 ;ec06  bf          DATA 0xbf
-    db 0bfh                 ;ec07  bf          DATA 0xbf
-    db 0bfh                 ;ec08  bf          DATA 0xbf
-    db 0bfh                 ;ec09  bf          DATA 0xbf
-    db 0bfh                 ;ec0a  bf          DATA 0xbf
-    db 0bfh                 ;ec0b  bf          DATA 0xbf
-    db 0bfh                 ;ec0c  bf          DATA 0xbf
-    db 0bfh                 ;ec0d  bf          DATA 0xbf
-    db 0bfh                 ;ec0e  bf          DATA 0xbf
-    db 0bfh                 ;ec0f  bf          DATA 0xbf
-    db 0bfh                 ;ec10  bf          DATA 0xbf
-    db 0bfh                 ;ec11  bf          DATA 0xbf
-    db 0bfh                 ;ec12  bf          DATA 0xbf
-    db 0bfh                 ;ec13  bf          DATA 0xbf
-    db 0bfh                 ;ec14  bf          DATA 0xbf
-    db 0bfh                 ;ec15  bf          DATA 0xbf
-    db 0bfh                 ;ec16  bf          DATA 0xbf
-    db 0bfh                 ;ec17  bf          DATA 0xbf
-    db 0bfh                 ;ec18  bf          DATA 0xbf
-    db 0bfh                 ;ec19  bf          DATA 0xbf
-    db 0bfh                 ;ec1a  bf          DATA 0xbf
-    db 0bfh                 ;ec1b  bf          DATA 0xbf
-    db 0bfh                 ;ec1c  bf          DATA 0xbf
-    db 0bfh                 ;ec1d  bf          DATA 0xbf
-    db 0bfh                 ;ec1e  bf          DATA 0xbf
-    db 0bfh                 ;ec1f  bf          DATA 0xbf
-    db 0bfh                 ;ec20  bf          DATA 0xbf
-    db 0bfh                 ;ec21  bf          DATA 0xbf
-    db 0bfh                 ;ec22  bf          DATA 0xbf
-    db 0bfh                 ;ec23  bf          DATA 0xbf
-    db 0bfh                 ;ec24  bf          DATA 0xbf
-    db 0bfh                 ;ec25  bf          DATA 0xbf
-    db 0bfh                 ;ec26  bf          DATA 0xbf
-    db 0bfh                 ;ec27  bf          DATA 0xbf
-    db 0bfh                 ;ec28  bf          DATA 0xbf
-    db 0bfh                 ;ec29  bf          DATA 0xbf
-    db 0bfh                 ;ec2a  bf          DATA 0xbf
-    db 0bfh                 ;ec2b  bf          DATA 0xbf
-    db 0bfh                 ;ec2c  bf          DATA 0xbf
-    db 0bfh                 ;ec2d  bf          DATA 0xbf
-    db 0bfh                 ;ec2e  bf          DATA 0xbf
-    db 0bfh                 ;ec2f  bf          DATA 0xbf
-    db 0bfh                 ;ec30  bf          DATA 0xbf
-    db 0bfh                 ;ec31  bf          DATA 0xbf
-    db 0bfh                 ;ec32  bf          DATA 0xbf
-    db 0bfh                 ;ec33  bf          DATA 0xbf
-    db 0bfh                 ;ec34  bf          DATA 0xbf
-    db 0bfh                 ;ec35  bf          DATA 0xbf
-    db 0bfh                 ;ec36  bf          DATA 0xbf
-    db 0bfh                 ;ec37  bf          DATA 0xbf
-    db 0bfh                 ;ec38  bf          DATA 0xbf
-    db 0bfh                 ;ec39  bf          DATA 0xbf
-    db 0bfh                 ;ec3a  bf          DATA 0xbf
-    db 0bfh                 ;ec3b  bf          DATA 0xbf
-    db 0bfh                 ;ec3c  bf          DATA 0xbf
-    db 0bfh                 ;ec3d  bf          DATA 0xbf
-    db 0bfh                 ;ec3e  bf          DATA 0xbf
-    db 0bfh                 ;ec3f  bf          DATA 0xbf
-    db 0bfh                 ;ec40  bf          DATA 0xbf
-    db 0bfh                 ;ec41  bf          DATA 0xbf
-    db 0bfh                 ;ec42  bf          DATA 0xbf
-    db 0bfh                 ;ec43  bf          DATA 0xbf
-    db 0bfh                 ;ec44  bf          DATA 0xbf
-    db 0bfh                 ;ec45  bf          DATA 0xbf
-    db 0bfh                 ;ec46  bf          DATA 0xbf
-    db 0bfh                 ;ec47  bf          DATA 0xbf
-    db 0bfh                 ;ec48  bf          DATA 0xbf
-    db 0bfh                 ;ec49  bf          DATA 0xbf
-    db 0bfh                 ;ec4a  bf          DATA 0xbf
-    db 0bfh                 ;ec4b  bf          DATA 0xbf
-    db 0bfh                 ;ec4c  bf          DATA 0xbf
-    db 0bfh                 ;ec4d  bf          DATA 0xbf
-    db 0bfh                 ;ec4e  bf          DATA 0xbf
-    db 0bfh                 ;ec4f  bf          DATA 0xbf
-    db 0bfh                 ;ec50  bf          DATA 0xbf
-    db 0bfh                 ;ec51  bf          DATA 0xbf
-    db 0bfh                 ;ec52  bf          DATA 0xbf
-    db 0bfh                 ;ec53  bf          DATA 0xbf
-    db 0bfh                 ;ec54  bf          DATA 0xbf
-    db 0bfh                 ;ec55  bf          DATA 0xbf
-    db 0bfh                 ;ec56  bf          DATA 0xbf
-    db 0bfh                 ;ec57  bf          DATA 0xbf
-    db 0bfh                 ;ec58  bf          DATA 0xbf
-    db 0bfh                 ;ec59  bf          DATA 0xbf
-    db 0bfh                 ;ec5a  bf          DATA 0xbf
-    db 0bfh                 ;ec5b  bf          DATA 0xbf
-    db 0bfh                 ;ec5c  bf          DATA 0xbf
-    db 0bfh                 ;ec5d  bf          DATA 0xbf
-    db 0bfh                 ;ec5e  bf          DATA 0xbf
-    db 0bfh                 ;ec5f  bf          DATA 0xbf
-    db 0bfh                 ;ec60  bf          DATA 0xbf
-    db 0bfh                 ;ec61  bf          DATA 0xbf
-    db 0bfh                 ;ec62  bf          DATA 0xbf
-    db 0bfh                 ;ec63  bf          DATA 0xbf
-    db 0bfh                 ;ec64  bf          DATA 0xbf
-    db 0bfh                 ;ec65  bf          DATA 0xbf
-    db 0bfh                 ;ec66  bf          DATA 0xbf
-    db 0bfh                 ;ec67  bf          DATA 0xbf
-    db 0bfh                 ;ec68  bf          DATA 0xbf
-    db 0bfh                 ;ec69  bf          DATA 0xbf
-    db 0bfh                 ;ec6a  bf          DATA 0xbf
-    db 0bfh                 ;ec6b  bf          DATA 0xbf
-    db 0bfh                 ;ec6c  bf          DATA 0xbf
-    db 0bfh                 ;ec6d  bf          DATA 0xbf
-    db 0bfh                 ;ec6e  bf          DATA 0xbf
-    db 0bfh                 ;ec6f  bf          DATA 0xbf
-    db 0bfh                 ;ec70  bf          DATA 0xbf
-    db 0bfh                 ;ec71  bf          DATA 0xbf
-    db 0bfh                 ;ec72  bf          DATA 0xbf
-    db 0bfh                 ;ec73  bf          DATA 0xbf
-    db 0bfh                 ;ec74  bf          DATA 0xbf
-    db 0bfh                 ;ec75  bf          DATA 0xbf
-    db 0bfh                 ;ec76  bf          DATA 0xbf
-    db 0bfh                 ;ec77  bf          DATA 0xbf
-    db 0bfh                 ;ec78  bf          DATA 0xbf
-    db 0bfh                 ;ec79  bf          DATA 0xbf
-    db 0bfh                 ;ec7a  bf          DATA 0xbf
-    db 0bfh                 ;ec7b  bf          DATA 0xbf
-    db 0bfh                 ;ec7c  bf          DATA 0xbf
-    db 0bfh                 ;ec7d  bf          DATA 0xbf
-    db 0bfh                 ;ec7e  bf          DATA 0xbf
-    db 0bfh                 ;ec7f  bf          DATA 0xbf
-    db 0bfh                 ;ec80  bf          DATA 0xbf
-    db 0bfh                 ;ec81  bf          DATA 0xbf
-    db 0bfh                 ;ec82  bf          DATA 0xbf
-    db 0bfh                 ;ec83  bf          DATA 0xbf
-    db 0bfh                 ;ec84  bf          DATA 0xbf
-    db 0bfh                 ;ec85  bf          DATA 0xbf
-    db 0bfh                 ;ec86  bf          DATA 0xbf
-    db 0bfh                 ;ec87  bf          DATA 0xbf
-    db 0bfh                 ;ec88  bf          DATA 0xbf
-    db 0bfh                 ;ec89  bf          DATA 0xbf
-    db 0bfh                 ;ec8a  bf          DATA 0xbf
-    db 0bfh                 ;ec8b  bf          DATA 0xbf
-    db 0bfh                 ;ec8c  bf          DATA 0xbf
-    db 0bfh                 ;ec8d  bf          DATA 0xbf
-    db 0bfh                 ;ec8e  bf          DATA 0xbf
-    db 0bfh                 ;ec8f  bf          DATA 0xbf
-    db 0bfh                 ;ec90  bf          DATA 0xbf
-    db 0bfh                 ;ec91  bf          DATA 0xbf
-    db 0bfh                 ;ec92  bf          DATA 0xbf
-    db 0bfh                 ;ec93  bf          DATA 0xbf
-    db 0bfh                 ;ec94  bf          DATA 0xbf
-    db 0bfh                 ;ec95  bf          DATA 0xbf
-    db 0bfh                 ;ec96  bf          DATA 0xbf
-    db 0bfh                 ;ec97  bf          DATA 0xbf
-    db 0bfh                 ;ec98  bf          DATA 0xbf
-    db 0bfh                 ;ec99  bf          DATA 0xbf
-    db 0bfh                 ;ec9a  bf          DATA 0xbf
-    db 0bfh                 ;ec9b  bf          DATA 0xbf
-    db 0bfh                 ;ec9c  bf          DATA 0xbf
-    db 0bfh                 ;ec9d  bf          DATA 0xbf
-    db 0bfh                 ;ec9e  bf          DATA 0xbf
-    db 0bfh                 ;ec9f  bf          DATA 0xbf
-    db 0bfh                 ;eca0  bf          DATA 0xbf
-    db 0bfh                 ;eca1  bf          DATA 0xbf
-    db 0bfh                 ;eca2  bf          DATA 0xbf
-    db 0bfh                 ;eca3  bf          DATA 0xbf
-    db 0bfh                 ;eca4  bf          DATA 0xbf
-    db 0bfh                 ;eca5  bf          DATA 0xbf
-    db 0bfh                 ;eca6  bf          DATA 0xbf
-    db 0bfh                 ;eca7  bf          DATA 0xbf
-    db 0bfh                 ;eca8  bf          DATA 0xbf
-    db 0bfh                 ;eca9  bf          DATA 0xbf
-    db 0bfh                 ;ecaa  bf          DATA 0xbf
-    db 0bfh                 ;ecab  bf          DATA 0xbf
-    db 0bfh                 ;ecac  bf          DATA 0xbf
-    db 0bfh                 ;ecad  bf          DATA 0xbf
-    db 0bfh                 ;ecae  bf          DATA 0xbf
-    db 0bfh                 ;ecaf  bf          DATA 0xbf
-    db 0bfh                 ;ecb0  bf          DATA 0xbf
-    db 0bfh                 ;ecb1  bf          DATA 0xbf
-    db 0bfh                 ;ecb2  bf          DATA 0xbf
-    db 0bfh                 ;ecb3  bf          DATA 0xbf
-    db 0bfh                 ;ecb4  bf          DATA 0xbf
-    db 0bfh                 ;ecb5  bf          DATA 0xbf
-    db 0bfh                 ;ecb6  bf          DATA 0xbf
-    db 0bfh                 ;ecb7  bf          DATA 0xbf
-    db 0bfh                 ;ecb8  bf          DATA 0xbf
-    db 0bfh                 ;ecb9  bf          DATA 0xbf
-    db 0bfh                 ;ecba  bf          DATA 0xbf
-    db 0bfh                 ;ecbb  bf          DATA 0xbf
-    db 0bfh                 ;ecbc  bf          DATA 0xbf
-    db 0bfh                 ;ecbd  bf          DATA 0xbf
-    db 0bfh                 ;ecbe  bf          DATA 0xbf
-    db 0bfh                 ;ecbf  bf          DATA 0xbf
-    db 0bfh                 ;ecc0  bf          DATA 0xbf
-    db 0bfh                 ;ecc1  bf          DATA 0xbf
-    db 0bfh                 ;ecc2  bf          DATA 0xbf
-    db 0bfh                 ;ecc3  bf          DATA 0xbf
-    db 0bfh                 ;ecc4  bf          DATA 0xbf
-    db 0bfh                 ;ecc5  bf          DATA 0xbf
-    db 0bfh                 ;ecc6  bf          DATA 0xbf
-    db 0bfh                 ;ecc7  bf          DATA 0xbf
-    db 0bfh                 ;ecc8  bf          DATA 0xbf
-    db 0bfh                 ;ecc9  bf          DATA 0xbf
-    db 0bfh                 ;ecca  bf          DATA 0xbf
-    db 0bfh                 ;eccb  bf          DATA 0xbf
-    db 0bfh                 ;eccc  bf          DATA 0xbf
-    db 0bfh                 ;eccd  bf          DATA 0xbf
-    db 0bfh                 ;ecce  bf          DATA 0xbf
-    db 0bfh                 ;eccf  bf          DATA 0xbf
-    db 0bfh                 ;ecd0  bf          DATA 0xbf
-    db 0bfh                 ;ecd1  bf          DATA 0xbf
-    db 0bfh                 ;ecd2  bf          DATA 0xbf
-    db 0bfh                 ;ecd3  bf          DATA 0xbf
-    db 0bfh                 ;ecd4  bf          DATA 0xbf
-    db 0bfh                 ;ecd5  bf          DATA 0xbf
-    db 0bfh                 ;ecd6  bf          DATA 0xbf
-    db 0bfh                 ;ecd7  bf          DATA 0xbf
-    db 0bfh                 ;ecd8  bf          DATA 0xbf
-    db 0bfh                 ;ecd9  bf          DATA 0xbf
-    db 0bfh                 ;ecda  bf          DATA 0xbf
-    db 0bfh                 ;ecdb  bf          DATA 0xbf
-    db 0bfh                 ;ecdc  bf          DATA 0xbf
-    db 0bfh                 ;ecdd  bf          DATA 0xbf
-    db 0bfh                 ;ecde  bf          DATA 0xbf
-    db 0bfh                 ;ecdf  bf          DATA 0xbf
-    db 0bfh                 ;ece0  bf          DATA 0xbf
-    db 0bfh                 ;ece1  bf          DATA 0xbf
-    db 0bfh                 ;ece2  bf          DATA 0xbf
-    db 0bfh                 ;ece3  bf          DATA 0xbf
-    db 0bfh                 ;ece4  bf          DATA 0xbf
-    db 0bfh                 ;ece5  bf          DATA 0xbf
-    db 0bfh                 ;ece6  bf          DATA 0xbf
-    db 0bfh                 ;ece7  bf          DATA 0xbf
-    db 0bfh                 ;ece8  bf          DATA 0xbf
-    db 0bfh                 ;ece9  bf          DATA 0xbf
-    db 0bfh                 ;ecea  bf          DATA 0xbf
-    db 0bfh                 ;eceb  bf          DATA 0xbf
-    db 0bfh                 ;ecec  bf          DATA 0xbf
-    db 0bfh                 ;eced  bf          DATA 0xbf
-    db 0bfh                 ;ecee  bf          DATA 0xbf
-    db 0bfh                 ;ecef  bf          DATA 0xbf
-    db 0bfh                 ;ecf0  bf          DATA 0xbf
-    db 0bfh                 ;ecf1  bf          DATA 0xbf
-    db 0bfh                 ;ecf2  bf          DATA 0xbf
-    db 0bfh                 ;ecf3  bf          DATA 0xbf
-    db 0bfh                 ;ecf4  bf          DATA 0xbf
-    db 0bfh                 ;ecf5  bf          DATA 0xbf
-    db 0bfh                 ;ecf6  bf          DATA 0xbf
-    db 0bfh                 ;ecf7  bf          DATA 0xbf
-    db 0bfh                 ;ecf8  bf          DATA 0xbf
-    db 0bfh                 ;ecf9  bf          DATA 0xbf
-    db 0bfh                 ;ecfa  bf          DATA 0xbf
-    db 0bfh                 ;ecfb  bf          DATA 0xbf
-    db 0bfh                 ;ecfc  bf          DATA 0xbf
-    db 0bfh                 ;ecfd  bf          DATA 0xbf
-    db 0bfh                 ;ecfe  bf          DATA 0xbf
-    db 0bfh                 ;ecff  bf          DATA 0xbf
-    db 0bfh                 ;ed00  bf          DATA 0xbf
-    db 0bfh                 ;ed01  bf          DATA 0xbf
-    db 0bfh                 ;ed02  bf          DATA 0xbf
-    db 0bfh                 ;ed03  bf          DATA 0xbf
-    db 0bfh                 ;ed04  bf          DATA 0xbf
-    db 0bfh                 ;ed05  bf          DATA 0xbf
-    db 0bfh                 ;ed06  bf          DATA 0xbf
-    db 0bfh                 ;ed07  bf          DATA 0xbf
-    db 0bfh                 ;ed08  bf          DATA 0xbf
-    db 0bfh                 ;ed09  bf          DATA 0xbf
-    db 0bfh                 ;ed0a  bf          DATA 0xbf
-    db 0bfh                 ;ed0b  bf          DATA 0xbf
-    db 0bfh                 ;ed0c  bf          DATA 0xbf
-    db 0bfh                 ;ed0d  bf          DATA 0xbf
-    db 0bfh                 ;ed0e  bf          DATA 0xbf
-    db 0bfh                 ;ed0f  bf          DATA 0xbf
-    db 0bfh                 ;ed10  bf          DATA 0xbf
-    db 0bfh                 ;ed11  bf          DATA 0xbf
-    db 0bfh                 ;ed12  bf          DATA 0xbf
-    db 0bfh                 ;ed13  bf          DATA 0xbf
-    db 0bfh                 ;ed14  bf          DATA 0xbf
-    db 0bfh                 ;ed15  bf          DATA 0xbf
-    db 0bfh                 ;ed16  bf          DATA 0xbf
-    db 0bfh                 ;ed17  bf          DATA 0xbf
-    db 0bfh                 ;ed18  bf          DATA 0xbf
-    db 0bfh                 ;ed19  bf          DATA 0xbf
-    db 0bfh                 ;ed1a  bf          DATA 0xbf
-    db 0bfh                 ;ed1b  bf          DATA 0xbf
-    db 0bfh                 ;ed1c  bf          DATA 0xbf
-    db 0bfh                 ;ed1d  bf          DATA 0xbf
-    db 0bfh                 ;ed1e  bf          DATA 0xbf
-    db 0bfh                 ;ed1f  bf          DATA 0xbf
-    db 0bfh                 ;ed20  bf          DATA 0xbf
-    db 0bfh                 ;ed21  bf          DATA 0xbf
-    db 0bfh                 ;ed22  bf          DATA 0xbf
-    db 0bfh                 ;ed23  bf          DATA 0xbf
-    db 0bfh                 ;ed24  bf          DATA 0xbf
-    db 0bfh                 ;ed25  bf          DATA 0xbf
-    db 0bfh                 ;ed26  bf          DATA 0xbf
-    db 0bfh                 ;ed27  bf          DATA 0xbf
-    db 0bfh                 ;ed28  bf          DATA 0xbf
-    db 0bfh                 ;ed29  bf          DATA 0xbf
-    db 0bfh                 ;ed2a  bf          DATA 0xbf
-    db 0bfh                 ;ed2b  bf          DATA 0xbf
-    db 0bfh                 ;ed2c  bf          DATA 0xbf
-    db 0bfh                 ;ed2d  bf          DATA 0xbf
-    db 0bfh                 ;ed2e  bf          DATA 0xbf
-    db 0bfh                 ;ed2f  bf          DATA 0xbf
-    db 0bfh                 ;ed30  bf          DATA 0xbf
-    db 0bfh                 ;ed31  bf          DATA 0xbf
-    db 0bfh                 ;ed32  bf          DATA 0xbf
-    db 0bfh                 ;ed33  bf          DATA 0xbf
-    db 0bfh                 ;ed34  bf          DATA 0xbf
-    db 0bfh                 ;ed35  bf          DATA 0xbf
-    db 0bfh                 ;ed36  bf          DATA 0xbf
-    db 0bfh                 ;ed37  bf          DATA 0xbf
-    db 0bfh                 ;ed38  bf          DATA 0xbf
-    db 0bfh                 ;ed39  bf          DATA 0xbf
-    db 0bfh                 ;ed3a  bf          DATA 0xbf
-    db 0bfh                 ;ed3b  bf          DATA 0xbf
-    db 0bfh                 ;ed3c  bf          DATA 0xbf
-    db 0bfh                 ;ed3d  bf          DATA 0xbf
-    db 0bfh                 ;ed3e  bf          DATA 0xbf
-    db 0bfh                 ;ed3f  bf          DATA 0xbf
-    db 0bfh                 ;ed40  bf          DATA 0xbf
-    db 0bfh                 ;ed41  bf          DATA 0xbf
-    db 0bfh                 ;ed42  bf          DATA 0xbf
-    db 0bfh                 ;ed43  bf          DATA 0xbf
-    db 0bfh                 ;ed44  bf          DATA 0xbf
-    db 0bfh                 ;ed45  bf          DATA 0xbf
-    db 0bfh                 ;ed46  bf          DATA 0xbf
-    db 0bfh                 ;ed47  bf          DATA 0xbf
-    db 0bfh                 ;ed48  bf          DATA 0xbf
-    db 0bfh                 ;ed49  bf          DATA 0xbf
-    db 0bfh                 ;ed4a  bf          DATA 0xbf
-    db 0bfh                 ;ed4b  bf          DATA 0xbf
-    db 0bfh                 ;ed4c  bf          DATA 0xbf
-    db 0bfh                 ;ed4d  bf          DATA 0xbf
-    db 0bfh                 ;ed4e  bf          DATA 0xbf
-    db 0bfh                 ;ed4f  bf          DATA 0xbf
-    db 0bfh                 ;ed50  bf          DATA 0xbf
-    db 0bfh                 ;ed51  bf          DATA 0xbf
-    db 0bfh                 ;ed52  bf          DATA 0xbf
-    db 0bfh                 ;ed53  bf          DATA 0xbf
-    db 0bfh                 ;ed54  bf          DATA 0xbf
-    db 0bfh                 ;ed55  bf          DATA 0xbf
-    db 0bfh                 ;ed56  bf          DATA 0xbf
-    db 0bfh                 ;ed57  bf          DATA 0xbf
-    db 0bfh                 ;ed58  bf          DATA 0xbf
-    db 0bfh                 ;ed59  bf          DATA 0xbf
-    db 0bfh                 ;ed5a  bf          DATA 0xbf
-    db 0bfh                 ;ed5b  bf          DATA 0xbf
-    db 0bfh                 ;ed5c  bf          DATA 0xbf
-    db 0bfh                 ;ed5d  bf          DATA 0xbf
-    db 0bfh                 ;ed5e  bf          DATA 0xbf
-    db 0bfh                 ;ed5f  bf          DATA 0xbf
-    db 0bfh                 ;ed60  bf          DATA 0xbf
-    db 0bfh                 ;ed61  bf          DATA 0xbf
-    db 0bfh                 ;ed62  bf          DATA 0xbf
-    db 0bfh                 ;ed63  bf          DATA 0xbf
-    db 0bfh                 ;ed64  bf          DATA 0xbf
-    db 0bfh                 ;ed65  bf          DATA 0xbf
-    db 0bfh                 ;ed66  bf          DATA 0xbf
-    db 0bfh                 ;ed67  bf          DATA 0xbf
-    db 0bfh                 ;ed68  bf          DATA 0xbf
-    db 0bfh                 ;ed69  bf          DATA 0xbf
-    db 0bfh                 ;ed6a  bf          DATA 0xbf
-    db 0bfh                 ;ed6b  bf          DATA 0xbf
-    db 0bfh                 ;ed6c  bf          DATA 0xbf
-    db 0bfh                 ;ed6d  bf          DATA 0xbf
-    db 0bfh                 ;ed6e  bf          DATA 0xbf
-    db 0bfh                 ;ed6f  bf          DATA 0xbf
-    db 0bfh                 ;ed70  bf          DATA 0xbf
-    db 0bfh                 ;ed71  bf          DATA 0xbf
-    db 0bfh                 ;ed72  bf          DATA 0xbf
-    db 0bfh                 ;ed73  bf          DATA 0xbf
-    db 0bfh                 ;ed74  bf          DATA 0xbf
-    db 0bfh                 ;ed75  bf          DATA 0xbf
-    db 0bfh                 ;ed76  bf          DATA 0xbf
-    db 0bfh                 ;ed77  bf          DATA 0xbf
-    db 0bfh                 ;ed78  bf          DATA 0xbf
-    db 0bfh                 ;ed79  bf          DATA 0xbf
-    db 0bfh                 ;ed7a  bf          DATA 0xbf
-    db 0bfh                 ;ed7b  bf          DATA 0xbf
-    db 0bfh                 ;ed7c  bf          DATA 0xbf
-    db 0bfh                 ;ed7d  bf          DATA 0xbf
-    db 0bfh                 ;ed7e  bf          DATA 0xbf
-    db 0bfh                 ;ed7f  bf          DATA 0xbf
-    db 0bfh                 ;ed80  bf          DATA 0xbf
-    db 0bfh                 ;ed81  bf          DATA 0xbf
-    db 0bfh                 ;ed82  bf          DATA 0xbf
-    db 0bfh                 ;ed83  bf          DATA 0xbf
-    db 0bfh                 ;ed84  bf          DATA 0xbf
-    db 0bfh                 ;ed85  bf          DATA 0xbf
-    db 0bfh                 ;ed86  bf          DATA 0xbf
-    db 0bfh                 ;ed87  bf          DATA 0xbf
-    db 0bfh                 ;ed88  bf          DATA 0xbf
-    db 0bfh                 ;ed89  bf          DATA 0xbf
-    db 0bfh                 ;ed8a  bf          DATA 0xbf
-    db 0bfh                 ;ed8b  bf          DATA 0xbf
-    db 0bfh                 ;ed8c  bf          DATA 0xbf
-    db 0bfh                 ;ed8d  bf          DATA 0xbf
-    db 0bfh                 ;ed8e  bf          DATA 0xbf
-    db 0bfh                 ;ed8f  bf          DATA 0xbf
-    db 0bfh                 ;ed90  bf          DATA 0xbf
-    db 0bfh                 ;ed91  bf          DATA 0xbf
-    db 0bfh                 ;ed92  bf          DATA 0xbf
-    db 0bfh                 ;ed93  bf          DATA 0xbf
-    db 0bfh                 ;ed94  bf          DATA 0xbf
-    db 0bfh                 ;ed95  bf          DATA 0xbf
-    db 0bfh                 ;ed96  bf          DATA 0xbf
-    db 0bfh                 ;ed97  bf          DATA 0xbf
-    db 0bfh                 ;ed98  bf          DATA 0xbf
-    db 0bfh                 ;ed99  bf          DATA 0xbf
-    db 0bfh                 ;ed9a  bf          DATA 0xbf
-    db 0bfh                 ;ed9b  bf          DATA 0xbf
-    db 0bfh                 ;ed9c  bf          DATA 0xbf
-    db 0bfh                 ;ed9d  bf          DATA 0xbf
-    db 0bfh                 ;ed9e  bf          DATA 0xbf
-    db 0bfh                 ;ed9f  bf          DATA 0xbf
-    db 0bfh                 ;eda0  bf          DATA 0xbf
-    db 0bfh                 ;eda1  bf          DATA 0xbf
-    db 0bfh                 ;eda2  bf          DATA 0xbf
-    db 0bfh                 ;eda3  bf          DATA 0xbf
-    db 0bfh                 ;eda4  bf          DATA 0xbf
-    db 0bfh                 ;eda5  bf          DATA 0xbf
-    db 0bfh                 ;eda6  bf          DATA 0xbf
-    db 0bfh                 ;eda7  bf          DATA 0xbf
-    db 0bfh                 ;eda8  bf          DATA 0xbf
-    db 0bfh                 ;eda9  bf          DATA 0xbf
-    db 0bfh                 ;edaa  bf          DATA 0xbf
-    db 0bfh                 ;edab  bf          DATA 0xbf
-    db 0bfh                 ;edac  bf          DATA 0xbf
-    db 0bfh                 ;edad  bf          DATA 0xbf
-    db 0bfh                 ;edae  bf          DATA 0xbf
-    db 0bfh                 ;edaf  bf          DATA 0xbf
-    db 0bfh                 ;edb0  bf          DATA 0xbf
-    db 0bfh                 ;edb1  bf          DATA 0xbf
-    db 0bfh                 ;edb2  bf          DATA 0xbf
-    db 0bfh                 ;edb3  bf          DATA 0xbf
-    db 0bfh                 ;edb4  bf          DATA 0xbf
-    db 0bfh                 ;edb5  bf          DATA 0xbf
-    db 0bfh                 ;edb6  bf          DATA 0xbf
-    db 0bfh                 ;edb7  bf          DATA 0xbf
-    db 0bfh                 ;edb8  bf          DATA 0xbf
-    db 0bfh                 ;edb9  bf          DATA 0xbf
-    db 0bfh                 ;edba  bf          DATA 0xbf
-    db 0bfh                 ;edbb  bf          DATA 0xbf
-    db 0bfh                 ;edbc  bf          DATA 0xbf
-    db 0bfh                 ;edbd  bf          DATA 0xbf
-    db 0bfh                 ;edbe  bf          DATA 0xbf
-    db 0bfh                 ;edbf  bf          DATA 0xbf
-    db 0bfh                 ;edc0  bf          DATA 0xbf
-    db 0bfh                 ;edc1  bf          DATA 0xbf
-    db 0bfh                 ;edc2  bf          DATA 0xbf
-    db 0bfh                 ;edc3  bf          DATA 0xbf
-    db 0bfh                 ;edc4  bf          DATA 0xbf
-    db 0bfh                 ;edc5  bf          DATA 0xbf
-    db 0bfh                 ;edc6  bf          DATA 0xbf
-    db 0bfh                 ;edc7  bf          DATA 0xbf
-    db 0bfh                 ;edc8  bf          DATA 0xbf
-    db 0bfh                 ;edc9  bf          DATA 0xbf
-    db 0bfh                 ;edca  bf          DATA 0xbf
-    db 0bfh                 ;edcb  bf          DATA 0xbf
-    db 0bfh                 ;edcc  bf          DATA 0xbf
-    db 0bfh                 ;edcd  bf          DATA 0xbf
-    db 0bfh                 ;edce  bf          DATA 0xbf
-    db 0bfh                 ;edcf  bf          DATA 0xbf
-    db 0bfh                 ;edd0  bf          DATA 0xbf
-    db 0bfh                 ;edd1  bf          DATA 0xbf
-    db 0bfh                 ;edd2  bf          DATA 0xbf
-    db 0bfh                 ;edd3  bf          DATA 0xbf
-    db 0bfh                 ;edd4  bf          DATA 0xbf
-    db 0bfh                 ;edd5  bf          DATA 0xbf
-    db 0bfh                 ;edd6  bf          DATA 0xbf
-    db 0bfh                 ;edd7  bf          DATA 0xbf
-    db 0bfh                 ;edd8  bf          DATA 0xbf
-    db 0bfh                 ;edd9  bf          DATA 0xbf
-    db 0bfh                 ;edda  bf          DATA 0xbf
-    db 0bfh                 ;eddb  bf          DATA 0xbf
-    db 0bfh                 ;eddc  bf          DATA 0xbf
-    db 0bfh                 ;eddd  bf          DATA 0xbf
-    db 0bfh                 ;edde  bf          DATA 0xbf
-    db 0bfh                 ;eddf  bf          DATA 0xbf
-    db 0bfh                 ;ede0  bf          DATA 0xbf
-    db 0bfh                 ;ede1  bf          DATA 0xbf
-    db 0bfh                 ;ede2  bf          DATA 0xbf
-    db 0bfh                 ;ede3  bf          DATA 0xbf
-    db 0bfh                 ;ede4  bf          DATA 0xbf
-    db 0bfh                 ;ede5  bf          DATA 0xbf
-    db 0bfh                 ;ede6  bf          DATA 0xbf
-    db 0bfh                 ;ede7  bf          DATA 0xbf
-    db 0bfh                 ;ede8  bf          DATA 0xbf
-    db 0bfh                 ;ede9  bf          DATA 0xbf
-    db 0bfh                 ;edea  bf          DATA 0xbf
-    db 0bfh                 ;edeb  bf          DATA 0xbf
-    db 0bfh                 ;edec  bf          DATA 0xbf
-    db 0bfh                 ;eded  bf          DATA 0xbf
-    db 0bfh                 ;edee  bf          DATA 0xbf
-    db 0bfh                 ;edef  bf          DATA 0xbf
-    db 0bfh                 ;edf0  bf          DATA 0xbf
-    db 0bfh                 ;edf1  bf          DATA 0xbf
-    db 0bfh                 ;edf2  bf          DATA 0xbf
-    db 0bfh                 ;edf3  bf          DATA 0xbf
-    db 0bfh                 ;edf4  bf          DATA 0xbf
-    db 0bfh                 ;edf5  bf          DATA 0xbf
-    db 0bfh                 ;edf6  bf          DATA 0xbf
-    db 0bfh                 ;edf7  bf          DATA 0xbf
-    db 0bfh                 ;edf8  bf          DATA 0xbf
-    db 0bfh                 ;edf9  bf          DATA 0xbf
-    db 0bfh                 ;edfa  bf          DATA 0xbf
-    db 0bfh                 ;edfb  bf          DATA 0xbf
-    db 0bfh                 ;edfc  bf          DATA 0xbf
-    db 0bfh                 ;edfd  bf          DATA 0xbf
-    db 0bfh                 ;edfe  bf          DATA 0xbf
-    db 0bfh                 ;edff  bf          DATA 0xbf
-    db 0bfh                 ;ee00  bf          DATA 0xbf
-    db 0bfh                 ;ee01  bf          DATA 0xbf
-    db 0bfh                 ;ee02  bf          DATA 0xbf
-    db 0bfh                 ;ee03  bf          DATA 0xbf
-    db 0bfh                 ;ee04  bf          DATA 0xbf
-    db 0bfh                 ;ee05  bf          DATA 0xbf
-    db 0bfh                 ;ee06  bf          DATA 0xbf
-    db 0bfh                 ;ee07  bf          DATA 0xbf
-    db 0bfh                 ;ee08  bf          DATA 0xbf
-    db 0bfh                 ;ee09  bf          DATA 0xbf
-    db 0bfh                 ;ee0a  bf          DATA 0xbf
-    db 0bfh                 ;ee0b  bf          DATA 0xbf
-    db 0bfh                 ;ee0c  bf          DATA 0xbf
-    db 0bfh                 ;ee0d  bf          DATA 0xbf
-    db 0bfh                 ;ee0e  bf          DATA 0xbf
-    db 0bfh                 ;ee0f  bf          DATA 0xbf
-    db 0bfh                 ;ee10  bf          DATA 0xbf
-    db 0bfh                 ;ee11  bf          DATA 0xbf
-    db 0bfh                 ;ee12  bf          DATA 0xbf
-    db 0bfh                 ;ee13  bf          DATA 0xbf
-    db 0bfh                 ;ee14  bf          DATA 0xbf
-    db 0bfh                 ;ee15  bf          DATA 0xbf
-    db 0bfh                 ;ee16  bf          DATA 0xbf
-    db 0bfh                 ;ee17  bf          DATA 0xbf
-    db 0bfh                 ;ee18  bf          DATA 0xbf
-    db 0bfh                 ;ee19  bf          DATA 0xbf
-    db 0bfh                 ;ee1a  bf          DATA 0xbf
-    db 0bfh                 ;ee1b  bf          DATA 0xbf
-    db 0bfh                 ;ee1c  bf          DATA 0xbf
-    db 0bfh                 ;ee1d  bf          DATA 0xbf
-    db 0bfh                 ;ee1e  bf          DATA 0xbf
-    db 0bfh                 ;ee1f  bf          DATA 0xbf
-    db 0bfh                 ;ee20  bf          DATA 0xbf
-    db 0bfh                 ;ee21  bf          DATA 0xbf
-    db 0bfh                 ;ee22  bf          DATA 0xbf
-    db 0bfh                 ;ee23  bf          DATA 0xbf
-    db 0bfh                 ;ee24  bf          DATA 0xbf
-    db 0bfh                 ;ee25  bf          DATA 0xbf
-    db 0bfh                 ;ee26  bf          DATA 0xbf
-    db 0bfh                 ;ee27  bf          DATA 0xbf
-    db 0bfh                 ;ee28  bf          DATA 0xbf
-    db 0bfh                 ;ee29  bf          DATA 0xbf
-    db 0bfh                 ;ee2a  bf          DATA 0xbf
-    db 0bfh                 ;ee2b  bf          DATA 0xbf
-    db 0bfh                 ;ee2c  bf          DATA 0xbf
-    db 0bfh                 ;ee2d  bf          DATA 0xbf
-    db 0bfh                 ;ee2e  bf          DATA 0xbf
-    db 0bfh                 ;ee2f  bf          DATA 0xbf
-    db 0bfh                 ;ee30  bf          DATA 0xbf
-    db 0bfh                 ;ee31  bf          DATA 0xbf
-    db 0bfh                 ;ee32  bf          DATA 0xbf
-    db 0bfh                 ;ee33  bf          DATA 0xbf
-    db 0bfh                 ;ee34  bf          DATA 0xbf
-    db 0bfh                 ;ee35  bf          DATA 0xbf
-    db 0bfh                 ;ee36  bf          DATA 0xbf
-    db 0bfh                 ;ee37  bf          DATA 0xbf
-    db 0bfh                 ;ee38  bf          DATA 0xbf
-    db 0bfh                 ;ee39  bf          DATA 0xbf
-    db 0bfh                 ;ee3a  bf          DATA 0xbf
-    db 0bfh                 ;ee3b  bf          DATA 0xbf
-    db 0bfh                 ;ee3c  bf          DATA 0xbf
-    db 0bfh                 ;ee3d  bf          DATA 0xbf
-    db 0bfh                 ;ee3e  bf          DATA 0xbf
-    db 0bfh                 ;ee3f  bf          DATA 0xbf
-    db 0bfh                 ;ee40  bf          DATA 0xbf
-    db 0bfh                 ;ee41  bf          DATA 0xbf
-    db 0bfh                 ;ee42  bf          DATA 0xbf
-    db 0bfh                 ;ee43  bf          DATA 0xbf
-    db 0bfh                 ;ee44  bf          DATA 0xbf
-    db 0bfh                 ;ee45  bf          DATA 0xbf
-    db 0bfh                 ;ee46  bf          DATA 0xbf
-    db 0bfh                 ;ee47  bf          DATA 0xbf
-    db 0bfh                 ;ee48  bf          DATA 0xbf
-    db 0bfh                 ;ee49  bf          DATA 0xbf
-    db 0bfh                 ;ee4a  bf          DATA 0xbf
-    db 0bfh                 ;ee4b  bf          DATA 0xbf
-    db 0bfh                 ;ee4c  bf          DATA 0xbf
-    db 0bfh                 ;ee4d  bf          DATA 0xbf
-    db 0bfh                 ;ee4e  bf          DATA 0xbf
-    db 0bfh                 ;ee4f  bf          DATA 0xbf
-    db 0bfh                 ;ee50  bf          DATA 0xbf
-    db 0bfh                 ;ee51  bf          DATA 0xbf
-    db 0bfh                 ;ee52  bf          DATA 0xbf
-    db 0bfh                 ;ee53  bf          DATA 0xbf
-    db 0bfh                 ;ee54  bf          DATA 0xbf
-    db 0bfh                 ;ee55  bf          DATA 0xbf
-    db 0bfh                 ;ee56  bf          DATA 0xbf
-    db 0bfh                 ;ee57  bf          DATA 0xbf
-    db 0bfh                 ;ee58  bf          DATA 0xbf
-    db 0bfh                 ;ee59  bf          DATA 0xbf
-    db 0bfh                 ;ee5a  bf          DATA 0xbf
-    db 0bfh                 ;ee5b  bf          DATA 0xbf
-    db 0bfh                 ;ee5c  bf          DATA 0xbf
-    db 0bfh                 ;ee5d  bf          DATA 0xbf
-    db 0bfh                 ;ee5e  bf          DATA 0xbf
-    db 0bfh                 ;ee5f  bf          DATA 0xbf
-    db 0bfh                 ;ee60  bf          DATA 0xbf
-    db 0bfh                 ;ee61  bf          DATA 0xbf
-    db 0bfh                 ;ee62  bf          DATA 0xbf
-    db 0bfh                 ;ee63  bf          DATA 0xbf
-    db 0bfh                 ;ee64  bf          DATA 0xbf
-    db 0bfh                 ;ee65  bf          DATA 0xbf
-    db 0bfh                 ;ee66  bf          DATA 0xbf
-    db 0bfh                 ;ee67  bf          DATA 0xbf
-    db 0bfh                 ;ee68  bf          DATA 0xbf
-    db 0bfh                 ;ee69  bf          DATA 0xbf
-    db 0bfh                 ;ee6a  bf          DATA 0xbf
-    db 0bfh                 ;ee6b  bf          DATA 0xbf
-    db 0bfh                 ;ee6c  bf          DATA 0xbf
-    db 0bfh                 ;ee6d  bf          DATA 0xbf
-    db 0bfh                 ;ee6e  bf          DATA 0xbf
-    db 0bfh                 ;ee6f  bf          DATA 0xbf
-    db 0bfh                 ;ee70  bf          DATA 0xbf
-    db 0bfh                 ;ee71  bf          DATA 0xbf
-    db 0bfh                 ;ee72  bf          DATA 0xbf
-    db 0bfh                 ;ee73  bf          DATA 0xbf
-    db 0bfh                 ;ee74  bf          DATA 0xbf
-    db 0bfh                 ;ee75  bf          DATA 0xbf
-    db 0bfh                 ;ee76  bf          DATA 0xbf
-    db 0bfh                 ;ee77  bf          DATA 0xbf
-    db 0bfh                 ;ee78  bf          DATA 0xbf
-    db 0bfh                 ;ee79  bf          DATA 0xbf
-    db 0bfh                 ;ee7a  bf          DATA 0xbf
-    db 0bfh                 ;ee7b  bf          DATA 0xbf
-    db 0bfh                 ;ee7c  bf          DATA 0xbf
-    db 0bfh                 ;ee7d  bf          DATA 0xbf
-    db 0bfh                 ;ee7e  bf          DATA 0xbf
-    db 0bfh                 ;ee7f  bf          DATA 0xbf
-    db 0bfh                 ;ee80  bf          DATA 0xbf
-    db 0bfh                 ;ee81  bf          DATA 0xbf
-    db 0bfh                 ;ee82  bf          DATA 0xbf
-    db 0bfh                 ;ee83  bf          DATA 0xbf
-    db 0bfh                 ;ee84  bf          DATA 0xbf
-    db 0bfh                 ;ee85  bf          DATA 0xbf
-    db 0bfh                 ;ee86  bf          DATA 0xbf
-    db 0bfh                 ;ee87  bf          DATA 0xbf
-    db 0bfh                 ;ee88  bf          DATA 0xbf
-    db 0bfh                 ;ee89  bf          DATA 0xbf
-    db 0bfh                 ;ee8a  bf          DATA 0xbf
-    db 0bfh                 ;ee8b  bf          DATA 0xbf
-    db 0bfh                 ;ee8c  bf          DATA 0xbf
-    db 0bfh                 ;ee8d  bf          DATA 0xbf
-    db 0bfh                 ;ee8e  bf          DATA 0xbf
-    db 0bfh                 ;ee8f  bf          DATA 0xbf
-    db 0bfh                 ;ee90  bf          DATA 0xbf
-    db 0bfh                 ;ee91  bf          DATA 0xbf
-    db 0bfh                 ;ee92  bf          DATA 0xbf
-    db 0bfh                 ;ee93  bf          DATA 0xbf
-    db 0bfh                 ;ee94  bf          DATA 0xbf
-    db 0bfh                 ;ee95  bf          DATA 0xbf
-    db 0bfh                 ;ee96  bf          DATA 0xbf
-    db 0bfh                 ;ee97  bf          DATA 0xbf
-    db 0bfh                 ;ee98  bf          DATA 0xbf
-    db 0bfh                 ;ee99  bf          DATA 0xbf
-    db 0bfh                 ;ee9a  bf          DATA 0xbf
-    db 0bfh                 ;ee9b  bf          DATA 0xbf
-    db 0bfh                 ;ee9c  bf          DATA 0xbf
-    db 0bfh                 ;ee9d  bf          DATA 0xbf
-    db 0bfh                 ;ee9e  bf          DATA 0xbf
-    db 0bfh                 ;ee9f  bf          DATA 0xbf
-    db 0bfh                 ;eea0  bf          DATA 0xbf
-    db 0bfh                 ;eea1  bf          DATA 0xbf
-    db 0bfh                 ;eea2  bf          DATA 0xbf
-    db 0bfh                 ;eea3  bf          DATA 0xbf
-    db 0bfh                 ;eea4  bf          DATA 0xbf
-    db 0bfh                 ;eea5  bf          DATA 0xbf
-    db 0bfh                 ;eea6  bf          DATA 0xbf
-    db 0bfh                 ;eea7  bf          DATA 0xbf
-    db 0bfh                 ;eea8  bf          DATA 0xbf
-    db 0bfh                 ;eea9  bf          DATA 0xbf
-    db 0bfh                 ;eeaa  bf          DATA 0xbf
-    db 0bfh                 ;eeab  bf          DATA 0xbf
-    db 0bfh                 ;eeac  bf          DATA 0xbf
-    db 0bfh                 ;eead  bf          DATA 0xbf
-    db 0bfh                 ;eeae  bf          DATA 0xbf
-    db 0bfh                 ;eeaf  bf          DATA 0xbf
-    db 0bfh                 ;eeb0  bf          DATA 0xbf
-    db 0bfh                 ;eeb1  bf          DATA 0xbf
-    db 0bfh                 ;eeb2  bf          DATA 0xbf
-    db 0bfh                 ;eeb3  bf          DATA 0xbf
-    db 0bfh                 ;eeb4  bf          DATA 0xbf
-    db 0bfh                 ;eeb5  bf          DATA 0xbf
-    db 0bfh                 ;eeb6  bf          DATA 0xbf
-    db 0bfh                 ;eeb7  bf          DATA 0xbf
-    db 0bfh                 ;eeb8  bf          DATA 0xbf
-    db 0bfh                 ;eeb9  bf          DATA 0xbf
-    db 0bfh                 ;eeba  bf          DATA 0xbf
-    db 0bfh                 ;eebb  bf          DATA 0xbf
-    db 0bfh                 ;eebc  bf          DATA 0xbf
-    db 0bfh                 ;eebd  bf          DATA 0xbf
-    db 0bfh                 ;eebe  bf          DATA 0xbf
-    db 0bfh                 ;eebf  bf          DATA 0xbf
-    db 0bfh                 ;eec0  bf          DATA 0xbf
-    db 0bfh                 ;eec1  bf          DATA 0xbf
-    db 0bfh                 ;eec2  bf          DATA 0xbf
-    db 0bfh                 ;eec3  bf          DATA 0xbf
-    db 0bfh                 ;eec4  bf          DATA 0xbf
-    db 0bfh                 ;eec5  bf          DATA 0xbf
-    db 0bfh                 ;eec6  bf          DATA 0xbf
-    db 0bfh                 ;eec7  bf          DATA 0xbf
-    db 0bfh                 ;eec8  bf          DATA 0xbf
-    db 0bfh                 ;eec9  bf          DATA 0xbf
-    db 0bfh                 ;eeca  bf          DATA 0xbf
-    db 0bfh                 ;eecb  bf          DATA 0xbf
-    db 0bfh                 ;eecc  bf          DATA 0xbf
-    db 0bfh                 ;eecd  bf          DATA 0xbf
-    db 0bfh                 ;eece  bf          DATA 0xbf
-    db 0bfh                 ;eecf  bf          DATA 0xbf
-    db 0bfh                 ;eed0  bf          DATA 0xbf
-    db 0bfh                 ;eed1  bf          DATA 0xbf
-    db 0bfh                 ;eed2  bf          DATA 0xbf
-    db 0bfh                 ;eed3  bf          DATA 0xbf
-    db 0bfh                 ;eed4  bf          DATA 0xbf
-    db 0bfh                 ;eed5  bf          DATA 0xbf
-    db 0bfh                 ;eed6  bf          DATA 0xbf
-    db 0bfh                 ;eed7  bf          DATA 0xbf
-    db 0bfh                 ;eed8  bf          DATA 0xbf
-    db 0bfh                 ;eed9  bf          DATA 0xbf
-    db 0bfh                 ;eeda  bf          DATA 0xbf
-    db 0bfh                 ;eedb  bf          DATA 0xbf
-    db 0bfh                 ;eedc  bf          DATA 0xbf
-    db 0bfh                 ;eedd  bf          DATA 0xbf
-    db 0bfh                 ;eede  bf          DATA 0xbf
-    db 0bfh                 ;eedf  bf          DATA 0xbf
-    db 0bfh                 ;eee0  bf          DATA 0xbf
-    db 0bfh                 ;eee1  bf          DATA 0xbf
-    db 0bfh                 ;eee2  bf          DATA 0xbf
-    db 0bfh                 ;eee3  bf          DATA 0xbf
-    db 0bfh                 ;eee4  bf          DATA 0xbf
-    db 0bfh                 ;eee5  bf          DATA 0xbf
-    db 0bfh                 ;eee6  bf          DATA 0xbf
-    db 0bfh                 ;eee7  bf          DATA 0xbf
-    db 0bfh                 ;eee8  bf          DATA 0xbf
-    db 0bfh                 ;eee9  bf          DATA 0xbf
-    db 0bfh                 ;eeea  bf          DATA 0xbf
-    db 0bfh                 ;eeeb  bf          DATA 0xbf
-    db 0bfh                 ;eeec  bf          DATA 0xbf
-    db 0bfh                 ;eeed  bf          DATA 0xbf
-    db 0bfh                 ;eeee  bf          DATA 0xbf
-    db 0bfh                 ;eeef  bf          DATA 0xbf
-    db 0bfh                 ;eef0  bf          DATA 0xbf
-    db 0bfh                 ;eef1  bf          DATA 0xbf
-    db 0bfh                 ;eef2  bf          DATA 0xbf
-    db 0bfh                 ;eef3  bf          DATA 0xbf
-    db 0bfh                 ;eef4  bf          DATA 0xbf
-    db 0bfh                 ;eef5  bf          DATA 0xbf
-    db 0bfh                 ;eef6  bf          DATA 0xbf
-    db 0bfh                 ;eef7  bf          DATA 0xbf
-    db 0bfh                 ;eef8  bf          DATA 0xbf
-    db 0bfh                 ;eef9  bf          DATA 0xbf
-    db 0bfh                 ;eefa  bf          DATA 0xbf
-    db 0bfh                 ;eefb  bf          DATA 0xbf
-    db 0bfh                 ;eefc  bf          DATA 0xbf
-    db 0bfh                 ;eefd  bf          DATA 0xbf
-    db 0bfh                 ;eefe  bf          DATA 0xbf
-    db 0bfh                 ;eeff  bf          DATA 0xbf
 
 
+    org 0ec00h              ;The patch must end before the checksum at 0effeh
+
 dump_ram:
     di                      ;Disable interrupts
     mov PCC_,#00h           ;Processor clock = full speed
@@ -54911,7 +54147,7 @@ dump_ram:
     mov IMS_,#0cfh          ;High speed RAM size = 1K, ROM size = 60K
     mov PM2_,#11011111b     ;PM25=output (TxD0), all others input
     mov ASIM0_,#00h         ;Disable UART
-    mov BRGC0_,#1bh         ;Set baud rate to 38400 bps
+    mov BRGC0_,#12h         ;Set baud rate to 57600 bps
     mov ASIM0_,#8ah         ;Enable UART for transmit only and 8-N-1
 
     ;Send header string
@@ -54959,6 +54195,24 @@ not_reserved:
     cmpw ax,#0FF00h
     bnz $dump_loop
 
+    ;Start the stream over with a keyframe and no watches.  Software23
+    ;only clears expansion RAM on a cold start, so its variables may hold
+    ;anything.
+
+    mov a,#00h
+    movw hl,#stream_scan
+    mov b,#10h
+stream_init_loop:
+    mov [hl],a
+    incw hl
+    dbnz b,$stream_init_loop
+    movw hl,#watch_table
+    mov b,#watch_count*8
+watch_init_loop:
+    mov [hl],a
+    incw hl
+    dbnz b,$watch_init_loop
+
     ;Jump to the original reset routine
 
     br !lab_0d88
@@ -54967,6 +54221,474 @@ dump_header:
     db 'DUMPRAM:'
 
 
+;While software23 runs, RAM is streamed out the UART in passes.  Each pass
+;is a frame: the header "RAMDIFF:", then a run for each 16-byte block whose
+;checksum changed since the last pass, then 00h.  A run is the address of
+;the block (high byte first) followed by its 16 bytes.  Every 32nd pass
+;sends all of the blocks as a keyframe.
+;
+;The watch timer interrupt (about every 1 ms) checks one block per tick,
+;which takes about 0.2 ms, and starts sending its run if it changed.  The
+;UART transmit complete interrupt sends the rest of the run.  A pass with
+;few changes takes about 0.2 s.
+;
+;The host can instead set up to 8 watches by sending commands to the UART:
+;  'X'                                 clear all watches, back to passes
+;  'W' n cond addr_h addr_l value snap_h snap_l snap_len
+;                                      set watch n (0-7)
+;The bytes of a command must be sent together; a command that stops for a
+;tick is dropped.  cond is 0 (off), 1 (byte at addr changed), or 2 (byte
+;at addr changed to value); a 'W' command with any other n or cond is
+;ignored.  After a 'W' command, the pass in progress is ended and no more
+;passes are sent until 'X'.  Each tick the watches are checked, and when
+;one triggers, a frame is sent: the header "RAMWATCH",
+;n, the tick count (high byte first), snap_h, snap_l, snap_len, then
+;snap_len (1-32) bytes of RAM at the snapshot address.  A watch that
+;triggers while a frame is being sent is checked again on the next tick.
+;
+;Software23 does not reference expansion RAM above F26Fh, so the stream
+;keeps its variables in F600-F7FF and leaves that area out of the passes.
+;The UART handlers of software23 (lab_307e, lab_30e8, lab_32df) are
+;replaced, so the patched radio can not be used with a diagnostic tester.
+
+    stream_scan equ 0f600h      ;2 bytes: address of the next block, 0 = new pass
+    stream_sum equ 0f602h       ;2 bytes: pointer to its checksums in stream_sums
+    stream_tx_ptr equ 0f604h    ;2 bytes: pointer to the next byte to send
+    stream_tx_count equ 0f606h  ;Number of bytes left to send
+    stream_tx_busy equ 0f607h   ;Nonzero while a byte is being sent
+    stream_pass equ 0f608h      ;Number of passes
+    watch_ticks equ 0f60ah      ;2 bytes: ticks, for the time of a trigger
+    watch_on equ 0f60ch         ;Nonzero from a 'W' command until 'X'
+    cmd_count equ 0f60dh        ;Number of bytes in cmd_buf
+    cmd_last equ 0f60eh         ;cmd_count at the last tick
+    stream_run equ 0f610h       ;18 bytes: address high, low, then the block
+    watch_frame equ 0f630h      ;46 bytes: frame sent when a watch triggers
+    cmd_buf equ 0f660h          ;9 bytes: command from the host
+    stream_sums equ 0f680h      ;320 bytes: 2 checksums for each of 160 blocks
+    watch_table equ 0f7c0h      ;8 watches of 8 bytes each:
+                                ;  +0 cond, +1 addr low, +2 addr high,
+                                ;  +3 value, +4 byte at the last check,
+                                ;  +5 snap low, +6 snap high, +7 snap_len
+    stream_key_mask equ 1fh     ;Pass number bits that are 0 on a keyframe
+    watch_count equ 8           ;Number of watches
+    watch_change equ 1          ;cond: byte changed
+    watch_equal equ 2           ;cond: byte changed to value
+    watch_snap_max equ 32       ;Most bytes in a snapshot
+
+stream_tick:
+;INTWTNI0 watch timer interval interrupt.  Does one step of the stream,
+;then continues to the original handler (lab_0135).
+;
+    push ax
+    push bc
+    push de
+    push hl
+
+    movw ax,!watch_ticks
+    incw ax
+    movw !watch_ticks,ax
+
+    ;Drop a command from the host that has stopped arriving
+
+    mov a,!cmd_count
+    cmp a,!cmd_last
+    mov !cmd_last,a
+    bnz $stream_cmd_ok
+    mov a,#00h
+    mov !cmd_count,a
+    mov !cmd_last,a
+
+stream_cmd_ok:
+    ;Take the UART back if software23 has set it up for itself
+
+    mov a,ASIM0_
+    cmp a,#0cah
+    bnz $stream_uart_init
+    mov a,BRGC0_
+    cmp a,#12h
+    bz $stream_uart_ok
+
+stream_uart_init:
+    mov ASIM0_,#00h         ;Disable UART
+    mov BRGC0_,#12h         ;Set baud rate to 57600 bps
+    mov ASIM0_,#0cah        ;Enable UART for transmit and receive, 8-N-1,
+                            ;receive errors only cause INTSER0
+    clr1 MK0H_.1            ;Enable INTSER0 (receive error)
+    clr1 MK0H_.2            ;Enable INTSR0 (receive complete)
+    clr1 MK0H_.3            ;Enable INTST0 (transmit complete)
+    mov a,#00h
+    mov !stream_tx_busy,a   ;No byte is being sent
+    mov !stream_tx_count,a
+    movw ax,#0000h
+    movw !stream_scan,ax    ;Start a new pass (a run cut short is lost)
+
+stream_uart_ok:
+    mov a,!stream_tx_busy
+    cmp a,#00h
+    bz $stream_step
+    br !stream_tick_done    ;Wait until the last run has been sent
+
+stream_step:
+    movw ax,!stream_scan
+    cmpw ax,#0000h
+    bnz $stream_pass_step
+    mov a,!watch_on
+    cmp a,#00h
+    bz $stream_pass_step
+    br !watch_step          ;Watches are set and no pass is in progress
+
+stream_pass_step:
+    movw ax,!stream_scan
+    cmpw ax,#0000h
+    bnz $stream_not_start
+
+    ;Start a pass: send the header
+
+    movw ax,#0f000h
+    movw !stream_scan,ax
+    movw ax,#stream_sums
+    movw !stream_sum,ax
+    movw hl,#stream_header
+    mov a,#8
+    br !stream_send
+
+stream_not_start:
+    cmpw ax,#0ff00h
+    bnz $stream_check
+
+    ;End the pass: send 00h
+
+    movw ax,#0000h
+    movw !stream_scan,ax
+    mov a,!stream_pass
+    inc a
+    mov !stream_pass,a
+    movw hl,#stream_end
+    mov a,#1
+    br !stream_send
+
+stream_check:
+    ;Copy the block at AX into the run and checksum it
+
+    movw hl,ax              ;HL = address of the block
+    mov !stream_run,a       ;Address high byte
+    mov a,x
+    mov !stream_run+1,a     ;Address low byte
+    movw de,#stream_run+2   ;DE = pointer to the copy
+    mov b,#10h              ;B = number of bytes in a block
+    mov c,#00h              ;C = sum of the bytes
+    mov x,#00h              ;X = sum of the sums
+stream_sum_loop:
+    mov a,[hl]
+    mov [de],a
+    incw hl
+    incw de
+    add a,c
+    mov c,a
+    add a,x
+    mov x,a
+    dbnz b,$stream_sum_loop
+
+    mov a,x
+    mov b,a                 ;B = sum of the sums
+    movw ax,hl
+    cmpw ax,#0f600h
+    bnz $stream_next
+    movw ax,#0fb00h         ;Skip stream variables and reserved area F600-FAFF
+stream_next:
+    movw !stream_scan,ax
+
+    ;Send the run if the checksums changed or this is a keyframe
+
+    movw ax,!stream_sum
+    movw hl,ax              ;HL = pointer to the checksums from the last pass
+    addw ax,#2
+    movw !stream_sum,ax
+    mov a,!stream_pass
+    and a,#stream_key_mask
+    bz $stream_changed
+    mov a,[hl]
+    cmp a,c
+    bnz $stream_changed
+    mov a,[hl+1]
+    cmp a,b
+    bz $stream_tick_done    ;Block is the same
+
+stream_changed:
+    mov a,c
+    mov [hl],a
+    mov a,b
+    mov [hl+1],a
+    movw hl,#stream_run
+    mov a,#18
+
+stream_send:
+    ;Start sending A bytes from HL
+
+    mov !stream_tx_count,a
+    movw ax,hl
+    movw !stream_tx_ptr,ax
+    call !stream_tx_next
+
+stream_tick_done:
+    pop hl
+    pop de
+    pop bc
+    pop ax
+    br !lab_0135            ;Continue to the original handler
+
+
+watch_step:
+;Check the watches and send a frame for the first one that triggers.
+;Part of stream_tick.
+;
+    movw hl,#watch_table
+    mov c,#00h              ;C = watch number
+watch_loop:
+    mov a,[hl]
+    cmp a,#00h
+    bz $watch_next          ;Watch is off
+    mov b,a                 ;B = cond
+    mov a,[hl+1]
+    mov e,a
+    mov a,[hl+2]
+    mov d,a
+    mov a,[de]
+    mov x,a                 ;X = byte at addr now
+    mov a,[hl+4]
+    cmp a,x
+    bz $watch_next          ;Not changed
+    mov a,x
+    mov [hl+4],a
+    mov a,b
+    cmp a,#watch_change
+    bz $watch_trigger
+    mov a,[hl+3]
+    cmp a,x
+    bz $watch_trigger       ;Changed to the value
+
+watch_next:
+    movw ax,hl
+    addw ax,#8
+    movw hl,ax
+    inc c
+    mov a,c
+    cmp a,#watch_count
+    bnz $watch_loop
+    br !stream_tick_done
+
+watch_trigger:
+    ;Build the frame: header, n, ticks, snapshot address and length
+
+    mov a,c
+    mov !watch_frame+8,a
+    movw ax,!watch_ticks
+    mov !watch_frame+9,a    ;Ticks high byte
+    mov a,x
+    mov !watch_frame+10,a   ;Ticks low byte
+    mov a,[hl+6]
+    mov !watch_frame+11,a   ;Snapshot address high byte
+    mov d,a
+    mov a,[hl+5]
+    mov !watch_frame+12,a   ;Snapshot address low byte
+    mov e,a                 ;DE = snapshot address
+    mov a,[hl+7]
+    mov !watch_frame+13,a
+    mov c,a                 ;C = snapshot length
+    mov b,a
+
+    ;Copy the snapshot and the header
+
+    movw hl,#watch_frame+14
+watch_snap_loop:
+    mov a,[de]
+    mov [hl],a
+    incw de
+    incw hl
+    dbnz b,$watch_snap_loop
+
+    movw hl,#watch_header
+    movw de,#watch_frame
+    mov b,#8
+watch_header_loop:
+    mov a,[hl]
+    mov [de],a
+    incw hl
+    incw de
+    dbnz b,$watch_header_loop
+
+    movw hl,#watch_frame
+    mov a,c
+    add a,#14
+    br !stream_send
+
+
+stream_st:
+;INTST0 UART transmit complete interrupt.  Sends the next byte.
+;
+    push ax
+    push hl
+    call !stream_tx_next
+    pop hl
+    pop ax
+    reti
+
+
+stream_tx_next:
+;Send the next byte if any are left.
+;Destroys A, X, HL.
+;
+    mov a,!stream_tx_count
+    cmp a,#00h
+    bz $stream_tx_idle
+    dec a
+    mov !stream_tx_count,a
+    movw ax,!stream_tx_ptr
+    movw hl,ax
+    mov a,[hl]
+    mov RXB0_TXS0_,a        ;Send byte
+    incw hl
+    movw ax,hl
+    movw !stream_tx_ptr,ax
+    mov a,#01h
+    mov !stream_tx_busy,a
+    ret
+
+stream_tx_idle:
+    mov !stream_tx_busy,a   ;A = 0: nothing is being sent
+    ret
+
+
+stream_sr:
+;INTSR0 UART receive complete and INTSER0 receive error interrupts.
+;Collects a command from the host in cmd_buf.
+;
+    push ax
+    push bc
+    push de
+    push hl
+    mov a,ASIS0_            ;Read receive errors (clears them)
+    mov x,a
+    mov a,RXB0_TXS0_
+    mov b,a                 ;B = byte received
+    mov a,x
+    cmp a,#00h
+    bnz $cmd_drop           ;Drop the command on a receive error
+
+    mov a,!cmd_count
+    cmp a,#00h
+    bnz $cmd_store
+    mov a,b
+    cmp a,#'X'
+    bz $cmd_clear
+    cmp a,#'W'
+    bnz $stream_sr_done     ;Ignore anything else between commands
+    mov a,#00h
+
+cmd_store:
+    mov c,a                 ;C = number of bytes in cmd_buf
+    mov a,b
+    movw hl,#cmd_buf
+    mov [hl+c],a
+    inc c
+    mov a,c
+    mov !cmd_count,a
+    cmp a,#9
+    bnz $stream_sr_done
+    call !cmd_watch
+
+cmd_drop:
+    mov a,#00h
+    mov !cmd_count,a
+    br $stream_sr_done
+
+cmd_clear:
+    mov a,#00h
+    mov !watch_on,a
+    movw hl,#watch_table
+    mov b,#watch_count*8
+cmd_clear_loop:
+    mov [hl],a
+    incw hl
+    dbnz b,$cmd_clear_loop
+
+stream_sr_done:
+    pop hl
+    pop de
+    pop bc
+    pop ax
+    reti
+
+
+cmd_watch:
+;Set a watch from the 'W' command in cmd_buf.
+;Destroys A, X, DE, HL.
+;
+    mov a,!cmd_buf+2
+    cmp a,#watch_equal+1
+    bnc $cmd_watch_done     ;No such cond
+    mov a,!cmd_buf+1
+    cmp a,#watch_count
+    bnc $cmd_watch_done     ;No such watch
+
+    add a,a                 ;HL = watch_table + n * 8
+    add a,a
+    add a,a
+    mov x,a
+    mov a,#00h
+    addw ax,#watch_table
+    movw hl,ax
+
+    mov a,!cmd_buf+4
+    mov [hl+1],a            ;Address low byte
+    mov e,a
+    mov a,!cmd_buf+3
+    mov [hl+2],a            ;Address high byte
+    mov d,a
+    mov a,[de]
+    mov [hl+4],a            ;Only changes from now on trigger
+    mov a,!cmd_buf+5
+    mov [hl+3],a            ;Value
+    mov a,!cmd_buf+7
+    mov [hl+5],a            ;Snapshot address low byte
+    mov a,!cmd_buf+6
+    mov [hl+6],a            ;Snapshot address high byte
+    mov a,!cmd_buf+8
+    cmp a,#00h
+    bz $cmd_snap_max
+    cmp a,#watch_snap_max+1
+    bc $cmd_snap_ok
+cmd_snap_max:
+    mov a,#watch_snap_max
+cmd_snap_ok:
+    mov [hl+7],a            ;Snapshot length
+    mov a,!cmd_buf+2
+    mov [hl],a              ;Cond
+
+    ;End the pass in progress
+
+    mov a,#01h
+    mov !watch_on,a
+    movw ax,!stream_scan
+    cmpw ax,#0000h
+    bz $cmd_watch_done
+    movw ax,#0ff00h
+    movw !stream_scan,ax
+
+cmd_watch_done:
+    ret
+
+
+stream_header:
+    db 'RAMDIFF:'
+
+stream_end:
+    db 00h
+
+watch_header:
+    db 'RAMWATCH'
+
+
     org 0effeh
 
 checksum:
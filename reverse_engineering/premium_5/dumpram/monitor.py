@@ -1,30 +1,68 @@
 #!/usr/bin/env python3 -u
+'''
+Premium 5 RAM Monitor
+
+Receives RAM from the radio running dumpram23.asm and displays it, with
+the bytes that changed since the last frame highlighted.  Each frame is
+also saved to dump.bin as a 64K image.
+
+Usage: %s                       stream all of RAM
+       %s watch <watch> ...     only show RAM when a watch triggers
+
+The radio sends two kinds of frames at 57600 baud:
+  DUMPRAM: + 3072 bytes       all of RAM after a reset, before software23
+                              starts and clears it
+  RAMDIFF: + runs + 00        the blocks of RAM that changed, sent over
+                              and over while software23 runs
+
+A run is the address of a 16-byte block (high byte first) followed by its
+16 bytes.  Every 32nd RAMDIFF: frame has all of the blocks.  Bytes that
+have not been received yet are shown as "--".  F600-F7FF holds the
+variables of the stream and is only sent in DUMPRAM: frames.
+
+Instead of streaming, the radio can check up to 8 watches every tick
+(0.98 ms) and send a snapshot of RAM when one triggers:
+  RAMWATCH + n + ticks (2) + address (2) + length + bytes
+A watch is given in hex as <addr>[=<value>][@<start>+<length>]:
+  f18e                  trigger when the byte at F18E changes
+  f18e=55               trigger when it changes to 55
+  f18e@f180+20          and send the 20h bytes from F180 (default: up to
+                        32 bytes around the address)
+The watches are sent again if the radio is reset and goes back to
+streaming.  Times are the radio's ticks since the first trigger.
+'''
 import os
 import sys
+import time
 import serial # pyserial
 
+DUMP_HEADER = b'DUMPRAM:'
+DIFF_HEADER = b'RAMDIFF:'
+WATCH_HEADER = b'RAMWATCH'
+BLOCK_SIZE = 16
+RAM_AREAS = ((0xf000, 0xf800), (0xfb00, 0xff00)) # without the reserved area
+TICK_SECS = 32 / 32768.0 # watch timer interval
+WATCH_CHANGE = 1
+WATCH_EQUAL = 2
+SNAP_SIZE = 32
+
 def make_serial():
     from serial.tools.list_ports import comports
     names = [ x.device for x in comports() if 'Bluetooth' not in x.device ]
     print(names)
     if not names:
         raise Exception("No serial port found")
-    return serial.Serial(port=names[0], baudrate=38400, timeout=None)
+    return serial.Serial(port=names[0], baudrate=57600, timeout=None)
 
-def receive_ram(ser):
-    ram = {}
+def receive_header(ser):
     data = bytearray()
-    while True:
+    while bytes(data) not in (DUMP_HEADER, DIFF_HEADER, WATCH_HEADER):
         data += ser.read(1)
         if len(data) > 8:
             data.pop(0)
-        sys.stdout.write(chr(27)+"[0K\rReceiving header: %d bytes (%r)" % (len(data), bytes(data)))
-        sys.stdout.flush()
-        if data == b'DUMPRAM:':
-            break
+    return bytes(data)
 
-    sys.stdout.write(chr(27) + "[2K\rReceiving data...")
-    sys.stdout.flush()
+def receive_dump(ser):
     data = ser.read(3072)
     address = 0xf000
     ram = {}
@@ -35,6 +73,67 @@ def receive_ram(ser):
             address = 0xfb00
     return ram
 
+def is_block(address):
+    if address % BLOCK_SIZE:
+        return False
+    return (0xf000 <= address < 0xf600) or (0xfb00 <= address < 0xff00)
+
+def receive_diff(ser):
+    '''Returns the bytes in the runs of a RAMDIFF: frame, or None if the
+    frame is cut short (the radio started a new pass)'''
+    ram = {}
+    while True:
+        high = ser.read(1)[0]
+        if high == 0: # end of frame
+            return ram
+        address = (high << 8) + ser.read(1)[0]
+        if not is_block(address):
+            return None
+        for d in ser.read(BLOCK_SIZE):
+            ram[address] = d
+            address += 1
+
+def receive_watch(ser):
+    '''Returns (watch number, ticks, {address: value}) of a RAMWATCH frame'''
+    data = ser.read(6)
+    address = (data[3] << 8) + data[4]
+    snapshot = ser.read(data[5])
+    ram = dict((address + i, d) for i, d in enumerate(snapshot))
+    return data[0], (data[1] << 8) + data[2], ram
+
+def ram_area(address):
+    for start, end in RAM_AREAS:
+        if start <= address < end:
+            return start, end
+    raise ValueError("%04X is not in RAM" % address)
+
+def parse_watch(spec):
+    '''Parses <addr>[=<value>][@<start>+<length>] into
+    (cond, address, value, snapshot address, snapshot length)'''
+    spec, _, snap = spec.partition('@')
+    spec, equals, value = spec.partition('=')
+    address = int(spec, 16)
+    area_start, area_end = ram_area(address)
+    cond = WATCH_EQUAL if equals else WATCH_CHANGE
+    value = int(value, 16) if equals else 0
+    if snap:
+        start, length = [int(x, 16) for x in snap.split('+')]
+        if not (0 < length <= SNAP_SIZE) or ram_area(start) != ram_area(start + length - 1):
+            raise ValueError("Bad snapshot: %s" % snap)
+    else:
+        start = max(area_start, (address & ~0xf) - 0x10)
+        start = min(start, area_end - SNAP_SIZE)
+        length = SNAP_SIZE
+    return cond, address, value, start, length
+
+def send_watches(ser, watches):
+    ser.write(b'X') # clear all watches
+    for n, (cond, address, value, start, length) in enumerate(watches):
+        ser.write(b'W' + bytes([n, cond, address >> 8, address & 0xff, value,
+                                start >> 8, start & 0xff, length]))
+        ser.flush()
+        time.sleep(0.005)
+
 def ascii_or_dot(b):
     if (b >= 0x20) and (b <= 0x7e):  # printable 7-bit ascii
         return chr(b)
@@ -58,9 +157,12 @@ def print_ram(ram, old_ram):
         hexdump = ""
         chrdump = ""
         for address in range(base_address, base_address+chunk_size):
-            b = ram[address]
+            b = ram.get(address)
             old_b = old_ram.get(address, b)
-            if b == old_b:
+            if b is None:
+                hexdump += "-- "
+                chrdump += " "
+            elif b == old_b:
                 hexdump += "%02x" % b + " "
                 chrdump += ascii_or_dot(b)
             else:
@@ -79,16 +181,105 @@ def highlighted(s):
 def clear_screen():
     sys.stdout.write(chr(27) + '[2J' + chr(27) + '[H')
 
-def main():
+def home_cursor():
+    sys.stdout.write(chr(27) + '[H')
+
+def print_watch(secs, watch, ram, old_ram):
+    cond, address, value, start, length = watch
+    line = "%10.3f  %04X" % (secs, address)
+    line += ("=%02X " % value) if cond == WATCH_EQUAL else "    "
+    line += " %04X: " % start
+    for a in range(start, start + length):
+        b = "%02x" % ram[a]
+        if a == address or ram[a] != old_ram.get(a, ram[a]):
+            b = highlighted(b)
+        line += b + " "
+    sys.stdout.write(line + "\n")
+    sys.stdout.flush()
+
+def watch(watches):
     ser = make_serial()
+    send_watches(ser, watches)
+    sent_time = time.time()
     old_ram = {}
+    secs = None
+    while True:
+        header = receive_header(ser)
+        if header == DUMP_HEADER:
+            receive_dump(ser)
+        elif header == DIFF_HEADER:
+            receive_diff(ser)
+        if header != WATCH_HEADER:
+            # the radio was reset and forgot the watches
+            if time.time() - sent_time > 1:
+                send_watches(ser, watches)
+                sent_time = time.time()
+            continue
+
+        n, ticks, ram = receive_watch(ser)
+        now = time.time()
+        if secs is None:
+            secs = 0.0
+        else:
+            # ticks wrap every 64 s, so the host's time says how many times
+            period = 0x10000 * TICK_SECS
+            delta = ((ticks - last_ticks) & 0xffff) * TICK_SECS
+            delta += round((now - last_time - delta) / period) * period
+            secs += delta
+        last_ticks, last_time = ticks, now
+        if n < len(watches):
+            print_watch(secs, watches[n], ram, old_ram)
+        old_ram.update(ram)
+
+def stream():
+    ser = make_serial()
+    ser.write(b'X') # clear any watches left from a watch session
+    ram = {}
     here = os.path.abspath(os.path.dirname(__file__))
+    clear_screen()
+    sys.stdout.write("Receiving header...")
+    sys.stdout.flush()
+    frames = 0
+    last_time = time.time()
     while True:
-        ram = receive_ram(ser)
+        header = receive_header(ser)
+        if header == DUMP_HEADER:
+            changes = receive_dump(ser)
+        else:
+            changes = receive_diff(ser)
+            if changes is None:
+                continue
+        old_ram = ram
+        ram = dict(old_ram)
+        ram.update(changes)
         save_ram(ram, os.path.join(here, 'dump.bin'))
-        clear_screen()
+
+        frames += 1
+        now = time.time()
+        home_cursor()
         print_ram(ram, old_ram)
-        old_ram = ram
+        sys.stdout.write(chr(27) + "[2K%s frame %d: %d bytes, %.0f ms since last frame\n" % (
+            header.decode('ascii'), frames, len(changes), (now - last_time) * 1000))
+        sys.stdout.flush()
+        last_time = now
+
+def usage():
+    sys.stderr.write((__doc__.strip() + '\n').replace('%s', sys.argv[0]))
+    sys.exit(1)
+
+def main():
+    args = sys.argv[1:]
+    if not args:
+        stream()
+    elif args[0] == 'watch' and 1 <= len(args) - 1 <= 8:
+        try:
+            watches = [parse_watch(x) for x in args[1:]]
+        except ValueError as e:
+            sys.stderr.write("%s\n" % e)
+            sys.exit(1)
+        watch(watches)
+    else:
+        usage()
 
 if __name__ == '__main__':
     main()
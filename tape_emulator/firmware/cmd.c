@@ -0,0 +1,406 @@
+#include <stdint.h>
+#include "cmd.h"
+#include "deck.h"
+#include "events.h"
+#include "main.h"
+#include "signals.h"
+#include "timer.h"
+#include "uart.h"
+
+/*************************************************************************
+ * Command Interpreter
+ *
+ * Commands are received on the UART as <length> <command> <args...> and
+ * answered with <length> <error> <data...>, like the faceplate emulator.
+ * 16-bit values are little endian.  Turn the event log off first
+ * (CMD_SET_LOG) so its text does not mix with the replies.
+ *************************************************************************/
+
+static uint32_t _last_byte_ticks;
+
+void cmd_init()
+{
+    cmd_buf_index = 0;
+    cmd_expected_length = 0;
+}
+
+/* Forget a partial command if no byte has been received for the
+ * timeout.  We don't send any reply.  This allows the client to
+ * resynchronize by waiting longer than the timeout.
+ */
+void cmd_check_timeout()
+{
+    if ((cmd_expected_length != 0) &&
+        ((timer_now() - _last_byte_ticks) >= TIMER_MS(CMD_TIMEOUT_MS)))
+    {
+        cmd_init();
+    }
+}
+
+static void _send_empty_reply(uint8_t error_code)
+{
+    uart_put(1);   // 1 byte to follow
+    uart_put(error_code);
+}
+
+/* Command: Echo
+ * Arguments: <arg1> <arg2> <arg3> ...
+ * Returns: <error> <arg1> <arg2> <arg3> ...
+ *
+ * Echoes the arguments received back to the client.  If no args were
+ * received after the command byte, an empty reply is sent.
+ */
+static void _do_echo()
+{
+    uart_put(cmd_buf_index); // number of bytes to follow
+    uart_put(CMD_ERROR_OK);
+    uint8_t i;
+    for (i=1; i<cmd_buf_index; i++)
+    {
+        uart_put(cmd_buf[i]);
+    }
+}
+
+/* Command: Set Log
+ * Arguments: <enabled>
+ * Returns: <error>
+ *
+ * Turns the text log of bytes from the radio and deck states on (1)
+ * or off (0).  The bytes are still decoded while it is off.
+ */
+static void _do_set_log()
+{
+    if (cmd_buf_index != 2)
+    {
+        _send_empty_reply(CMD_ERROR_BAD_ARGS_LENGTH);
+        return;
+    }
+    if (cmd_buf[1] > 1)
+    {
+        _send_empty_reply(CMD_ERROR_BAD_ARGS_VALUE);
+        return;
+    }
+
+    log_enabled = cmd_buf[1];
+    _send_empty_reply(CMD_ERROR_OK);
+}
+
+/* Command: Deck Insert
+ * Arguments: none
+ * Returns: <error>
+ *
+ * Inserts a tape, like the pushbutton.  Returns CMD_ERROR_BAD_STATE if
+ * a tape is already in.
+ */
+static void _do_deck_insert()
+{
+    if (cmd_buf_index != 1)
+    {
+        _send_empty_reply(CMD_ERROR_BAD_ARGS_LENGTH);
+        return;
+    }
+    if (deck_state != DECK_NO_TAPE)
+    {
+        _send_empty_reply(CMD_ERROR_BAD_STATE);
+        return;
+    }
+
+    deck_insert();
+    _send_empty_reply(CMD_ERROR_OK);
+}
+
+/* Command: Deck Remove
+ * Arguments: none
+ * Returns: <error>
+ *
+ * Takes the tape out in any state, e.g. after the radio has ejected it.
+ */
+static void _do_deck_remove()
+{
+    if (cmd_buf_index != 1)
+    {
+        _send_empty_reply(CMD_ERROR_BAD_ARGS_LENGTH);
+        return;
+    }
+
+    deck_remove();
+    _send_empty_reply(CMD_ERROR_OK);
+}
+
+/* Command: Deck Set Metal
+ * Arguments: <metal>
+ * Returns: <error>
+ *
+ * Sets the tape type reported on FE/ME: 0 = normal, 1 = metal.
+ */
+static void _do_deck_set_metal()
+{
+    if (cmd_buf_index != 2)
+    {
+        _send_empty_reply(CMD_ERROR_BAD_ARGS_LENGTH);
+        return;
+    }
+    if (cmd_buf[1] > 1)
+    {
+        _send_empty_reply(CMD_ERROR_BAD_ARGS_VALUE);
+        return;
+    }
+
+    deck_metal = cmd_buf[1];
+    deck_dirty = 1;
+    _send_empty_reply(CMD_ERROR_OK);
+}
+
+/* Command: Deck Set Errors
+ * Arguments: <error flags>
+ * Returns: <error>
+ *
+ * Injects errors (DECK_ERROR_* flags in deck.h).  0 clears them.
+ */
+static void _do_deck_set_errors()
+{
+    if (cmd_buf_index != 2)
+    {
+        _send_empty_reply(CMD_ERROR_BAD_ARGS_LENGTH);
+        return;
+    }
+    if (cmd_buf[1] & ~DECK_ERROR_MASK)
+    {
+        _send_empty_reply(CMD_ERROR_BAD_ARGS_VALUE);
+        return;
+    }
+
+    deck_errors = cmd_buf[1];
+    deck_dirty = 1;
+    _send_empty_reply(CMD_ERROR_OK);
+}
+
+/* Command: Deck Receive
+ * Arguments: <byte1> <byte2> <byte3> ...
+ * Returns: <error> <deck state>
+ *
+ * Decodes the bytes as if they had been sent by the radio.  This allows
+ * the deck to be tested without a radio.
+ */
+static void _do_deck_receive()
+{
+    uint8_t i;
+    for (i=1; i<cmd_buf_index; i++)
+    {
+        deck_receive_byte(cmd_buf[i]);
+    }
+
+    uart_put(2); // number of bytes to follow
+    uart_put(CMD_ERROR_OK);
+    uart_put(deck_state);
+}
+
+/* Command: Deck Dump State
+ * Arguments: none
+ * Returns: <error> <state> <side> <metal> <errors> <dropped: 2>
+ *          <ticks: 4> <tach speeds: 3 x (low us: 2, high us: 2)>
+ *          <play pattern length> <play pattern: 8 x (level, ms: 2)>
+ *          <head>
+ */
+static void _do_deck_dump_state()
+{
+    if (cmd_buf_index != 1)
+    {
+        _send_empty_reply(CMD_ERROR_BAD_ARGS_LENGTH);
+        return;
+    }
+
+    uint8_t size;
+    size = 1 + // error byte
+           1 + // state
+           1 + // side
+           1 + // metal
+           1 + // errors
+           2 + // dropped events
+           4 + // ticks
+           (TACH_NUM_SPEEDS * 4) +
+           1 + // play pattern length
+           (SWITCH_MAX_STEPS * 3) +
+           1;  // head
+
+    uint32_t ticks = timer_now();
+
+    uart_put(size); // number of bytes to follow
+    uart_put(CMD_ERROR_OK);
+    uart_put(deck_state);
+    uart_put(deck_side);
+    uart_put(deck_metal);
+    uart_put(deck_errors);
+    uart_put16(event_dropped());
+    uart_put16(ticks & 0xFFFF);
+    uart_put16(ticks >> 16);
+
+    uint8_t i;
+    for (i=0; i<TACH_NUM_SPEEDS; i++)
+    {
+        uart_put16(tach_speeds[i].low_us);
+        uart_put16(tach_speeds[i].high_us);
+    }
+
+    uart_put(switch_play_pattern_length);
+    for (i=0; i<SWITCH_MAX_STEPS; i++)
+    {
+        uart_put(switch_play_pattern[i].level);
+        uart_put16(switch_play_pattern[i].ms);
+    }
+    uart_put(deck_head);
+}
+
+/* Command: Tach Set Speed
+ * Arguments: <speed> <low us: 2> <high us: 2>
+ * Returns: <error>
+ *
+ * Sets the CLOCK low and high times for TACH_PLAY, TACH_FF, or TACH_REW.
+ * Each time must be 1 to 65535 us.  If the deck is running at that
+ * speed, the outputs are applied again with the new times.
+ */
+static void _do_tach_set_speed()
+{
+    if (cmd_buf_index != 6)
+    {
+        _send_empty_reply(CMD_ERROR_BAD_ARGS_LENGTH);
+        return;
+    }
+
+    uint8_t speed = cmd_buf[1];
+    uint16_t low_us = cmd_buf[2] + (cmd_buf[3] << 8);
+    uint16_t high_us = cmd_buf[4] + (cmd_buf[5] << 8);
+    if ((speed >= TACH_NUM_SPEEDS) || (low_us == 0) || (high_us == 0))
+    {
+        _send_empty_reply(CMD_ERROR_BAD_ARGS_VALUE);
+        return;
+    }
+
+    tach_speeds[speed].low_us = low_us;
+    tach_speeds[speed].high_us = high_us;
+    deck_dirty = 1;
+    _send_empty_reply(CMD_ERROR_OK);
+}
+
+/* Command: Switch Set Play Pattern
+ * Arguments: <level1> <ms1: 2> <level2> <ms2: 2> ...
+ * Returns: <error>
+ *
+ * Sets the SWITCH steps played when play starts (1 to SWITCH_MAX_STEPS).
+ * Each level is held for its ms; the last level is held until the state
+ * changes.  Returns CMD_ERROR_BAD_STATE while the pattern is playing.
+ */
+static void _do_switch_set_play_pattern()
+{
+    uint8_t length = (cmd_buf_index - 1) / 3;
+    if (((cmd_buf_index - 1) % 3 != 0) || (length == 0) ||
+        (length > SWITCH_MAX_STEPS))
+    {
+        _send_empty_reply(CMD_ERROR_BAD_ARGS_LENGTH);
+        return;
+    }
+    if (deck_state == DECK_STARTING_PLAY)
+    {
+        _send_empty_reply(CMD_ERROR_BAD_STATE);
+        return;
+    }
+
+    uint8_t i;
+    for (i=0; i<length; i++)
+    {
+        if (cmd_buf[1 + (i * 3)] > 1)
+        {
+            _send_empty_reply(CMD_ERROR_BAD_ARGS_VALUE);
+            return;
+        }
+    }
+
+    for (i=0; i<SWITCH_MAX_STEPS; i++)
+    {
+        if (i < length)
+        {
+            uint8_t *step = &cmd_buf[1 + (i * 3)];
+            switch_play_pattern[i].level = step[0];
+            switch_play_pattern[i].ms = step[1] + (step[2] << 8);
+        }
+        else
+        {
+            switch_play_pattern[i].level = 0;
+            switch_play_pattern[i].ms = 0;
+        }
+    }
+    switch_play_pattern_length = length;
+    _send_empty_reply(CMD_ERROR_OK);
+}
+
+static void _cmd_dispatch()
+{
+    switch (cmd_buf[0])
+    {
+        case CMD_ECHO:
+            _do_echo();
+            break;
+        case CMD_SET_LOG:
+            _do_set_log();
+            break;
+
+        case CMD_DECK_INSERT:
+            _do_deck_insert();
+            break;
+        case CMD_DECK_REMOVE:
+            _do_deck_remove();
+            break;
+        case CMD_DECK_SET_METAL:
+            _do_deck_set_metal();
+            break;
+        case CMD_DECK_SET_ERRORS:
+            _do_deck_set_errors();
+            break;
+        case CMD_DECK_RECEIVE:
+            _do_deck_receive();
+            break;
+        case CMD_DECK_DUMP_STATE:
+            _do_deck_dump_state();
+            break;
+
+        case CMD_TACH_SET_SPEED:
+            _do_tach_set_speed();
+            break;
+        case CMD_SWITCH_SET_PLAY_PATTERN:
+            _do_switch_set_play_pattern();
+            break;
+
+        default:
+            _send_empty_reply(CMD_ERROR_BAD_COMMAND);
+    }
+}
+
+void cmd_receive_byte(uint8_t c)
+{
+    _last_byte_ticks = timer_now();
+
+    // receive command length byte
+    if (cmd_expected_length == 0)
+    {
+        if (c == 0) // invalid, command length must be 1 byte or longer
+        {
+            _send_empty_reply(CMD_ERROR_NO_COMMAND);
+            cmd_init();
+        }
+        else
+        {
+            cmd_expected_length = c;
+        }
+    }
+    // receive command byte(s)
+    else
+    {
+        cmd_buf[cmd_buf_index++] = c;
+
+        if (cmd_buf_index == cmd_expected_length)
+        {
+            _cmd_dispatch();
+            cmd_init();
+        }
+    }
+}
@@ -0,0 +1,36 @@
+#ifndef CMD_H
+#define CMD_H
+
+#include <stdint.h>
+
+#define CMD_ECHO 0x02
+#define CMD_SET_LOG 0x03
+
+#define CMD_DECK_INSERT 0x10
+#define CMD_DECK_REMOVE 0x11
+#define CMD_DECK_SET_METAL 0x12
+#define CMD_DECK_SET_ERRORS 0x13
+#define CMD_DECK_RECEIVE 0x14
+#define CMD_DECK_DUMP_STATE 0x15
+
+#define CMD_TACH_SET_SPEED 0x20
+#define CMD_SWITCH_SET_PLAY_PATTERN 0x21
+
+#define CMD_ERROR_OK 0x00
+#define CMD_ERROR_NO_COMMAND 0x01
+#define CMD_ERROR_BAD_COMMAND 0x02
+#define CMD_ERROR_BAD_ARGS_LENGTH 0x03
+#define CMD_ERROR_BAD_ARGS_VALUE 0x04
+#define CMD_ERROR_BAD_STATE 0x05
+
+#define CMD_TIMEOUT_MS 2000     // forget a partial command after this
+
+uint8_t cmd_buf[256];
+uint8_t cmd_buf_index;
+uint8_t cmd_expected_length;
+
+void cmd_init();
+void cmd_receive_byte(uint8_t c);
+void cmd_check_timeout();
+
+#endif
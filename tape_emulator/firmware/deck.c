@@ -0,0 +1,304 @@
+#include "main.h"
+#include "deck.h"
+#include "timer.h"
+#include <stdint.h>
+
+/*************************************************************************
+ * TDA3612 Command Decoder
+ *************************************************************************/
+
+// Sequences seen from the PU-1666A with a real SCA4.4.  No complete
+// sequence may be the start of a longer one, so a sequence can be acted
+// on as soon as its last byte arrives.  Bytes that do not match any
+// sequence (e.g. 0xF4, 0xD8, 0xC2) are ignored, as is 0xDF or 0xEF
+// before 0x52 or 0x62.  What 0x52, 0x62, 0x9A, and 0xAA do while
+// stopped is from host/tapecontrol.py; in play, the real deck keeps its
+// motors running after them until 0xF0.
+static const deck_sequence_t _sequences[] =
+{
+    { 1, { 0xF8 },       DECK_CMD_POWER_UP },
+    { 1, { 0xAC },       DECK_CMD_LOAD },       // tape inserted
+    { 1, { 0xA8 },       DECK_CMD_START },
+    { 1, { 0xD4 },       DECK_CMD_START },      // play after stop
+    { 2, { 0xDF, 0x56 }, DECK_CMD_PLAY_A },
+    { 2, { 0xEF, 0x66 }, DECK_CMD_PLAY_B },
+    { 1, { 0x52 },       DECK_CMD_HEAD_OFF },
+    { 1, { 0x62 },       DECK_CMD_HEAD_ON },
+    { 1, { 0xAA },       DECK_CMD_MOTOR_IN },   // sucks in the tape
+    { 1, { 0x9A },       DECK_CMD_MOTOR_OUT },  // ejects the tape
+    { 2, { 0x9E, 0xD7 }, DECK_CMD_SIDE_A },
+    { 2, { 0xAE, 0xE7 }, DECK_CMD_SIDE_B },
+    { 2, { 0xC0, 0xD2 }, DECK_CMD_FF },         // on side A
+    { 2, { 0xC0, 0xE2 }, DECK_CMD_FF },         // on side B
+    { 2, { 0xC0, 0xEA }, DECK_CMD_REW },        // on side A
+    { 2, { 0xC0, 0xDA }, DECK_CMD_REW },        // on side B
+    { 1, { 0xF0 },       DECK_CMD_STOP },
+    { 1, { 0x00 },       DECK_CMD_STOP },
+    { 1, { 0xCC },       DECK_CMD_EJECT },
+};
+
+#define NUM_SEQUENCES (sizeof(_sequences) / sizeof(_sequences[0]))
+
+static uint8_t _buf[DECK_MAX_SEQUENCE];
+static uint8_t _buf_length;
+
+// Returns the command of the sequence in _buf if it is complete,
+// DECK_CMD_NONE if it is the start of a longer sequence, or 0xFF if
+// no sequence starts with it.
+static uint8_t _match()
+{
+    uint8_t result = 0xFF;
+    for (uint8_t i=0; i<NUM_SEQUENCES; i++)
+    {
+        const deck_sequence_t *seq = &_sequences[i];
+        if (seq->length < _buf_length)
+        {
+            continue;
+        }
+
+        uint8_t j;
+        for (j=0; j<_buf_length; j++)
+        {
+            if (seq->data[j] != _buf[j])
+            {
+                break;
+            }
+        }
+        if (j != _buf_length)
+        {
+            continue;
+        }
+
+        if (seq->length == _buf_length)
+        {
+            return seq->command;
+        }
+        result = DECK_CMD_NONE;
+    }
+    return result;
+}
+
+// Feed one byte from the radio to the decoder.  Acts on and returns the
+// command if the byte completes a sequence, otherwise DECK_CMD_NONE.
+uint8_t deck_receive_byte(uint8_t c)
+{
+    _buf[_buf_length++] = c;
+
+    while (_buf_length != 0)
+    {
+        uint8_t command = _match();
+        if (command == DECK_CMD_NONE)
+        {
+            return DECK_CMD_NONE;   // wait for the rest of the sequence
+        }
+        if (command != 0xFF)
+        {
+            _buf_length = 0;
+            deck_command(command);
+            return command;
+        }
+
+        // no match: drop the oldest byte and try again with the rest
+        for (uint8_t i=1; i<_buf_length; i++)
+        {
+            _buf[i-1] = _buf[i];
+        }
+        _buf_length--;
+    }
+    return DECK_CMD_NONE;
+}
+
+/*************************************************************************
+ * Deck State
+ *************************************************************************/
+
+static uint32_t _state_deadline;    // when DECK_LOADING or DECK_WINDING ends
+static uint8_t _play_when_started;  // 1 = run the capstan after the pattern
+
+void deck_init()
+{
+    deck_state = DECK_NO_TAPE;
+    deck_side = DECK_SIDE_A;
+    deck_head = 0;
+    deck_metal = 0;
+    deck_errors = 0;
+    deck_dirty = 0;
+    _buf_length = 0;
+}
+
+static uint8_t _tape_in()
+{
+    return (deck_state != DECK_NO_TAPE) && (deck_state != DECK_EJECTING);
+}
+
+static uint8_t _tape_moving()
+{
+    return (deck_state == DECK_PLAYING) || (deck_state == DECK_HALTED) ||
+           (deck_state == DECK_WINDING) || (deck_state == DECK_FF) ||
+           (deck_state == DECK_REW);
+}
+
+// Enter a state that ends on its own after ms
+static void _set_timed_state(uint8_t state, uint16_t ms)
+{
+    deck_state = state;
+    _state_deadline = timer_now() + TIMER_MS(ms);
+}
+
+// Act on a command from the radio.  Commands that make no sense in the
+// current state are ignored, like the ones the radio sends while the
+// play pattern is still running.
+void deck_command(uint8_t command)
+{
+    switch (command)
+    {
+        case DECK_CMD_LOAD:
+            if (deck_state == DECK_STOPPED)
+            {
+                _set_timed_state(DECK_LOADING, DECK_LOAD_MS);
+                _play_when_started = 0;
+            }
+            break;
+
+        case DECK_CMD_START:
+            if (deck_state == DECK_STOPPED)
+            {
+                deck_state = DECK_STARTING_PLAY;
+                _play_when_started = 0;
+            }
+            break;
+
+        case DECK_CMD_PLAY_A:
+        case DECK_CMD_PLAY_B:
+            deck_side = (command == DECK_CMD_PLAY_A) ? DECK_SIDE_A : DECK_SIDE_B;
+            if (deck_state == DECK_STOPPED)
+            {
+                deck_state = DECK_STARTING_PLAY;
+                _play_when_started = 1;
+            }
+            else if (_tape_moving())
+            {
+                deck_state = DECK_PLAYING;
+            }
+            break;
+
+        case DECK_CMD_HEAD_OFF:
+        case DECK_CMD_HEAD_ON:
+            deck_head = (command == DECK_CMD_HEAD_ON);
+            break;
+
+        case DECK_CMD_MOTOR_IN:
+            if (deck_state == DECK_STOPPED)
+            {
+                _set_timed_state(DECK_LOADING, DECK_LOAD_MS);
+                _play_when_started = 0;
+            }
+            break;
+
+        case DECK_CMD_MOTOR_OUT:
+            if (deck_state == DECK_STOPPED)
+            {
+                deck_state = DECK_EJECTING;
+            }
+            break;
+
+        case DECK_CMD_SIDE_A:
+        case DECK_CMD_SIDE_B:
+            deck_side = (command == DECK_CMD_SIDE_A) ? DECK_SIDE_A : DECK_SIDE_B;
+            if (_tape_moving())
+            {
+                _set_timed_state(DECK_WINDING, DECK_SIDE_CHANGE_MS);
+            }
+            break;
+
+        case DECK_CMD_FF:
+        case DECK_CMD_REW:
+            if (_tape_in() && (deck_state != DECK_STARTING_PLAY) &&
+                (deck_state != DECK_LOADING))
+            {
+                deck_state = (command == DECK_CMD_FF) ? DECK_FF : DECK_REW;
+            }
+            break;
+
+        case DECK_CMD_STOP:
+            if (deck_state == DECK_EJECTING)
+            {
+                deck_state = DECK_NO_TAPE;
+            }
+            else if (_tape_in())
+            {
+                deck_state = DECK_STOPPED;
+            }
+            break;
+
+        case DECK_CMD_EJECT:
+            if (_tape_in())
+            {
+                deck_state = DECK_EJECTING;
+            }
+            break;
+
+        default: // DECK_CMD_POWER_UP: nothing changes
+            break;
+    }
+}
+
+// A tape has been put in (pushbutton)
+void deck_insert()
+{
+    if (deck_state == DECK_NO_TAPE)
+    {
+        deck_state = DECK_STOPPED;
+        deck_side = DECK_SIDE_A;
+    }
+}
+
+// The tape has been taken out, e.g. after an eject.  Also works in
+// any other state, like pulling the tape out of a real deck.
+void deck_remove()
+{
+    deck_state = DECK_NO_TAPE;
+}
+
+// The SWITCH play pattern has finished.  Unless play was started with
+// 0x56 or 0x66, the capstan waits for one of them from the radio.
+void deck_play_started()
+{
+    if (deck_state == DECK_STARTING_PLAY)
+    {
+        deck_state = _play_when_started ? DECK_PLAYING : DECK_HALTED;
+    }
+}
+
+// End loading or a side change once the mechanism would have finished.
+// Called from the main loop.
+void deck_check_timeout()
+{
+    if ((deck_state != DECK_LOADING) && (deck_state != DECK_WINDING))
+    {
+        return;
+    }
+    if ((int32_t)(timer_now() - _state_deadline) < 0)
+    {
+        return;
+    }
+    deck_state = (deck_state == DECK_LOADING) ? DECK_STARTING_PLAY : DECK_HALTED;
+}
+
+uint8_t *deck_state_name(uint8_t state)
+{
+    switch (state)
+    {
+        case DECK_NO_TAPE:          return (uint8_t*)"NO TAPE";
+        case DECK_STOPPED:          return (uint8_t*)"STOPPED";
+        case DECK_STARTING_PLAY:    return (uint8_t*)"STARTING PLAY";
+        case DECK_PLAYING:          return (uint8_t*)"PLAYING";
+        case DECK_HALTED:           return (uint8_t*)"HALTED";
+        case DECK_WINDING:          return (uint8_t*)"WINDING";
+        case DECK_FF:               return (uint8_t*)"FF";
+        case DECK_REW:              return (uint8_t*)"REW";
+        case DECK_EJECTING:         return (uint8_t*)"EJECTING";
+        case DECK_LOADING:          return (uint8_t*)"LOADING";
+        default:                    return (uint8_t*)"?";
+    }
+}
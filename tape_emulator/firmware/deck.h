@@ -0,0 +1,88 @@
+#ifndef DECK_H
+#define DECK_H
+
+#include <stdint.h>
+
+/*************************************************************************
+ * TDA3612 Command Decoder and Deck State
+ *
+ * The radio sends single bytes and short sequences to the TDA3612 (see
+ * reverse_engineering/premium_4/tape.txt).  Sequences are matched against
+ * a table and turned into commands, which move the deck between states.
+ * Loading a tape and changing sides end on their own after the time the
+ * real mechanism takes.  The main loop drives SWITCH, CLOCK, and FE/ME
+ * from the state.
+ *************************************************************************/
+
+// deck states
+#define DECK_NO_TAPE        0   // SWITCH low, no tach
+#define DECK_STOPPED        1   // tape in, motors off: SWITCH high, no tach
+#define DECK_STARTING_PLAY  2   // SWITCH play pattern, tach, then DECK_HALTED
+                                //   (or DECK_PLAYING if started by 0x56/0x66)
+#define DECK_PLAYING        3   // SWITCH low, tach at play speed
+#define DECK_HALTED         4   // in play but capstan stopped: SWITCH low, no tach
+#define DECK_WINDING        5   // changing sides: fast tach, then DECK_HALTED
+#define DECK_FF             6   // fast forward or MSS/BLS seek: fast tach
+#define DECK_REW            7   // rewind or MSS seek: fast tach
+#define DECK_EJECTING       8   // SWITCH high, tach until the motors stop
+#define DECK_LOADING        9   // pulling a tape in: SWITCH high, tach,
+                                //   then DECK_STARTING_PLAY
+
+// commands decoded from the radio
+#define DECK_CMD_NONE       0
+#define DECK_CMD_POWER_UP   1
+#define DECK_CMD_LOAD       2   // tape inserted: pull it in, then play
+#define DECK_CMD_START      3   // start play from stop
+#define DECK_CMD_PLAY_A     4
+#define DECK_CMD_PLAY_B     5
+#define DECK_CMD_HEAD_OFF   6   // disengage the head
+#define DECK_CMD_HEAD_ON    7   // engage the head
+#define DECK_CMD_MOTOR_IN   8   // stopped: pull the tape in, keep motoring
+#define DECK_CMD_MOTOR_OUT  9   // stopped: eject, keep motoring
+#define DECK_CMD_SIDE_A     10
+#define DECK_CMD_SIDE_B     11
+#define DECK_CMD_FF         12
+#define DECK_CMD_REW        13
+#define DECK_CMD_STOP       14  // all motors off
+#define DECK_CMD_EJECT      15
+
+// how long the mechanism takes, measured on a real SCA4.4
+#define DECK_LOAD_MS        620 // 0xAC until the play pattern starts
+                                //   (the pattern's first step makes ~920 ms)
+#define DECK_SIDE_CHANGE_MS 600 // 0xD7 or 0xE7 until the tach stops
+
+#define DECK_SIDE_A 0
+#define DECK_SIDE_B 1
+
+// injected errors (deck_errors)
+#define DECK_ERROR_MONITOR      0x01    // MONITOR low (error condition)
+#define DECK_ERROR_NO_TACH      0x02    // no tach pulses: tape stuck or at its end
+#define DECK_ERROR_NO_PLAY      0x04    // no SWITCH play pattern: play never starts
+#define DECK_ERROR_MASK         0x07
+
+#define DECK_MAX_SEQUENCE 2
+
+typedef struct
+{
+    uint8_t length;
+    uint8_t data[DECK_MAX_SEQUENCE];
+    uint8_t command;
+} deck_sequence_t;
+
+uint8_t deck_state;
+uint8_t deck_side;      // DECK_SIDE_A or DECK_SIDE_B
+uint8_t deck_head;      // 1 = head engaged
+uint8_t deck_metal;     // 1 = metal tape (FE/ME high)
+uint8_t deck_errors;    // DECK_ERROR_* flags
+uint8_t deck_dirty;     // 1 = outputs must be set again (metal or errors changed)
+
+void deck_init();
+uint8_t deck_receive_byte(uint8_t c);
+void deck_command(uint8_t command);
+void deck_insert();
+void deck_remove();
+void deck_play_started();
+void deck_check_timeout();
+uint8_t *deck_state_name(uint8_t state);
+
+#endif
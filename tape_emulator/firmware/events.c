@@ -0,0 +1,62 @@
+#include "main.h"
+#include "events.h"
+#include <stdint.h>
+#include <util/atomic.h>
+
+/*************************************************************************
+ * SPI Event Queue
+ *************************************************************************/
+
+void event_init()
+{
+    event_queue.read_index = 0;
+    event_queue.write_index = 0;
+    event_queue.dropped = 0;
+}
+
+// Producer: called only from SPI_STC_vect
+void event_put(uint32_t ticks, uint8_t data)
+{
+    uint8_t write_index = event_queue.write_index;
+    uint8_t next_index = (write_index + 1) & (EVENT_QUEUE_SIZE - 1);
+    if (next_index == event_queue.read_index)
+    {
+        event_queue.dropped++;
+        return;
+    }
+
+    volatile spi_event_t *event = &event_queue.events[write_index];
+    event->ticks = ticks;
+    event->data = data;
+
+    // publish the event only after it has been written
+    event_queue.write_index = next_index;
+}
+
+// Consumer: called only from the main loop.  Returns 0 if the queue
+// is empty, otherwise copies the oldest event and returns 1.
+uint8_t event_get(spi_event_t *event)
+{
+    uint8_t read_index = event_queue.read_index;
+    if (read_index == event_queue.write_index)
+    {
+        return 0;
+    }
+
+    event->ticks = event_queue.events[read_index].ticks;
+    event->data = event_queue.events[read_index].data;
+
+    // free the slot only after it has been read
+    event_queue.read_index = (read_index + 1) & (EVENT_QUEUE_SIZE - 1);
+    return 1;
+}
+
+uint16_t event_dropped()
+{
+    uint16_t dropped;
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+    {
+        dropped = event_queue.dropped;
+    }
+    return dropped;
+}
@@ -0,0 +1,36 @@
+#ifndef EVENTS_H
+#define EVENTS_H
+
+#include <stdint.h>
+
+/*************************************************************************
+ * SPI Event Queue
+ *
+ * Single producer (SPI_STC_vect), single consumer (main loop).  The
+ * producer only writes write_index and the consumer only writes
+ * read_index, so neither needs to disable interrupts.
+ *************************************************************************/
+
+#define EVENT_QUEUE_SIZE 64     // power of 2, at most 256
+
+typedef struct
+{
+    uint32_t ticks;             // timer_now() when the byte was received
+    uint8_t data;               // byte received from the radio
+} spi_event_t;
+
+typedef struct
+{
+    volatile spi_event_t events[EVENT_QUEUE_SIZE];
+    volatile uint8_t read_index;
+    volatile uint8_t write_index;
+    volatile uint16_t dropped;  // events lost because the queue was full
+} event_queue_t;
+volatile event_queue_t event_queue;
+
+void event_init();
+void event_put(uint32_t ticks, uint8_t data);
+uint8_t event_get(spi_event_t *event);
+uint16_t event_dropped();
+
+#endif
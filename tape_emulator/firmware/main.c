@@ -1,6 +1,11 @@
 #include "main.h"
 #include "uart.h"
 #include "leds.h"
+#include "deck.h"
+#include "signals.h"
+#include "events.h"
+#include "timer.h"
+#include "cmd.h"
 
 #include <stdint.h>
 #include <avr/interrupt.h>
@@ -11,9 +16,6 @@
  * Main
  *************************************************************************/
 
-volatile uint8_t clock_in_use = 0;
-volatile uint8_t state = STATE_IDLE_TAPE_OUT;
-
 /* Blink red forever if an unhandled interrupt occurs.
  * This code should never been called.
  */
@@ -45,22 +47,78 @@ ISR(PCINT1_vect)
     }
 }
 
+// SPI Serial Transfer Complete
+// Only queues the byte; the main loop decodes and prints it
 ISR(SPI_STC_vect)
 {
-    uint8_t c = SPDR;
-    uart_put('0');
-    uart_put('x');
-    uart_puthex_byte(c);
-    uart_put('\n');
-    if ((c == 0xac) || (c == 0xa8))
+    event_put(timer_now(), SPDR);
+}
+
+#define EVENT_LINE_MAX 32   // "0001E240 0xAC\n-> STARTING PLAY\n" plus margin
+
+// Print the deck state and set the outputs if the state has changed
+// since the last call, or set the outputs again if a command has
+// changed the deck
+void update_state()
+{
+    static uint8_t last_state = DECK_NO_TAPE;
+
+    if (deck_state != last_state)
     {
-        uart_puts((uint8_t*)"-> PLAY\n");
-        state = STATE_STARTING_PLAY;
+        if (log_enabled)
+        {
+            uart_puts((uint8_t*)"-> ");
+            uart_puts(deck_state_name(deck_state));
+            uart_put('\n');
+        }
+        last_state = deck_state;
+        signals_apply();
     }
-    else if ((c == 0) && (state == STATE_PLAYING))
+    else if (deck_dirty)
     {
-        uart_puts((uint8_t*)"-> STOP\n");
-        state = STATE_IDLE_TAPE_IN;
+        signals_apply();
+    }
+}
+
+// Decode and print the bytes queued by SPI_STC_vect.  Only as many are
+// handled as can be printed in the UART's transmit buffer, so the main
+// loop never waits.  With the log off, all are decoded and none printed.
+void handle_events()
+{
+    static uint16_t last_dropped = 0;
+    spi_event_t event;
+
+    if (!log_enabled)
+    {
+        while (event_get(&event))
+        {
+            deck_receive_byte(event.data);
+            update_state();
+        }
+        return;
+    }
+
+    uint16_t dropped = event_dropped();
+    if ((dropped != last_dropped) && (uart_tx_free() >= EVENT_LINE_MAX))
+    {
+        uart_puts((uint8_t*)"DROPPED ");
+        uart_puthex_16(dropped - last_dropped);
+        uart_put('\n');
+        last_dropped = dropped;
+    }
+
+    while ((uart_tx_free() >= EVENT_LINE_MAX) && event_get(&event))
+    {
+        uart_puthex_16(event.ticks >> 16);
+        uart_puthex_16(event.ticks);
+        uart_put(' ');
+        uart_put('0');
+        uart_put('x');
+        uart_puthex_byte(event.data);
+        uart_put('\n');
+
+        deck_receive_byte(event.data);
+        update_state();
     }
 }
 
@@ -68,6 +126,13 @@ int main()
 {
     uart_init();
     led_init();
+    timer_init();
+    event_init();
+    deck_init();
+    tach_init();
+    switch_init();
+    cmd_init();
+    log_enabled = 1;
 
     sei();
 
@@ -102,65 +167,40 @@ int main()
     // Pushbutton as input (low=pushed)
     DDRD &= ~_BV(PD4);
 
-    uart_puts((uint8_t*)"RESET!\n\n");
-    uart_flush_tx();
-    led_set(LED_RED, 1);
-    led_set(LED_GREEN, 0);
-
-    DDRB |= _BV(PB1);   // SWITCH as output
-    PORTB &= ~_BV(PB1);  // set SWITCH initially low (no tape inserted)
-    _delay_ms(200);
+    DDRD |= _BV(PD7);   // FE/ME as output
+    DDRA |= _BV(PA0);   // MONITOR as output
 
-    loop_until_bit_is_clear(PIND, PD4); // wait for pushbutton to be pressed
-
-    uart_puts((uint8_t*)"Tape Inserted\n\n");
+    uart_puts((uint8_t*)"RESET!\n\n");
     uart_flush_tx();
-    PORTB |= _BV(PB1); // set SWITCH high (tape inserted)
-    _delay_ms(200);
+    signals_apply();
 
     while (1)
     {
-        if (state == STATE_IDLE_TAPE_OUT)
+        while (buf_has_byte(&uart_rx_buffer))
         {
-            led_set(LED_RED, 1);
-            led_set(LED_GREEN, 0);
-            PORTB &= ~_BV(PB1);  // set SWITCH low (no tape inserted)
+            cmd_receive_byte(buf_read_byte(&uart_rx_buffer));
         }
+        cmd_check_timeout();
+        // a command may have changed the deck; start the SWITCH play
+        // pattern before it is checked below
+        update_state();
 
-        if (state == STATE_IDLE_TAPE_IN)
-        {
-            led_set(LED_RED, 0);
-            led_set(LED_GREEN, 0);
-            PORTB |= _BV(PB1);  // set SWITCH high (tape inserted)
-        }
+        handle_events();
 
-        if (state == STATE_STARTING_PLAY)
+        // pushbutton inserts a tape
+        if ((deck_state == DECK_NO_TAPE) && bit_is_clear(PIND, PD4))
         {
-            // SWITCH is already high
-            _delay_ms(300);
-            PORTB &= ~_BV(PB1); // set SWITCH low
-            _delay_ms(337);
-            PORTB |= _BV(PB1); // set SWITCH high
-            _delay_ms(77);
-            PORTB &= ~_BV(PB1); // set SWITCH low
-
-            state = STATE_PLAYING;
+            deck_insert();
         }
 
-        if ((state == STATE_PLAYING) && (!clock_in_use))
+        // play has started once the SWITCH pattern ends
+        if ((deck_state == DECK_STARTING_PLAY) && !switch_busy() &&
+            !(deck_errors & DECK_ERROR_NO_PLAY))
         {
-            led_set(LED_RED, 0);
-            led_set(LED_GREEN, 1);
-
-            // CLOCK low for 1ms
-            DDRB |= _BV(PB0);
-            PORTB &= ~_BV(PB0); // set CLOCK low
-            _delay_ms(1);
-
-            // CLOCK high for 25ms
-            DDRB &= ~_BV(PB0); // CLOCK as input (external pull-up makes it high)
-            _delay_ms(25);
+            deck_play_started();
         }
-    }
+        deck_check_timeout();
 
+        update_state();
+    }
 }
@@ -5,9 +5,7 @@
 
 #include <stdint.h>
 
-#define STATE_IDLE_TAPE_OUT 0
-#define STATE_STARTING_PLAY 1
-#define STATE_PLAYING 2
-#define STATE_IDLE_TAPE_IN 3
+volatile uint8_t clock_in_use;  // 1 = radio has selected the TDA3612
+uint8_t log_enabled;            // 1 = print bytes and states (CMD_SET_LOG)
 
 #endif
@@ -0,0 +1,295 @@
+#include "main.h"
+#include "deck.h"
+#include "leds.h"
+#include "signals.h"
+#include "timer.h"
+#include <stdint.h>
+#include <avr/interrupt.h>
+#include <avr/io.h>
+#include <util/atomic.h>
+
+/*************************************************************************
+ * Tachometer (CLOCK)
+ *************************************************************************/
+
+static volatile uint16_t _tach_low_counts;
+static volatile uint16_t _tach_high_counts;
+static volatile uint8_t _tach_in_low;   // 1 = in the low phase
+
+void tach_init()
+{
+    // a real SCA4.4 plays at about a 19 ms period and winds at about
+    // 3 ms; the radio also accepts these
+    tach_speeds[TACH_PLAY].low_us = 1000;
+    tach_speeds[TACH_PLAY].high_us = 25000;
+    tach_speeds[TACH_FF].low_us = 1000;
+    tach_speeds[TACH_FF].high_us = 2000;
+    tach_speeds[TACH_REW].low_us = 1000;
+    tach_speeds[TACH_REW].high_us = 2000;
+
+    TCCR1A = 0;
+    TCCR1B = 0;     // stopped
+    TIMSK1 = 0;
+    _tach_in_low = 0;
+}
+
+// Start the pulse train or change its speed.  A new speed takes effect
+// at the next phase.
+void tach_start(uint8_t speed)
+{
+    uint16_t low = TACH_COUNTS(tach_speeds[speed].low_us);
+    uint16_t high = TACH_COUNTS(tach_speeds[speed].high_us);
+
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+    {
+        _tach_low_counts = (low == 0) ? 1 : low;
+        _tach_high_counts = (high == 0) ? 1 : high;
+
+        if (TCCR1B == 0)
+        {
+            // start with the high phase
+            _tach_in_low = 0;
+            TCNT1 = 0;
+            OCR1A = _tach_high_counts - 1;
+            TIFR1 = _BV(OCF1A);
+            TIMSK1 = _BV(OCIE1A);
+            TCCR1B = _BV(WGM12) | _BV(CS11) | _BV(CS10); // CTC mode, prescaler 64
+        }
+    }
+}
+
+void tach_stop()
+{
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+    {
+        TCCR1B = 0;
+        TIMSK1 = 0;
+        _tach_in_low = 0;
+        DDRB &= ~_BV(PB0); // CLOCK as input (external pull-up makes it high)
+    }
+}
+
+// Timer1 Compare A: end of a tachometer phase
+ISR(TIMER1_COMPA_vect)
+{
+    if (_tach_in_low)
+    {
+        DDRB &= ~_BV(PB0); // CLOCK as input (external pull-up makes it high)
+        OCR1A = _tach_high_counts - 1;
+        _tach_in_low = 0;
+    }
+    else
+    {
+        // keep timing while the radio uses CLOCK, but don't drive it
+        if (!clock_in_use)
+        {
+            PORTB &= ~_BV(PB0); // set CLOCK low
+            DDRB |= _BV(PB0);
+        }
+        OCR1A = _tach_low_counts - 1;
+        _tach_in_low = 1;
+    }
+}
+
+/*************************************************************************
+ * SWITCH Waveform Player
+ *************************************************************************/
+
+static volatile switch_step_t *_steps;
+static volatile uint8_t _steps_length;
+static volatile uint8_t _step_index;
+static volatile uint32_t _step_ticks_left;
+
+static void _switch_write(uint8_t level)
+{
+    if (level)
+    {
+        PORTB |= _BV(PB1); // set SWITCH high
+    }
+    else
+    {
+        PORTB &= ~_BV(PB1); // set SWITCH low
+    }
+}
+
+void switch_init()
+{
+    // play: SWITCH is already high (tape inserted), then low, high, low
+    switch_play_pattern[0].level = 1;
+    switch_play_pattern[0].ms = 300;
+    switch_play_pattern[1].level = 0;
+    switch_play_pattern[1].ms = 337;
+    switch_play_pattern[2].level = 1;
+    switch_play_pattern[2].ms = 77;
+    switch_play_pattern[3].level = 0;
+    switch_play_pattern[3].ms = 0;
+    switch_play_pattern_length = 4;
+
+    _steps_length = 0;
+    DDRB |= _BV(PB1);   // SWITCH as output
+    _switch_write(0);   // set SWITCH initially low (no tape inserted)
+}
+
+// Set SWITCH now, cancelling any waveform being played
+void switch_set(uint8_t level)
+{
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+    {
+        _steps_length = 0;
+        _switch_write(level);
+    }
+}
+
+// Play a list of steps.  The steps must not change until it finishes.
+void switch_play(switch_step_t *steps, uint8_t length)
+{
+    if (length == 0)
+    {
+        return;
+    }
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+    {
+        _steps = steps;
+        _steps_length = length;
+        _step_index = 0;
+        _step_ticks_left = TIMER_MS(steps[0].ms);
+        _switch_write(steps[0].level);
+        if (length == 1)
+        {
+            _steps_length = 0;  // hold the only level
+        }
+    }
+}
+
+// Returns true while a waveform is playing
+uint8_t switch_busy()
+{
+    return _steps_length != 0;
+}
+
+// Step the waveform.  Called from the timer interrupt on every tick.
+void switch_tick()
+{
+    if (_steps_length == 0)
+    {
+        return;
+    }
+    if (_step_ticks_left != 0)
+    {
+        _step_ticks_left--;
+        return;
+    }
+
+    _step_index++;
+    _switch_write(_steps[_step_index].level);
+    if (_step_index == _steps_length - 1)
+    {
+        _steps_length = 0;  // hold the last level
+    }
+    else
+    {
+        _step_ticks_left = TIMER_MS(_steps[_step_index].ms);
+    }
+}
+
+/*************************************************************************
+ * Deck Outputs
+ *************************************************************************/
+
+// Run the tach unless it has been turned off (DECK_ERROR_NO_TACH)
+static void _tach_run(uint8_t speed)
+{
+    if (deck_errors & DECK_ERROR_NO_TACH)
+    {
+        tach_stop();
+    }
+    else
+    {
+        tach_start(speed);
+    }
+}
+
+// Set the outputs for the deck state and injected errors.  Called when
+// the state changes or a command has changed the deck (deck_dirty).
+void signals_apply()
+{
+    deck_dirty = 0;
+
+    switch (deck_state)
+    {
+        case DECK_NO_TAPE:
+            led_set(LED_RED, 1);
+            led_set(LED_GREEN, 0);
+            tach_stop();
+            switch_set(0);  // no tape inserted
+            break;
+
+        case DECK_STOPPED:
+            led_set(LED_RED, 0);
+            led_set(LED_GREEN, 0);
+            tach_stop();
+            switch_set(1);  // tape inserted
+            break;
+
+        case DECK_LOADING:
+        case DECK_EJECTING:
+            led_set(LED_RED, 0);
+            led_set(LED_GREEN, 0);
+            _tach_run(TACH_FF); // the mechanism is moving
+            switch_set(1);
+            break;
+
+        case DECK_STARTING_PLAY:
+            _tach_run(TACH_FF);
+            if (deck_errors & DECK_ERROR_NO_PLAY)
+            {
+                switch_set(1);  // never tell the radio play has started
+            }
+            else
+            {
+                switch_play(switch_play_pattern, switch_play_pattern_length);
+            }
+            break;
+
+        case DECK_HALTED:
+            tach_stop();
+            switch_set(0);
+            break;
+
+        default: // DECK_PLAYING, DECK_WINDING, DECK_FF, DECK_REW
+            led_set(LED_RED, 0);
+            led_set(LED_GREEN, 1);
+            switch_set(0);
+            if (deck_state == DECK_PLAYING)
+            {
+                _tach_run(TACH_PLAY);
+            }
+            else if (deck_state == DECK_REW)
+            {
+                _tach_run(TACH_REW);
+            }
+            else
+            {
+                _tach_run(TACH_FF);
+            }
+            break;
+    }
+
+    if (deck_metal)
+    {
+        PORTD |= _BV(PD7); // set FE/ME high (metal tape)
+    }
+    else
+    {
+        PORTD &= ~_BV(PD7); // set FE/ME low (non-metal tape)
+    }
+
+    if (deck_errors & DECK_ERROR_MONITOR)
+    {
+        PORTA &= ~_BV(PA0); // set MONITOR low (deck fault)
+    }
+    else
+    {
+        PORTA |= _BV(PA0); // set MONITOR high (deck ok)
+    }
+}
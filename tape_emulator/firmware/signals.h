@@ -0,0 +1,62 @@
+#ifndef SIGNALS_H
+#define SIGNALS_H
+
+#include <stdint.h>
+
+/*************************************************************************
+ * SWITCH and CLOCK (tachometer) Outputs
+ *
+ * The tachometer pulse train is made by Timer1: each compare match ends
+ * one phase and loads the length of the next, so the CPU is only
+ * interrupted twice per pulse.  CLOCK is only driven low while the
+ * radio is not using it (clock_in_use).
+ *
+ * SWITCH waveforms are lists of (level, ms) steps played from the
+ * system tick.  The last step's level is held.
+ *
+ * signals_apply() sets all of the deck's outputs for its state.
+ *************************************************************************/
+
+// tachometer speeds
+#define TACH_PLAY   0
+#define TACH_FF     1   // also winding and MSS/BLS seeks
+#define TACH_REW    2
+#define TACH_NUM_SPEEDS 3
+
+typedef struct
+{
+    uint16_t low_us;    // CLOCK pulled low
+    uint16_t high_us;   // CLOCK released (pulled up by the radio)
+} tach_speed_t;
+
+// Timer1 runs at F_CPU/64 (3.2 us per count at 20 MHz), so each
+// phase can be up to about 200 ms
+#define TACH_COUNTS(us) ((uint16_t)(((uint32_t)(us) * (F_CPU / 64 / 1000)) / 1000))
+
+tach_speed_t tach_speeds[TACH_NUM_SPEEDS];
+
+void tach_init();
+void tach_start(uint8_t speed);
+void tach_stop();
+
+typedef struct
+{
+    uint8_t level;      // SWITCH level for this step
+    uint16_t ms;        // how long to hold it; ignored for the last step
+} switch_step_t;
+
+#define SWITCH_MAX_STEPS 8
+
+// SWITCH pattern that tells the radio the tape has started playing
+switch_step_t switch_play_pattern[SWITCH_MAX_STEPS];
+uint8_t switch_play_pattern_length;
+
+void switch_init();
+void switch_set(uint8_t level);
+void switch_play(switch_step_t *steps, uint8_t length);
+uint8_t switch_busy();
+void switch_tick();
+
+void signals_apply();
+
+#endif
@@ -0,0 +1,42 @@
+#include "main.h"
+#include "timer.h"
+#include "signals.h"
+#include <stdint.h>
+#include <avr/interrupt.h>
+#include <avr/io.h>
+#include <util/atomic.h>
+
+/*************************************************************************
+ * System Tick
+ *************************************************************************/
+
+static volatile uint32_t _ticks;
+
+// Start Timer3 as a free-running 10 kHz tick
+void timer_init()
+{
+    _ticks = 0;
+    TCCR3A = 0;
+    TCCR3B = _BV(WGM32) | _BV(CS31);            // CTC mode, prescaler 8
+    OCR3A = (F_CPU / 8 / TIMER_TICKS_PER_SEC) - 1;
+    TCNT3 = 0;
+    TIMSK3 = _BV(OCIE3A);                       // Enable compare A int
+}
+
+// Number of ticks since timer_init(); wraps after about 5 days
+uint32_t timer_now()
+{
+    uint32_t ticks;
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+    {
+        ticks = _ticks;
+    }
+    return ticks;
+}
+
+// Timer3 Compare A: one system tick
+ISR(TIMER3_COMPA_vect)
+{
+    _ticks++;
+    switch_tick();
+}
@@ -0,0 +1,14 @@
+#ifndef TIMER_H
+#define TIMER_H
+
+#include <stdint.h>
+
+// Timer3 ticks at 10 kHz (100 us per tick)
+#define TIMER_TICKS_PER_SEC     10000UL
+#define TIMER_TICKS_PER_MS      (TIMER_TICKS_PER_SEC / 1000)
+#define TIMER_MS(ms)            ((uint32_t)(ms) * TIMER_TICKS_PER_MS)
+
+void timer_init();
+uint32_t timer_now();
+
+#endif
@@ -59,8 +59,16 @@ void uart_flush_tx()
     while (buf_has_byte(&uart_tx_buffer)) {}
 }
 
+// Number of bytes that can be queued without overwriting unsent ones
+uint8_t uart_tx_free()
+{
+    return uart_tx_buffer.read_index - uart_tx_buffer.write_index - 1;
+}
+
+// Waits for room in the transmit buffer.  Must not be called from an ISR.
 void uart_put(uint8_t c)
 {
+    while (uart_tx_free() == 0) {}
     buf_write_byte(&uart_tx_buffer, c);
     // Enable UDRE interrupts
     UCSR0B |= _BV(UDRIE0);
@@ -26,6 +26,7 @@ volatile ringbuffer_t uart_tx_buffer;
 
 void uart_init();
 void uart_flush_tx();
+uint8_t uart_tx_free();
 void uart_put(uint8_t c);
 void uart_put16(uint16_t w);
 void uart_puts(uint8_t *str);
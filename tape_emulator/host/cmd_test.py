@@ -0,0 +1,70 @@
+#!/usr/bin/env python3 -u
+'''
+Sends commands from the host (see firmware/cmd.c) to the host build of
+the tape emulator (see ../native) and checks that the deck responds to
+them the way it does to the same bytes from the radio.
+
+Usage: %s
+
+A command that starts play must send the SWITCH play pattern before the
+deck halts or plays.  The exit status is 1 if any check fails.
+'''
+
+import sys
+from replay import emulate
+
+CMD_DECK_SET_ERRORS = 0x13  # see firmware/cmd.h
+CMD_DECK_RECEIVE = 0x14
+DECK_ERROR_NO_PLAY = 0x04   # see firmware/deck.h
+PLAY_PATTERN = 0.714    # default SWITCH play pattern (see firmware/signals.c)
+TOLERANCE = 0.002
+
+
+def cmd(secs, *data):
+    data = (len(data),) + data
+    return '%.1f cmd %s' % (secs * 1e6, ' '.join('%02X' % c for c in data))
+
+def state_time(states, name, after=0):
+    times = [t for t, s in states if s == name and t >= after]
+    return times[0] if times else None
+
+def check_play_pattern(name, inputs, started, until='HALTED'):
+    '''Checks that the SWITCH play pattern runs from started until the
+    deck changes to the state until'''
+    switch, _, states, _ = emulate(inputs, [])
+    halted = state_time(states, until, started)
+    edges = [t for t, _ in switch if started <= t < (halted or 0)]
+    ok = (halted is not None and len(edges) >= 2 and
+          abs(halted - started - PLAY_PATTERN) < TOLERANCE)
+    print("%s  %-40s %d SWITCH edges, %s after %s ms" % (
+        'PASS' if ok else 'FAIL', name, len(edges), until,
+        '%.1f' % ((halted - started) * 1000) if halted is not None else '-'))
+    return ok
+
+def main():
+    if len(sys.argv) != 1:
+        sys.stderr.write((__doc__.strip() + '\n') % sys.argv[0])
+        sys.exit(1)
+
+    results = []
+    results.append(check_play_pattern(
+        "CMD_DECK_RECEIVE A8",
+        ['0 insert', cmd(0.1, CMD_DECK_RECEIVE, 0xA8), '2000000 end'],
+        0.1))
+    results.append(check_play_pattern(
+        "CMD_DECK_RECEIVE DF 56",
+        ['0 insert', cmd(0.1, CMD_DECK_RECEIVE, 0xDF, 0x56), '2000000 end'],
+        0.1, 'PLAYING'))
+
+    # no play pattern until the error is cleared in STARTING PLAY
+    results.append(check_play_pattern(
+        "CMD_DECK_SET_ERRORS 00 in STARTING PLAY",
+        ['0 insert', cmd(0.1, CMD_DECK_SET_ERRORS, DECK_ERROR_NO_PLAY),
+         cmd(0.2, CMD_DECK_RECEIVE, 0xA8), cmd(1.5, CMD_DECK_SET_ERRORS, 0),
+         '3000000 end'],
+        1.5))
+
+    sys.exit(0 if all(results) else 1)
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,130 @@
+'''
+Reads the edges of each channel from a Saleae Logic 1.x capture
+(.logicdata, or .logicdata.gz like the captures in
+reverse_engineering/premium_4/captures/sca44).
+
+The format is not documented.  This is what was worked out from the
+SCA4.4 captures.  Each channel with any edges has its time between edges
+(phases) stored in two arrays: phases shorter than 32768 samples as
+16-bit words, and longer ones as 32-bit words.  The top bit of each word
+is the level during the phase, the rest is its length in samples.  The
+first 32-bit word is the sample of the first edge.  Each array is
+preceded by its length three times, as a portable binary archive
+integer: a size byte followed by that many little endian bytes.
+
+The two arrays are merged by following the levels, which alternate: the
+next 16-bit word is used if its level fits, otherwise the next 32-bit
+word.  When both fit, the short phase is tried first, and the long one if
+that leads to a dead end.  That usually but not always puts a short
+glitch next to the right long phase.  The last long phases of a capture
+may be missing, so its edges can stop a little early.  A channel in which
+the levels do not work out is skipped.
+
+Example:
+  channels = read_channels('tape-inserted.logicdata.gz')
+  for sample, level in channels[0]:
+      print(sample / float(SAMPLE_RATE), level)
+'''
+
+import gzip
+import re
+import struct
+
+SAMPLE_RATE = 16000000  # all of the SCA4.4 captures
+MAX_BACKTRACKS = 10000
+
+_MARKER = b'\xff' * 8   # ends the data of each channel
+_HEADER = re.compile(b'(\x00|\x01.|\x02..|\x03...)\x00\\1\x00\\1', re.S)
+
+
+def read_channels(path):
+    '''Returns a dict of channel number: [(sample, new level), ...]'''
+    opener = gzip.open if path.endswith('.gz') else open
+    with opener(path, 'rb') as f:
+        return decode(f.read())
+
+def decode(data):
+    markers = [m.start() for m in re.finditer(re.escape(_MARKER), data)]
+    channels = {}
+    for m in _HEADER.finditer(data):
+        channel = len([x for x in markers if x < m.start()])
+        if channel >= len(markers):
+            continue
+        edges = _read_phases(data, m)
+        if edges is not None and len(edges) > len(channels.get(channel, ())):
+            channels[channel] = edges
+    return channels
+
+def _read_int(encoded):
+    return int.from_bytes(encoded[1:], 'little')
+
+def _read_phases(data, m):
+    '''Try to read the two arrays of phases at a header match.  Returns
+    the edges, or None if they are not there.'''
+    num_short = _read_int(m.group(1))
+    start = m.end()
+    end = start + (num_short * 2)
+    if end > len(data):
+        return None
+
+    # a few bytes may come between the arrays
+    for gap in range(8):
+        m2 = _HEADER.match(data, end + gap)
+        if m2 and _read_int(m2.group(1)) > 0:
+            break
+    else:
+        return None
+    num_long = _read_int(m2.group(1))
+    if m2.end() + (num_long * 4) > len(data):
+        return None
+
+    short = struct.unpack('<%dH' % num_short, data[start:end])
+    long = struct.unpack('<%dI' % num_long, data[m2.end():m2.end() + (num_long * 4)])
+    return _merge(short, long)
+
+def _merge(short, long):
+    # choice points: (i, j, level, number of phases) where both arrays fit
+    choices = []
+    phases = []
+    level = None
+    i = 0
+    j = 1
+    steps = 0
+    while i < len(short) or j < len(long):
+        want = None if level is None else 1 - level
+        fits_short = i < len(short) and (want is None or (short[i] >> 15) == want)
+        fits_long = j < len(long) and (want is None or (long[j] >> 31) == want)
+        if fits_short:
+            if fits_long:
+                choices.append((i, j, level, len(phases)))
+            phases.append(short[i] & 0x7FFF)
+            level = short[i] >> 15
+            i += 1
+        elif fits_long:
+            phases.append(long[j] & 0x7FFFFFFF)
+            level = long[j] >> 31
+            j += 1
+        elif j == len(long):
+            break   # the capture ended before the last long phases
+        elif choices and steps < MAX_BACKTRACKS:
+            i, j, level, count = choices.pop()
+            del phases[count:]
+            phases.append(long[j] & 0x7FFFFFFF)
+            level = long[j] >> 31
+            j += 1
+            steps += 1
+        else:
+            return None
+    if len(phases) < 2:
+        return None     # seen for channels without edges
+
+    # levels alternate, so the first is known from the last
+    level ^= len(phases) & 1
+    sample = long[0] & 0x7FFFFFFF
+    edges = []
+    for length in phases:
+        level = 1 - level
+        edges.append((sample, level))
+        sample += length
+    edges.append((sample, 1 - level))   # end of the last phase
+    return edges
@@ -0,0 +1,182 @@
+'''
+Client for the command interface of the tape emulator firmware
+(see firmware/cmd.c).  Commands are sent to the serial port, which also
+carries the text log of bytes from the radio.  make_client() turns the
+log off so it does not mix with the replies.
+
+Example:
+  client = make_client()
+  client.deck_set_metal(True)
+  client.deck_insert()
+  client.tach_set_speed(TACH_PLAY, 1000, 19000)
+  print(client.deck_dump_state())
+'''
+
+import struct
+import time
+import serial # pyserial
+
+CMD_ECHO = 0x02
+CMD_SET_LOG = 0x03
+CMD_DECK_INSERT = 0x10
+CMD_DECK_REMOVE = 0x11
+CMD_DECK_SET_METAL = 0x12
+CMD_DECK_SET_ERRORS = 0x13
+CMD_DECK_RECEIVE = 0x14
+CMD_DECK_DUMP_STATE = 0x15
+CMD_TACH_SET_SPEED = 0x20
+CMD_SWITCH_SET_PLAY_PATTERN = 0x21
+
+ERROR_OK = 0x00
+ERROR_NO_COMMAND = 0x01
+ERROR_BAD_COMMAND = 0x02
+ERROR_BAD_ARGS_LENGTH = 0x03
+ERROR_BAD_ARGS_VALUE = 0x04
+ERROR_BAD_STATE = 0x05
+
+# deck states (see firmware/deck.h)
+DECK_STATES = {
+    0: 'NO TAPE',
+    1: 'STOPPED',
+    2: 'STARTING PLAY',
+    3: 'PLAYING',
+    4: 'HALTED',
+    5: 'WINDING',
+    6: 'FF',
+    7: 'REW',
+    8: 'EJECTING',
+    9: 'LOADING',
+}
+
+# injected errors (see firmware/deck.h)
+DECK_ERROR_MONITOR = 0x01   # MONITOR low
+DECK_ERROR_NO_TACH = 0x02   # no CLOCK pulses while the capstan runs
+DECK_ERROR_NO_PLAY = 0x04   # SWITCH never reports play started
+
+# tachometer speeds (see firmware/signals.h)
+TACH_PLAY = 0
+TACH_FF = 1
+TACH_REW = 2
+TACH_NUM_SPEEDS = 3
+SWITCH_MAX_STEPS = 8
+
+TICKS_PER_SEC = 10000
+
+
+class Client(object):
+    def __init__(self, ser):
+        self.serial = ser
+
+    # High level ==============================================================
+
+    def echo(self, data):
+        rx_bytes = self.command(bytearray([CMD_ECHO]) + bytearray(data))
+        return rx_bytes[1:]
+
+    def set_log(self, enabled):
+        '''Turn the text log of bytes and states on or off'''
+        self.command([CMD_SET_LOG, int(bool(enabled))])
+
+    def deck_insert(self):
+        self.command([CMD_DECK_INSERT])
+
+    def deck_remove(self):
+        self.command([CMD_DECK_REMOVE])
+
+    def deck_set_metal(self, metal):
+        self.command([CMD_DECK_SET_METAL, int(bool(metal))])
+
+    def deck_set_errors(self, flags):
+        '''Inject DECK_ERROR_* flags.  0 clears them.'''
+        self.command([CMD_DECK_SET_ERRORS, flags])
+
+    def deck_receive(self, data):
+        '''Decode bytes as if the radio had sent them.  Returns the state.'''
+        rx_bytes = self.command(bytearray([CMD_DECK_RECEIVE]) + bytearray(data))
+        return rx_bytes[1]
+
+    def deck_dump_state(self):
+        '''Returns a dict of the deck state, tachometer speeds as
+        (low us, high us), SWITCH play pattern as (level, ms), and
+        whether the head is engaged'''
+        data = bytes(self.command([CMD_DECK_DUMP_STATE])[1:])
+        state, side, metal, errors, dropped, ticks = struct.unpack('<BBBBHL', data[0:10])
+        offset = 10
+        speeds = []
+        for i in range(TACH_NUM_SPEEDS):
+            speeds.append(struct.unpack('<HH', data[offset:offset + 4]))
+            offset += 4
+        length = data[offset]
+        offset += 1
+        pattern = []
+        for i in range(length):
+            pattern.append(struct.unpack('<BH', data[offset + i*3:offset + i*3 + 3]))
+        head = data[offset + SWITCH_MAX_STEPS*3]
+        return {'state': DECK_STATES.get(state, '???'),
+                'side': 'B' if side else 'A',
+                'metal': bool(metal),
+                'errors': errors,
+                'dropped': dropped,
+                'seconds': ticks / float(TICKS_PER_SEC),
+                'tach_speeds': speeds,
+                'switch_play_pattern': pattern,
+                'head': bool(head)}
+
+    def tach_set_speed(self, speed, low_us, high_us):
+        self.command([CMD_TACH_SET_SPEED, speed] +
+                     list(struct.pack('<HH', low_us, high_us)))
+
+    def switch_set_play_pattern(self, steps):
+        '''steps is a list of (level, ms).  The last level is held.'''
+        data = bytearray([CMD_SWITCH_SET_PLAY_PATTERN])
+        for level, ms in steps:
+            data.extend(struct.pack('<BH', level, ms))
+        self.command(data)
+
+    # Low level ===============================================================
+
+    def command(self, data, ignore_error=False):
+        self.send(data)
+        return self.receive(ignore_error)
+
+    def send(self, data):
+        self.serial.write(bytearray([len(data)] + list(data)))
+        self.serial.flush()
+
+    def receive(self, ignore_error=False):
+        head = self.serial.read(1)
+        if len(head) == 0:
+            raise Exception("Timeout: No reply header byte received")
+        expected_num_bytes = ord(head)
+
+        rx_bytes = bytearray(self.serial.read(expected_num_bytes))
+        if len(rx_bytes) < expected_num_bytes:
+            raise Exception("Timeout: Expected reply of %d bytes, got %d: %r" % (
+                expected_num_bytes, len(rx_bytes), rx_bytes))
+
+        if (not ignore_error) and (rx_bytes[0] != ERROR_OK):
+            raise Exception("Command error: %d" % rx_bytes[0])
+        return rx_bytes
+
+    def resync(self):
+        '''Wait out the firmware's command timeout and discard anything
+        received, e.g. the log or a partial reply.'''
+        time.sleep(2.5)
+        self.serial.reset_input_buffer()
+
+
+def make_serial():
+    from serial.tools.list_ports import comports
+    names = [ x.device for x in comports() if 'Bluetooth' not in x.device ]
+    if not names:
+        raise Exception("No serial port found")
+    return serial.Serial(port=names[0], baudrate=115200, timeout=2)
+
+def make_client(serial=None):
+    if serial is None:
+        serial = make_serial()
+    client = Client(serial)
+    # the log may be running; turn it off, then drop the rest of it
+    client.send([CMD_SET_LOG, 0])
+    client.resync()
+    return client
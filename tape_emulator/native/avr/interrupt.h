@@ -0,0 +1,14 @@
+#ifndef NATIVE_AVR_INTERRUPT_H
+#define NATIVE_AVR_INTERRUPT_H
+
+// Host build: interrupt handlers are plain functions called by the
+// simulation in main.c
+
+#define ISR(vector) void vector(void)
+
+#define TIMER1_COMPA_vect native_timer1_compa
+
+#define sei()
+#define cli()
+
+#endif
@@ -0,0 +1,38 @@
+#ifndef NATIVE_AVR_IO_H
+#define NATIVE_AVR_IO_H
+
+// Host build: the registers used by the deck outputs are plain
+// variables (see main.c for how Timer1 and the pins are simulated)
+
+#include <stdint.h>
+
+#define _BV(bit) (1 << (bit))
+
+extern volatile uint8_t DDRA;
+extern volatile uint8_t PORTA;
+extern volatile uint8_t DDRB;
+extern volatile uint8_t PORTB;
+extern volatile uint8_t DDRD;
+extern volatile uint8_t PORTD;
+
+extern volatile uint8_t TCCR1A;
+extern volatile uint8_t TCCR1B;
+extern volatile uint16_t TCNT1;
+extern volatile uint16_t OCR1A;
+extern volatile uint8_t TIFR1;
+extern volatile uint8_t TIMSK1;
+
+#define PA0     0
+#define PB0     0
+#define PB1     1
+#define PD5     5
+#define PD6     6
+#define PD7     7
+
+#define CS10    0
+#define CS11    1
+#define WGM12   3
+#define OCF1A   1
+#define OCIE1A  1
+
+#endif
@@ -0,0 +1,411 @@
+#include "main.h"
+#include "cmd.h"
+#include "deck.h"
+#include "events.h"
+#include "leds.h"
+#include "native.h"
+#include "signals.h"
+#include "timer.h"
+#include "uart.h"
+#include <avr/io.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*************************************************************************
+ * Capture Replay
+ *
+ * Runs the deck decoder, state machine, and outputs from the firmware
+ * against bytes from the radio read from stdin, usually sent by
+ * host/replay.py from a capture of a real SCA4.4.  Time is simulated in
+ * CPU cycles.  The Timer3 tick, the Timer1 compare matches, and the
+ * edges of /ENABLE are events, and the main loop runs after each one,
+ * so the timing of the outputs does not depend on the host.
+ *
+ * Input lines (times in us from the start of the capture):
+ *   <us> insert                tape put in (pushbutton)
+ *   <us> remove                tape taken out
+ *   <us> byte <hex> <low us>   /ENABLE low for <low us>, byte received
+ *                              when it goes high
+ *   <us> cmd <hex> ...         command from the host (see firmware/cmd.c),
+ *                              starting with its length, received on the
+ *                              UART one byte every UART_BYTE_US
+ *   <us> end                   stop the simulation
+ *
+ * Output lines:
+ *   <us> SWITCH <level>        SWITCH changed
+ *   <us> CLOCK <level>         CLOCK changed (only as driven by the deck)
+ *   <us> STATE <name>          deck state changed
+ *   <us> BYTE <hex> <queued us>
+ *                              byte decoded by deck_receive_byte(); it was
+ *                              queued by SPI_STC_vect at <queued us>
+ *   <us> APPLY                 signals_apply() set the outputs
+ *   <us> UART <hex>            byte sent on the UART (a command's reply)
+ *
+ * The main loop takes no simulated time, so the time from queueing a byte
+ * to decoding it is only the resolution of the tick it is stamped with.
+ *************************************************************************/
+
+volatile uint8_t DDRA;
+volatile uint8_t PORTA;
+volatile uint8_t DDRB;
+volatile uint8_t PORTB;
+volatile uint8_t DDRD;
+volatile uint8_t PORTD;
+volatile uint8_t TCCR1A;
+volatile uint8_t TCCR1B;
+volatile uint16_t TCNT1;
+volatile uint16_t OCR1A;
+volatile uint8_t TIFR1;
+volatile uint8_t TIMSK1;
+
+#define CYCLES_PER_US       (F_CPU / 1000000)
+#define CYCLES_PER_TICK     (F_CPU / TIMER_TICKS_PER_SEC)
+#define CYCLES_PER_COUNT1   64      // Timer1 prescaler
+#define NEVER               UINT64_MAX
+
+#define INPUT_INSERT        0
+#define INPUT_REMOVE        1
+#define INPUT_SELECT        2       // /ENABLE high->low
+#define INPUT_BYTE          3       // byte received, /ENABLE low->high
+#define INPUT_CMD           4       // byte received on the UART
+#define INPUT_END           5
+
+#define UART_BYTE_US        87      // 10 bits at 115200 baud
+
+typedef struct
+{
+    uint64_t cycles;
+    uint8_t type;
+    uint8_t data;
+} input_t;
+
+static const char *usage =
+    "Usage: %s [-t <speed>:<low us>:<high us>] [-w <level>:<ms>,...] < input\n"
+    "  -t  tachometer speed (0=play, 1=ff, 2=rew), may be repeated\n"
+    "  -w  SWITCH play pattern, e.g. 1:300,0:337,1:77,0:0\n";
+
+static uint64_t _now;               // simulated time in CPU cycles
+static uint64_t _next_compare;      // next Timer1 compare match or NEVER
+static uint8_t _last_state;
+static int8_t _last_switch = -1;
+static int8_t _last_clock = -1;
+static int16_t _uart_rx = -1;       // byte received on the UART or -1
+
+static input_t *_inputs;
+static size_t _num_inputs;
+
+static double _us(uint64_t cycles)
+{
+    return (double)cycles / CYCLES_PER_US;
+}
+
+// The UART of firmware/uart.c, for the replies of firmware/cmd.c
+void uart_put(uint8_t c)
+{
+    printf("%.1f UART %02X\n", _us(_now), c);
+}
+
+void uart_put16(uint16_t w)
+{
+    uart_put(w & 0xFF);
+    uart_put(w >> 8);
+}
+
+// Timer1 is started by tach_start() writing TCNT1=0 and stopped by
+// tach_stop() writing TCCR1B=0.  While it runs, TCNT1 is kept nonzero
+// so a restart can be seen.
+static void _sync_timer1()
+{
+    if (TCCR1B == 0)
+    {
+        _next_compare = NEVER;
+    }
+    else if ((_next_compare == NEVER) || (TCNT1 == 0))
+    {
+        _next_compare = _now + (uint64_t)(OCR1A + 1) * CYCLES_PER_COUNT1;
+        TCNT1 = 1;
+    }
+}
+
+static void _print_outputs()
+{
+    int8_t level = (PORTB & _BV(PB1)) != 0;
+    if (level != _last_switch)
+    {
+        printf("%.1f SWITCH %d\n", _us(_now), level);
+        _last_switch = level;
+    }
+
+    // open collector: only a low driven by the deck counts
+    level = !((DDRB & _BV(PB0)) && !(PORTB & _BV(PB0)));
+    if (level != _last_clock)
+    {
+        printf("%.1f CLOCK %d\n", _us(_now), level);
+        _last_clock = level;
+    }
+}
+
+// Same as update_state() in firmware/main.c
+static void _update_state()
+{
+    if (deck_state != _last_state)
+    {
+        printf("%.1f STATE %s\n", _us(_now), deck_state_name(deck_state));
+        _last_state = deck_state;
+        printf("%.1f APPLY\n", _us(_now));
+        signals_apply();
+    }
+    else if (deck_dirty)
+    {
+        printf("%.1f APPLY\n", _us(_now));
+        signals_apply();
+    }
+}
+
+// One pass of the main loop in firmware/main.c
+static void _main_loop()
+{
+    if (_uart_rx >= 0)
+    {
+        cmd_receive_byte(_uart_rx);
+        _uart_rx = -1;
+    }
+    cmd_check_timeout();
+    _update_state();
+
+    spi_event_t event;
+    while (event_get(&event))
+    {
+        printf("%.1f BYTE %02X %.1f\n", _us(_now), event.data,
+               (double)event.ticks * 1000000 / TIMER_TICKS_PER_SEC);
+        deck_receive_byte(event.data);
+        _update_state();
+    }
+
+    if ((deck_state == DECK_STARTING_PLAY) && !switch_busy() &&
+        !(deck_errors & DECK_ERROR_NO_PLAY))
+    {
+        deck_play_started();
+    }
+    deck_check_timeout();
+
+    _update_state();
+    _sync_timer1();
+    _print_outputs();
+}
+
+static void _handle_input(input_t *input)
+{
+    switch (input->type)
+    {
+        case INPUT_INSERT:
+            deck_insert();
+            break;
+        case INPUT_REMOVE:
+            deck_remove();
+            break;
+        case INPUT_SELECT:
+            // PCINT1_vect: /ENABLE high->low
+            DDRB &= ~_BV(PB0); // CLOCK as input
+            clock_in_use = 1;
+            break;
+        case INPUT_BYTE:
+            // SPI_STC_vect, then PCINT1_vect: /ENABLE low->high
+            event_put(timer_now(), input->data);
+            clock_in_use = 0;
+            break;
+        case INPUT_CMD:
+            // USART0_RX_vect
+            _uart_rx = input->data;
+            break;
+    }
+}
+
+static void _add_input(uint64_t cycles, uint8_t type, uint8_t data)
+{
+    static size_t allocated;
+    if (_num_inputs == allocated)
+    {
+        allocated = allocated ? allocated * 2 : 256;
+        _inputs = realloc(_inputs, allocated * sizeof(input_t));
+        if (_inputs == NULL)
+        {
+            perror("realloc");
+            exit(1);
+        }
+    }
+    _inputs[_num_inputs].cycles = cycles;
+    _inputs[_num_inputs].type = type;
+    _inputs[_num_inputs].data = data;
+    _num_inputs++;
+}
+
+static int _compare_inputs(const void *a, const void *b)
+{
+    const input_t *x = a;
+    const input_t *y = b;
+    if (x->cycles != y->cycles)
+    {
+        return (x->cycles < y->cycles) ? -1 : 1;
+    }
+    return (int)x->type - (int)y->type;
+}
+
+static void _read_inputs(FILE *f)
+{
+    char line[128];
+    char word[16];
+    double us;
+    unsigned int data;
+    double low_us;
+
+    while (fgets(line, sizeof(line), f) != NULL)
+    {
+        if ((line[0] == '#') || (sscanf(line, "%lf %15s", &us, word) != 2))
+        {
+            continue;
+        }
+        uint64_t cycles = (uint64_t)(us * CYCLES_PER_US);
+
+        if (strcmp(word, "insert") == 0)
+        {
+            _add_input(cycles, INPUT_INSERT, 0);
+        }
+        else if (strcmp(word, "remove") == 0)
+        {
+            _add_input(cycles, INPUT_REMOVE, 0);
+        }
+        else if ((strcmp(word, "byte") == 0) &&
+                 (sscanf(line, "%*f %*s %x %lf", &data, &low_us) == 2))
+        {
+            _add_input(cycles, INPUT_SELECT, 0);
+            _add_input(cycles + (uint64_t)(low_us * CYCLES_PER_US),
+                       INPUT_BYTE, data);
+        }
+        else if (strcmp(word, "cmd") == 0)
+        {
+            int offset, used;
+            sscanf(line, "%*f %*s%n", &offset);
+            while (sscanf(line + offset, "%x%n", &data, &used) == 1)
+            {
+                _add_input(cycles, INPUT_CMD, data);
+                cycles += UART_BYTE_US * CYCLES_PER_US;
+                offset += used;
+            }
+        }
+        else if (strcmp(word, "end") == 0)
+        {
+            _add_input(cycles, INPUT_END, 0);
+        }
+        else
+        {
+            fprintf(stderr, "Bad input: %s", line);
+            exit(1);
+        }
+    }
+    qsort(_inputs, _num_inputs, sizeof(input_t), _compare_inputs);
+}
+
+static void _parse_options(int argc, char **argv)
+{
+    for (int i=1; i<argc; i++)
+    {
+        if ((strcmp(argv[i], "-t") == 0) && (i+1 < argc))
+        {
+            unsigned int speed, low_us, high_us;
+            if ((sscanf(argv[++i], "%u:%u:%u", &speed, &low_us, &high_us) != 3) ||
+                (speed >= TACH_NUM_SPEEDS) || (low_us == 0) || (high_us == 0) ||
+                (low_us > 0xFFFF) || (high_us > 0xFFFF))
+            {
+                fprintf(stderr, "Bad tachometer speed: %s\n", argv[i]);
+                exit(1);
+            }
+            tach_speeds[speed].low_us = low_us;
+            tach_speeds[speed].high_us = high_us;
+        }
+        else if ((strcmp(argv[i], "-w") == 0) && (i+1 < argc))
+        {
+            uint8_t length = 0;
+            char *step = strtok(argv[++i], ",");
+            while (step != NULL)
+            {
+                unsigned int level, ms;
+                if ((length == SWITCH_MAX_STEPS) ||
+                    (sscanf(step, "%u:%u", &level, &ms) != 2) ||
+                    (level > 1) || (ms > 0xFFFF))
+                {
+                    fprintf(stderr, "Bad SWITCH play pattern\n");
+                    exit(1);
+                }
+                switch_play_pattern[length].level = level;
+                switch_play_pattern[length].ms = ms;
+                length++;
+                step = strtok(NULL, ",");
+            }
+            switch_play_pattern_length = length;
+        }
+        else
+        {
+            fprintf(stderr, usage, argv[0]);
+            exit(1);
+        }
+    }
+}
+
+int main(int argc, char **argv)
+{
+    led_init();
+    timer_init();
+    event_init();
+    cmd_init();
+    deck_init();
+    tach_init();
+    switch_init();
+    _parse_options(argc, argv);
+    _read_inputs(stdin);
+
+    DDRD |= _BV(PD7);   // FE/ME as output
+    DDRA |= _BV(PA0);   // MONITOR as output
+    _last_state = deck_state;
+    _next_compare = NEVER;
+    signals_apply();
+    _print_outputs();
+
+    uint64_t next_tick = CYCLES_PER_TICK;
+    size_t next_input = 0;
+    while (next_input < _num_inputs)
+    {
+        input_t *input = &_inputs[next_input];
+        if ((next_tick <= _next_compare) && (next_tick <= input->cycles))
+        {
+            _now = next_tick;
+            native_tick();
+            next_tick += CYCLES_PER_TICK;
+        }
+        else if (_next_compare <= input->cycles)
+        {
+            _now = _next_compare;
+            native_timer1_compa();
+            _next_compare += (uint64_t)(OCR1A + 1) * CYCLES_PER_COUNT1;
+        }
+        else
+        {
+            _now = input->cycles;
+            if (input->type == INPUT_END)
+            {
+                break;
+            }
+            _handle_input(input);
+            next_input++;
+        }
+        _main_loop();
+    }
+
+    if (event_dropped() != 0)
+    {
+        fprintf(stderr, "%u bytes dropped\n", event_dropped());
+        return 1;
+    }
+    return 0;
+}
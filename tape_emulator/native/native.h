@@ -0,0 +1,12 @@
+#ifndef NATIVE_H
+#define NATIVE_H
+
+#include <stdint.h>
+
+// Host build of the deck decoder and outputs.  main.c simulates the
+// board in CPU cycles and calls these like the interrupts would.
+
+void native_tick();         // Timer3 compare A
+void native_timer1_compa(); // Timer1 compare A (in firmware/signals.c)
+
+#endif
@@ -0,0 +1,29 @@
+#include "main.h"
+#include "native.h"
+#include "signals.h"
+#include "timer.h"
+
+/*************************************************************************
+ * Host Timer
+ *
+ * Implements timer.h for the host build.  main.c calls native_tick()
+ * every 100 us of simulated time, like the Timer3 interrupt.
+ *************************************************************************/
+
+static uint32_t _ticks;
+
+void timer_init()
+{
+    _ticks = 0;
+}
+
+uint32_t timer_now()
+{
+    return _ticks;
+}
+
+void native_tick()
+{
+    _ticks++;
+    switch_tick();
+}
@@ -0,0 +1,10 @@
+#ifndef NATIVE_UTIL_ATOMIC_H
+#define NATIVE_UTIL_ATOMIC_H
+
+// Host build: there are no interrupts, so atomic blocks are plain blocks
+
+#define ATOMIC_RESTORESTATE
+#define ATOMIC_FORCEON
+#define ATOMIC_BLOCK(type) for (uint8_t _done = 0; !_done; _done = 1)
+
+#endif
@@ -0,0 +1,8 @@
+#ifndef NATIVE_UTIL_DELAY_H
+#define NATIVE_UTIL_DELAY_H
+
+// Host build: only led_blink() delays, and it is not used
+
+#define _delay_ms(ms)
+
+#endif
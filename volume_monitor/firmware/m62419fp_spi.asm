@@ -5,12 +5,20 @@
 ;change interrupt fires for the clock edges and the ISR accumulates the bits.
 ;
 ;There are 3 buffers used in this code.  The ISR uses packet_isr_buf to
-;accumulate SPI bits received.  When a complete packet is received, it moves
-;the packet into packet_rx_buf.  The main loop waits for a new packet in
-;packet_rx_buf and then transfers it into packet_work_buf.  The work buffer is
-;used by all code in the main loop.  This allows receiving a new command while
-;the main loop is still processing the last one.  The main loop should call
-;spi_get_packet (below) and then operate only on packet_work_buf.
+;accumulate SPI bits received.  When a complete packet is received, it adds
+;the packet and the time it was received (see timer.asm) to packet_ring at
+;packet_head.  The main loop takes the oldest
+;packet from packet_ring at packet_tail and transfers it into packet_work_buf.
+;The work buffer is used by all code in the main loop.  The ring holds up to
+;PACKET_RING_SIZE-1 packets, so commands sent back to back (like a volume
+;ramp) are not lost while the main loop is still sending an earlier one.  If
+;the ring is full, the new packet is dropped and packet_dropped is counted
+;up (it stops at $FFFF).  The main loop should call spi_get_packet (below)
+;and then operate only on packet_work_buf.
+;
+;Only the ISR writes packet_head and packet_dropped, and only the main loop
+;writes packet_tail, so the ring needs no locking.  The 2-byte packet_dropped
+;must be read with interrupts disabled.
 ;
 ;Registers reserved for the ISR that may not be used by any other code:
 ;  R21, R22
@@ -40,17 +48,19 @@ spi_init:
     sts packet_isr_buf, r16     ;Clear low data byte
     sts packet_isr_buf+1, r16   ;Clear high data byte
 
-    ;Clear latest packet received (ISR writes complete packet to this buffer)
+    ;Empty the ring of complete packets and clear the drop counter
     clr r16
-    sts packet_rx_buf, r16
-    sts packet_rx_buf+1, r16
+    sts packet_head, r16
+    sts packet_tail, r16
+    sts packet_dropped, r16
+    sts packet_dropped+1, r16
     ret
 
 
 spi_isr_pcint0:
 ;PCINT0 Pin Change Group 0 Interrupt Service Routine
 ;Fires for any change on PA1 (M62419FP CLK).
-;R21 and R22 are destroyed by this ISR.
+;R21 and R22 are destroyed by this ISR.  Z and R23 are preserved.
 ;
     in r21, PINA                ;Read port immediately (SREG unaffected)
     in r22, SREG                ;Preserve SREG
@@ -78,14 +88,52 @@ spi_isr_pcint0:
     brne spi_isr_done           ;More bits?  Nothing more to do this time.
 
     ;A complete packet has been received.
-    ;Transfer packet_isr_buf -> packet_rx_buf
+    ;Transfer packet_isr_buf -> packet_ring at packet_head
+
+    push ZL
+    push ZH
+    push r23
+
+    lds r21, packet_head        ;R21 = index of the free slot at the head
+    mov r23, r21
+    inc r23
+    andi r23, PACKET_RING_SIZE-1 ;R23 = head after adding this packet
+    lds ZL, packet_tail
+    cp r23, ZL                  ;Would the head run into the tail?
+    breq spi_isr_drop           ;  Yes: ring is full, drop the packet
+
+    ldi ZL, low(packet_ring)    ;Z = packet_ring + (head * PACKET_SIZE)
+    ldi ZH, high(packet_ring)
+    lsl r21
+    lsl r21
+    add ZL, r21
+    clr r21
+    adc ZH, r21
 
     lds r21, packet_isr_buf
-    sts packet_rx_buf, r21      ;Save low byte
-
+    st Z+, r21                  ;Save low byte
     lds r21, packet_isr_buf+1
-    ori r21, 0b10000000         ;Set unused bit to indicate packet complete
-    sts packet_rx_buf+1, r21    ;Save high byte
+    st Z+, r21                  ;Save high byte
+    lds r21, TCNT1L             ;Save timestamp (low byte must be read first)
+    st Z+, r21
+    lds r21, TCNT1H
+    st Z, r21
+
+    sts packet_head, r23        ;Hand the packet to the main loop
+    rjmp spi_isr_queued
+
+spi_isr_drop:
+    lds ZL, packet_dropped      ;Increment the 16-bit drop counter
+    lds ZH, packet_dropped+1
+    adiw ZH:ZL, 1
+    breq spi_isr_queued         ;Stop at $FFFF instead of wrapping to 0
+    sts packet_dropped, ZL
+    sts packet_dropped+1, ZH
+
+spi_isr_queued:
+    pop r23
+    pop ZH
+    pop ZL
 
     ;Set up for next time.
 
@@ -101,33 +149,48 @@ spi_isr_done:
 
 
 spi_get_packet:
-;Check if a new packet has been received by the ISR, if so then move
-;it into the work buffer.  Destroys R16, R17, R18.
+;Check if the ISR has added a packet to the ring, if so then move the
+;oldest one into the work buffer.  Destroys R16, R17, X-pointer.
 ;
-;Stores the packet at Y-pointer (if a packet is available).
+;Stores the packet at Y-pointer (if a packet is available), followed by
+;the 2-byte timestamp of when it was received.
 ;Carry set = packet ready, Carry clear = no packet.
 ;
     ;Check for a new packet
-    lds r16, packet_rx_buf+1    ;Load high byte
+    lds r16, packet_tail        ;Load index of the oldest packet
+    lds r17, packet_head        ;Load index of the ISR's next free slot
+    cp r16, r17
+    brne spi_get_ready          ;Not equal: ring has a packet
     clc                         ;Carry clear = no packet
-    sbrs r16, 7                 ;Skip next if bit 7 indicates packet complete
     ret                         ;No packet yet
 
-    ;A packet is available in packet_rx_buf
-    ;Read it into R16+R17 and then clear packet_rx_buf for the next packet
-    ;Interrupts disabled to prevent race if a new byte is received during copy
-    clr r18
-    cli
-    lds r16, packet_rx_buf
-    lds r17, packet_rx_buf+1
-    sts packet_rx_buf, r18
-    sts packet_rx_buf+1, r18
-    sei
+spi_get_ready:
+    ;The ISR does not write to the slot at the tail until the tail moves
+    ;past it, so it can be read with interrupts enabled.
+    ldi XL, low(packet_ring)    ;X = packet_ring + (tail * PACKET_SIZE)
+    ldi XH, high(packet_ring)
+    mov r17, r16
+    lsl r17
+    lsl r17
+    add XL, r17
+    clr r17
+    adc XH, r17
 
     ;Copy the received 14-bit packet into the work buffer at Y
-    st Y, r16                   ;Copy low byte
+    ld r17, X+                  ;Copy low byte
+    st Y, r17
+    ld r17, X+                  ;Copy high byte
     andi r17, 0b00111111        ;Zero out non-data bits of high byte
-    std Y+1, r17                ;Copy high byte
+    std Y+1, r17
+    ld r17, X+                  ;Copy timestamp
+    std Y+2, r17
+    ld r17, X
+    std Y+3, r17
+
+    ;Free the slot for the ISR
+    inc r16
+    andi r16, PACKET_RING_SIZE-1
+    sts packet_tail, r16
 
     sec                         ;Carry set = packet received
     ret
@@ -2,20 +2,37 @@
 ;
 ;Passively captures SPI commands from the radio's microcontroller to its
 ;Mitsubishi M62419FP sound controller, decodes the commands, computes
-;the programmed attenuator values in dB, then dumps the values out
-;the UART at 115200 bps, N-8-1.
+;the programmed attenuator values in dB, then sends the values that changed
+;out the UART at 115200 bps, N-8-1, along with when the command was
+;received.  The whole state is also sent periodically.
 ;
 .include "m1284def.asm"
 
 
 .equ ram             = SRAM_START
-;Buffers for M62419FP command packets (isr buf -> rx buf -> work buf)
+;Buffers for M62419FP command packets (isr buf -> ring -> work buf)
+.equ PACKET_RING_SIZE = 16      ;Packets in the ring (power of 2, max 64)
+.equ PACKET_SIZE     = 4        ;2 bytes packet, 2 bytes timestamp
 .equ packet_bitcount = ram      ;Counts down bits remaining to rx in packet
 .equ packet_isr_buf  = ram+$01  ;2 bytes to accumulate SPI packet bits in ISR
-.equ packet_rx_buf   = ram+$03  ;2 bytes for complete SPI packet received
-.equ packet_work_buf = ram+$05  ;2 bytes for SPI packet used during parsing
+.equ packet_work_buf = ram+$03  ;4 bytes for SPI packet used during parsing
+.equ packet_head     = ram+$07  ;Ring index the ISR adds the next packet at
+.equ packet_tail     = ram+$08  ;Ring index of the oldest packet
+.equ packet_dropped  = ram+$09  ;2 bytes: packets lost because ring was full
 ;Buffer used to track M62419FP state across commands
-.equ m62419fp_buf    = ram+$07  ;12 byte buffer for M62419FP state
+.equ m62419fp_buf    = ram+$0b  ;12 byte buffer for M62419FP state
+;Buffers for the state sent to the host (see state_build)
+.equ STATE_SIZE      = 19
+.equ state_buf       = ram+$17  ;STATE_SIZE bytes: state now
+.equ state_sent_buf  = ram+$2a  ;STATE_SIZE bytes: state the host has
+.equ sync_time       = ram+$3d  ;2 bytes: timestamp of the last sync frame
+;Ring of complete packets received (ISR -> main loop)
+.equ packet_ring     = ram+$3f  ;PACKET_RING_SIZE * PACKET_SIZE bytes
+
+;Frames sent to the host
+.equ FRAME_SYNC      = 'S'      ;Whole state
+.equ FRAME_CHANGE    = 'C'      ;Bytes of the state changed by a command
+.equ SYNC_TICKS      = 19531    ;Sync frame every 250 ms (12.8 us ticks)
 
 
 ;Offsets into M62419FP state buffer
@@ -51,10 +68,24 @@ reset:
     ldi r16, high(RAMEND)
     out SPH, r16
 
+    ;Clear the M62419FP registers buffer so the first sync frame is defined
+    ldi ZL, low(m62419fp_buf)
+    ldi ZH, high(m62419fp_buf)
+    clr r16
+    ldi r17, 12
+reset_clear:
+    st Z+, r16
+    dec r17
+    brne reset_clear
+
     rcall uart_init             ;15200 bps, N-8-1
+    rcall timer_init            ;Timestamps for packets and frames
     rcall spi_init              ;Set up for M62419FP receive on interrupt
     sei                         ;Enable interrupts
 
+    rcall timer_read            ;Send the first sync frame now
+    rcall send_sync
+
 loop:
     ;Set Y-pointer to a buffer that will receive a packet
     ldi YL, low(packet_work_buf)
@@ -64,100 +95,236 @@ loop:
     ldi ZL, low(m62419fp_buf)
     ldi ZH, high(m62419fp_buf)
 
-wait:
-    ;Wait for an M62419FP command packet
+    ;Handle an M62419FP command packet if one is ready
     rcall spi_get_packet        ;Try to get a new packet into buffer at Y
-    brcc wait                   ;Loop until one is ready
+    brcc loop_sync              ;None yet
 
     rcall cmd_parse             ;Parse command at Y into registers at Z
     rcall cmd_parse             ;Parse command at Y into registers at Z
-    rcall dump_to_uart
+    rcall state_build
+    rcall send_changes
+
+loop_sync:
+    ;Send a sync frame if SYNC_TICKS have passed since the last one
+    rcall timer_read            ;R17:R16 = now
+    push r16
+    push r17
+    lds r18, sync_time          ;R17:R16 = now - sync_time
+    lds r19, sync_time+1
+    sub r16, r18
+    sbc r17, r19
+    ldi r18, high(SYNC_TICKS)
+    cpi r16, low(SYNC_TICKS)
+    cpc r17, r18
+    pop r17
+    pop r16
+    brlo loop                   ;Not time yet
+    rcall send_sync
     rjmp loop
 
 
-dump_to_uart:
-;Dump the virtual M62419FP register state to the UART, along with
-;the calculated attenuation values in dB.
+send_sync:
+;Send the whole state in a sync frame and remember it as sent.
+;The timestamp of the frame is in R17:R16.
 ;
-;Format of the dump:
-;  Byte  0: Number of bytes to follow
-;  Byte  1: CH0 ATT1 5-bit code
-;  Byte  2: CH0 ATT2 2-bit code
-;  Byte  3: CH0 Attenuation (ATT1+ATT2) in signed dB
-;  Byte  4: CH0 Loudness flag
-;  Byte  5: CH0 Input Selector 2-bit code
-;  Byte  6: CH1 ATT1 5-bit code
-;  Byte  7: CH1 ATT2 2-bit code
-;  Byte  8: CH1 Attenuation (ATT1+ATT2) in signed dB
-;  Byte  9: CH1 Loudness flag
-;  Byte 10: CH1 Input Selector 2-bit code
-;  Byte 11: Fader Select flag
-;  Byte 12: Fader 4-bit code
-;  Byte 13: Fader Attenuation in signed dB
-;  Byte 14: Bass 4-bit code
-;  Byte 15: Bass tone in signed dB
-;  Byte 16: Treble 4-bit code
-;  Byte 17: Treble tone in signed dB
+;Format of the sync frame:
+;  Byte  0: Number of bytes to follow (3 + STATE_SIZE)
+;  Byte  1: FRAME_SYNC
+;  Byte  2: Timestamp low byte
+;  Byte  3: Timestamp high byte
+;  Bytes 4-22: State (see state_build)
 ;
-;Destroys R16, R17, R18, Z-pointer.
+;Destroys R16, R17, R18, R19, X-pointer, Z-pointer.
 ;
-    ldi r16, 17
+    sts sync_time, r16
+    sts sync_time+1, r17
+    rcall state_build           ;Includes packets dropped since the last one
+
+    ldi r16, 3+STATE_SIZE
     rcall uart_send_byte        ;Send number of bytes to follow
+    ldi r16, FRAME_SYNC
+    rcall uart_send_byte        ;Send frame type
+    lds r16, sync_time
+    rcall uart_send_byte        ;Send timestamp low byte
+    lds r16, sync_time+1
+    rcall uart_send_byte        ;Send timestamp high byte
+
+    ldi XL, low(state_buf)
+    ldi XH, high(state_buf)
+    ldi ZL, low(state_sent_buf)
+    ldi ZH, high(state_sent_buf)
+    ldi r18, STATE_SIZE
+ss_loop:
+    ld r16, X+                  ;Load and send a byte of the state
+    rcall uart_send_byte
+    st Z+, r16                  ;The host has it now
+    dec r18
+    brne ss_loop
+    ret
+
+
+send_changes:
+;Send the bytes of the state that changed since they were last sent in
+;a change frame.  Nothing is sent if nothing changed.  The timestamp of the
+;frame is the time the packet at Y was received.
+;
+;Format of the change frame:
+;  Byte  0: Number of bytes to follow (3 + 2 * number of changes)
+;  Byte  1: FRAME_CHANGE
+;  Byte  2: Timestamp low byte
+;  Byte  3: Timestamp high byte
+;  Then for each change:
+;    Byte 0: Index into the state (see state_build)
+;    Byte 1: New value
+;
+;Destroys R16, R17, R18, R19, X-pointer, Z-pointer.
+;
+    ;Count the changed bytes to find the frame length
+    ldi XL, low(state_buf)
+    ldi XH, high(state_buf)
+    ldi ZL, low(state_sent_buf)
+    ldi ZH, high(state_sent_buf)
+    clr r18                     ;R18 = number of changes
+    ldi r19, STATE_SIZE
+sc_count:
+    ld r16, X+
+    ld r17, Z+
+    cpse r16, r17               ;Skip next if unchanged
+    inc r18
+    dec r19
+    brne sc_count
+
+    tst r18                     ;Anything changed?
+    breq sc_done                ;  No: send nothing
+
+    lsl r18                     ;2 bytes per change
+    subi r18, -3                ;  plus type and timestamp
+    mov r16, r18
+    rcall uart_send_byte        ;Send number of bytes to follow
+    ldi r16, FRAME_CHANGE
+    rcall uart_send_byte        ;Send frame type
+    ldd r16, Y+2
+    rcall uart_send_byte        ;Send timestamp low byte
+    ldd r16, Y+3
+    rcall uart_send_byte        ;Send timestamp high byte
+
+    ;Send the index and value of each changed byte
+    ldi XL, low(state_buf)
+    ldi XH, high(state_buf)
+    ldi ZL, low(state_sent_buf)
+    ldi ZH, high(state_sent_buf)
+    clr r19                     ;R19 = index into the state
+sc_send:
+    ld r17, X+                  ;Load new value
+    ld r16, Z                   ;Load value the host has
+    cp r16, r17
+    breq sc_next                ;Unchanged: skip it
+    st Z, r17                   ;The host will have the new value
+    mov r16, r19
+    rcall uart_send_byte        ;Send index
+    mov r16, r17
+    rcall uart_send_byte        ;Send new value
+sc_next:
+    adiw ZH:ZL, 1
+    inc r19
+    cpi r19, STATE_SIZE
+    brne sc_send
+sc_done:
+    ret
+
+
+state_build:
+;Build the state sent to the host in state_buf from the virtual M62419FP
+;registers, along with the calculated attenuation values in dB.
+;
+;Format of the state:
+;  Byte  0: CH0 ATT1 5-bit code
+;  Byte  1: CH0 ATT2 2-bit code
+;  Byte  2: CH0 Attenuation (ATT1+ATT2) in signed dB
+;  Byte  3: CH0 Loudness flag
+;  Byte  4: CH0 Input Selector 2-bit code
+;  Byte  5: CH1 ATT1 5-bit code
+;  Byte  6: CH1 ATT2 2-bit code
+;  Byte  7: CH1 Attenuation (ATT1+ATT2) in signed dB
+;  Byte  8: CH1 Loudness flag
+;  Byte  9: CH1 Input Selector 2-bit code
+;  Byte 10: Fader Select flag
+;  Byte 11: Fader 4-bit code
+;  Byte 12: Fader Attenuation in signed dB
+;  Byte 13: Bass 4-bit code
+;  Byte 14: Bass tone in signed dB
+;  Byte 15: Treble 4-bit code
+;  Byte 16: Treble tone in signed dB
+;  Byte 17: Packets dropped, low byte
+;  Byte 18: Packets dropped, high byte
+;
+;Destroys R16, R17, R18, X-pointer, Z-pointer.
+;
+    ldi XL, low(state_buf)
+    ldi XH, high(state_buf)
     clr r18                     ;Channel number = 0
-dump_loop:
+state_loop:
     ;Set Z-pointer to buffer area for channel 0 or 1
     ldi ZL, low(m62419fp_buf)   ;Base address of M62419FP registers buffer
     ldi ZH, high(m62419fp_buf)
     sbrc r18, 0                 ;Skip next instruction if this is channel 0
     adiw ZH:ZL, ch1             ;Add offset for channel 1 registers
 
-    ;Send ATT1 and ATT2 codes, calculate ATT1+ATT2 in dB and send it
+    ;Store ATT1 and ATT2 codes, calculate ATT1+ATT2 in dB and store it
     ld r16, Z+                  ;Load ATT1 code
-    rcall uart_send_byte        ;Send it
+    st X+, r16                  ;Store it
     rcall cmd_calc_att1_db      ;Convert ATT1 to signed dB
     push r16                    ;Save ATT1 dB on the stack
     ld r16, Z+                  ;Load ATT2 code
-    rcall uart_send_byte        ;Send it
+    st X+, r16                  ;Store it
     rcall cmd_calc_att2_db      ;Convert it to signed dB
     mov r17, r16                ;Move ATT2 dB into R17
     pop r16                     ;Recall ATT1 dB into R16
     rcall cmd_calc_att_sum_db   ;Caculate sum of R16 + R17 in signed dB
-    rcall uart_send_byte        ;Send it
+    st X+, r16                  ;Store it
 
-    ;Send other registers
-    ld r16, Z+                  ;Load and send loudness
-    rcall uart_send_byte
-    ld r16, Z+                  ;Load and send input selector
-    rcall uart_send_byte
+    ;Store other registers
+    ld r16, Z+                  ;Load and store loudness
+    st X+, r16
+    ld r16, Z+                  ;Load and store input selector
+    st X+, r16
 
     inc r18                     ;Increment channel number
     cpi r18, 2                  ;Finished both channels?
-    brne dump_loop              ;  No: dump next channel
+    brne state_loop             ;  No: store next channel
 
     ;Set Z-pointer to buffer area for fader
     ldi ZL, low(m62419fp_buf+common)
     ldi ZH, high(m62419fp_buf+common)
 
-    ld r16, Z+                  ;Load and send fader select
-    rcall uart_send_byte
+    ld r16, Z+                  ;Load and store fader select
+    st X+, r16
 
     ld r16, Z+                  ;Load fader 4-bit code
-    rcall uart_send_byte        ;Send it
+    st X+, r16                  ;Store it
     rcall cmd_calc_fader_db     ;Convert it to signed dB
-    rcall uart_send_byte        ;Send it
+    st X+, r16                  ;Store it
 
     ld r16, Z+                  ;Load bass 4-bit code
-    rcall uart_send_byte        ;Send it
+    st X+, r16                  ;Store it
     rcall cmd_calc_tone_db      ;Convert it to signed dB
-    rcall uart_send_byte        ;Send it
+    st X+, r16                  ;Store it
 
     ld r16, Z+                  ;Load treble 4-bit code
-    rcall uart_send_byte        ;Send it
+    st X+, r16                  ;Store it
     rcall cmd_calc_tone_db      ;Convert it to signed dB
-    rcall uart_send_byte        ;Send it
+    st X+, r16                  ;Store it
+
+    cli                         ;ISR may update the count between bytes
+    lds r16, packet_dropped     ;Load packets dropped
+    lds r17, packet_dropped+1
+    sei
+    st X+, r16                  ;Store low byte
+    st X+, r17                  ;Store high byte
     ret
 
 
 .include "m62419fp_spi.asm"     ;M62419FP SPI receive
 .include "m62419fp_cmd.asm"     ;M52419FP SPI command packet parsing
 .include "uart.asm"             ;UART routines
+.include "timer.asm"            ;Timestamp timer
@@ -0,0 +1,33 @@
+;Timestamp Timer
+;
+;Timer1 counts freely at 20 MHz / 256 (one tick = 12.8 us) and wraps every
+;0.84 seconds.  The 16-bit count is used as the timestamp of each packet
+;and frame.  Frames are sent at least every SYNC_TICKS, so the host can
+;tell how many times the count has wrapped.  No interrupt is used.
+;
+;Reading TCNT1 uses the shared TEMP register, so the main loop must read it
+;with interrupts disabled (timer_read below) in case the ISR reads it too.
+
+
+timer_init:
+;Start Timer1 counting at F_CPU / 256 in normal mode.
+;Destroy R16.
+;
+    clr r16
+    sts TCCR1A, r16             ;Normal mode, no outputs
+    sts TCNT1H, r16             ;Start counting from 0 (high byte first)
+    sts TCNT1L, r16
+    ldi r16, (1 << CS12)        ;Clock select: F_CPU / 256
+    sts TCCR1B, r16
+    ret
+
+
+timer_read:
+;Read the current timestamp.
+;Stores the 16-bit count in R16 (low) and R17 (high).
+;
+    cli                         ;ISR may also use TEMP to read TCNT1
+    lds r16, TCNT1L             ;Low byte must be read first
+    lds r17, TCNT1H
+    sei
+    ret
@@ -2,44 +2,322 @@
 '''
 VW Radio Volume Monitor
 
-Receives packets of M62419FP data from the AVR's UART and displays them.
+Receives frames of M62419FP data from the AVR's UART, rebuilds the state
+from them, and displays it.
+
+Usage: %s                       display the state
+       %s record <log>          display the state and append every frame to <log>
+       %s analyze <file> ...    analyze logs or logic analyzer captures (.csv[.gz])
+
+The AVR sends a sync frame with the whole state every 250 ms, and a change
+frame with only the bytes of the state that changed after each command.
+Both are stamped with Timer1 (12.8 us ticks, wraps every 0.84 seconds).
+
+A log is a sequence of records: the host time (little endian double,
+seconds since the epoch), then the frame as received (length byte first).
+Records are only ever appended, so one log can hold several sessions.
+
+The analysis finds volume ramps (runs of volume steps in one direction),
+the intervals between the steps, and the attenuation used for each input.
+Captures of the radio's SPI commands in
+reverse_engineering/premium_4/captures/m62419fp are read with its decode.py,
+and the analysis uses its tables and names so the output lines up.
 '''
 
+import os
+import statistics
 import struct
 import sys
-import serial # pyserial
+import time
+
+FRAME_SYNC = ord('S')
+FRAME_CHANGE = ord('C')
+TICK_SECS = 256 / 20000000.0    # Timer1 at F_CPU / 256
+STATE_SIZE = 19
+
+CAPTURES = os.path.join(os.path.dirname(os.path.abspath(__file__)), '..', '..',
+    'reverse_engineering', 'premium_4', 'captures', 'm62419fp')
+sys.path.append(CAPTURES)
+import decode   # tables and names of the M62419FP commands
+RECORD = struct.Struct('<d')    # host time before each frame in a log
+SESSION_GAP = 1.0   # seconds without frames that start a new session in a log
+STEP_GAP = 0.02     # changes closer than this are one step (CH0 then CH1)
+RAMP_GAP = 1.0      # steps further apart than this start a new ramp
 
 def make_serial():
     '''Make Serial() instance for first non-Bluetooth serial port'''
+    import serial # pyserial
     from serial.tools.list_ports import comports
     names = [ x.device for x in comports() if 'Bluetooth' not in x.device ]
     if not names:
         raise Exception("No serial port found")
     return serial.Serial(port=names[0], baudrate=115200, timeout=None)
 
-def read_packet(ser):
-    '''Read a packet from the AVR.  Returns [CH0, CH1]'''
-    count = bytearray(ser.read(1))[0]   # read number of bytes to follow
-    packet = bytearray(ser.read(count)) # read those bytes
-    return packet
+def read_frame(ser):
+    '''Read a frame from the AVR.  Returns the frame with its length byte'''
+    count = bytearray(ser.read(1))      # read number of bytes to follow
+    frame = bytearray(ser.read(count[0]))  # read those bytes
+    return count + frame
+
+def parse_frame(frame):
+    '''Returns (type, timestamp, data) of a frame with its length byte'''
+    timestamp = frame[2] + (frame[3] << 8)
+    return frame[1], timestamp, frame[4:]
+
+def read_log(filename):
+    '''Yields (host time, frame) for each record in a log.  A record cut
+    short at the end (the recorder was stopped while writing) is ignored.'''
+    with open(filename, 'rb') as f:
+        while True:
+            head = f.read(RECORD.size + 1)
+            if len(head) < RECORD.size + 1:
+                break
+            frame = head[RECORD.size:] + f.read(head[RECORD.size])
+            if len(frame) < head[RECORD.size] + 1:
+                break
+            yield RECORD.unpack_from(head)[0], bytearray(frame)
+
+
+class State(object):
+    '''Rebuilds the state and the time in seconds from the frames'''
+    def __init__(self):
+        self.data = None    # state bytes (see state_build in main.asm)
+        self.secs = 0.0
+        self.last_timestamp = None
+
+    def update(self, kind, timestamp, data):
+        '''Apply a frame.  Returns the indexes of the bytes that changed.'''
+        # frames are sent at least every 250 ms, so the count has wrapped
+        # at most once.  A sync frame can be stamped just before a command
+        # that is still queued, so small steps back are allowed.
+        if self.last_timestamp is not None:
+            delta = (timestamp - self.last_timestamp) & 0xFFFF
+            if delta >= 0x8000:
+                delta -= 0x10000
+            self.secs += delta * TICK_SECS
+        self.last_timestamp = timestamp
+
+        if kind == FRAME_SYNC and len(data) == STATE_SIZE:
+            changed = [i for i in range(STATE_SIZE)
+                       if self.data is None or self.data[i] != data[i]]
+            self.data = bytearray(data)
+            return changed
+        if kind == FRAME_CHANGE and self.data is not None:
+            changed = []
+            for i in range(0, len(data) - 1, 2):
+                index, value = data[i], data[i+1]
+                if index < STATE_SIZE:
+                    self.data[index] = value
+                    changed.append(index)
+            return changed
+        return []   # no sync frame yet or unknown frame
+
+    def dropped(self):
+        return self.data[17] + (self.data[18] << 8)
+
+
+# Analysis ==================================================================
+
+def channels_from_state(data):
+    '''Returns [(att1, att2, loudness, input) for CH0 and CH1] from the
+    state bytes (see state_build in main.asm)'''
+    return [tuple(data[0:2] + data[3:5]), tuple(data[5:7] + data[8:10])]
+
+def log_changes(filename):
+    '''Yields (seconds, channels) after each change frame in a log.  The
+    time is the host time of the first frame of the session plus the AVR's
+    time since then, so intervals are as precise as the AVR's timestamps.'''
+    state = None
+    last_host_secs = None
+    for host_secs, frame in read_log(filename):
+        if last_host_secs is None or host_secs - last_host_secs > SESSION_GAP:
+            state = State()     # new session: the AVR may have been reset
+            state.secs = host_secs
+        last_host_secs = host_secs
+
+        kind, timestamp, data = parse_frame(frame)
+        if state.update(kind, timestamp, data) and kind == FRAME_CHANGE:
+            yield state.secs, channels_from_state(state.data)
+
+def capture_changes(filename):
+    '''Yields (seconds, channels) after each command in a logic analyzer
+    capture, parsed the same way as the AVR does'''
+    channels = [(0, 0, 0, 0), (0, 0, 0, 0)]
+    for secs, command in decode.read_commands(filename):
+        if command & 1:
+            continue    # bass/treble/fade
+        att1 = (command >> 7) & 0x1F
+        att2 = (command >> 5) & 0x03
+        loudness = (command >> 4) & 0x01
+        input_code = (command >> 2) & 0x03
+        value = (att1, att2, loudness, input_code)
+        if command & 0x1000:    # single channel
+            channels[(command >> 13) & 1] = value
+        else:
+            channels = [value, value]
+        yield secs, list(channels)
+
+def att_db(channel):
+    '''Returns (ATT1, ATT2, SUM) in dB of a channel, None if undefined'''
+    att1_db = decode.att1_to_db[channel[0]]
+    att2_db = decode.att2_to_db[channel[1]]
+    if att1_db is None:
+        return None, att2_db, None
+    return att1_db, att2_db, att1_db + att2_db
+
+def volume_db(channels):
+    '''The louder of the two channels, so balance does not look like a step'''
+    sums = [att_db(ch)[2] for ch in channels]
+    return max(x for x in sums if x is not None) if any(
+        x is not None for x in sums) else None
+
+class Analysis(object):
+    '''Collects volume ramps, step intervals, and attenuation by input from
+    the changes.  Ramps are written out as they end, so the memory used does
+    not grow with the length of the log.'''
+    def __init__(self, out):
+        self.out = out
+        self.intervals = []
+        self.attenuations = {}  # input code: {(att1 code, att2 code): count}
+        self.ramps = 0
+        self.start_file()
+        self.out.write("RAMPS (first step secs, duration ms, steps, "
+                       "dB from -> to, curve ms:dB)\n")
+
+    def start_file(self):
+        self.channels = None
+        self.level = None       # volume before the ramp in progress
+        self.ramp = []          # [(seconds, dB)] steps of the ramp in progress
+        self.last_step = None   # (seconds, dB) of the last step
+
+    def change(self, secs, channels):
+        for i, ch in enumerate(channels):
+            if self.channels is None or self.channels[i] != ch:
+                counts = self.attenuations.setdefault(ch[3], {})
+                counts[ch[0:2]] = counts.get(ch[0:2], 0) + 1
+        self.channels = channels
+
+        db = volume_db(channels)
+        if db is None:
+            return
+        if self.last_step is None:
+            self.last_step = (secs, db)
+            return
+
+        last_secs, last_db = self.last_step
+        if secs - last_secs < STEP_GAP:
+            # rest of the last step (CH1 after CH0)
+            self.last_step = (last_secs, db)
+            if self.ramp:
+                self.ramp[-1] = self.last_step
+            return
+        if db == last_db:
+            return  # not a volume change, e.g. the input
+
+        if secs - last_secs <= RAMP_GAP:
+            self.intervals.append(secs - last_secs)
+        direction = (db > last_db) - (db < last_db)
+        if (secs - last_secs > RAMP_GAP or not self.ramp or
+                direction != self._direction()):
+            self.end_ramp()
+            self.level = last_db
+        self.ramp.append((secs, db))
+        self.last_step = (secs, db)
+
+    def _direction(self):
+        db = self.ramp[-1][1]
+        return (db > self.level) - (db < self.level)
+
+    def end_ramp(self):
+        if self.ramp:
+            start = self.ramp[0][0]
+            curve = ' '.join('%d:%d' % ((secs - start) * 1000, db)
+                             for secs, db in self.ramp)
+            self.out.write("%12.4f %8.1f %4d %5d -> %4d  %s\n" % (
+                start, (self.ramp[-1][0] - start) * 1000, len(self.ramp),
+                self.level, self.ramp[-1][1], curve))
+            self.ramps += 1
+        self.ramp = []
+
+    def finish(self):
+        self.end_ramp()
+        self.out.write("%d ramps\n\n" % self.ramps)
+
+        self.out.write("STEP INTERVALS\n")
+        if self.intervals:
+            ms = sorted(x * 1000 for x in self.intervals)
+            self.out.write("%d steps: min %.1f ms, median %.1f ms, max %.1f ms\n" % (
+                len(ms), ms[0], statistics.median(ms), ms[-1]))
+            for low in range(0, int(RAMP_GAP * 1000), 50):
+                count = len([x for x in ms if low <= x < low + 50])
+                if count:
+                    self.out.write("%4d-%4d ms %6d %s\n" % (
+                        low, low + 50, count, '#' * min(count, 60)))
+        self.out.write('\n')
+
+        self.out.write("ATTENUATION BY INPUT (commands)\n")
+        for input_code in sorted(self.attenuations):
+            self.out.write("INPUT = %s\n" % decode.input_to_name[input_code])
+            counts = self.attenuations[input_code]
+            dbs = dict((att, att_db(att)) for att in counts)
+            for att in sorted(counts, key=lambda att: (dbs[att][2] is not None, dbs[att][2])):
+                self.out.write("\tATT1 = %s dB\tATT2 = %s dB\tSUM = %s dB\t%d\n" % (
+                    dbs[att] + (counts[att],)))
+
+
+def analyze(filenames):
+    analysis = Analysis(sys.stdout)
+    for filename in filenames:
+        is_capture = filename.endswith('.csv') or filename.endswith('.csv.gz')
+        changes = capture_changes(filename) if is_capture else log_changes(filename)
+        analysis.start_file()
+        for secs, channels in changes:
+            analysis.change(secs, channels)
+        analysis.end_ramp()
+    analysis.finish()
+
+
+# Display ===================================================================
 
 signed_char = lambda x: struct.unpack('b', x)[0]
 inputs = ('CD', 'FM', 'TAPE', 'AM')
 fadesels = ('F', 'R')
 
-def main():
-    '''Wait for a packet from the AVR, display it, repeat forever'''
+def usage():
+    sys.stderr.write((__doc__.strip() + '\n').replace('%s', sys.argv[0]))
+    sys.exit(1)
+
+def display(log=None):
+    '''Wait for a frame from the AVR, display the state, repeat forever.
+    If log is a file, append each frame to it.'''
     sys.stdout.write('\n')
 
     ser = make_serial()
     ser.reset_input_buffer()
 
+    state = State()
+    last_change = None
+    interval = 0
     try:
         while True:
-            packet = read_packet(ser)
-            fmt = ('\rCH0/R=%d dB (L=%d,I=%s)  CH1/L=%d dB (L=%d,I=%s)  '
-                   'FADER=%d dB (%s)  BASS=%d dB  TREB=%d dB        ')
+            frame = read_frame(ser)
+            if log is not None:
+                log.write(RECORD.pack(time.time()) + frame)
+            kind, timestamp, data = parse_frame(frame)
+            state.update(kind, timestamp, data)
+            if state.data is None:
+                continue
+            if kind == FRAME_CHANGE:
+                if last_change is not None:
+                    interval = state.secs - last_change
+                last_change = state.secs
+
+            packet = state.data
+            fmt = ('\r%10.4f  CH0/R=%d dB (L=%d,I=%s)  CH1/L=%d dB (L=%d,I=%s)  '
+                   'FADER=%d dB (%s)  BASS=%d dB  TREB=%d dB  DROPPED=%d  '
+                   'INTERVAL=%.1f ms        ')
             sys.stdout.write(fmt % (
+                state.secs,
                 signed_char(packet[2:3]),
                 packet[3],
                 inputs[packet[4]],
@@ -49,11 +327,25 @@ def main():
                 signed_char(packet[12:13]),
                 fadesels[packet[10]],
                 signed_char(packet[14:15]),
-                signed_char(packet[16:17])))
+                signed_char(packet[16:17]),
+                state.dropped(),
+                interval * 1000))
             sys.stdout.flush()
     except KeyboardInterrupt:
         pass
 
 
+def main():
+    args = sys.argv[1:]
+    if not args:
+        display()
+    elif args[0] == 'record' and len(args) == 2:
+        with open(args[1], 'ab', buffering=0) as log:
+            display(log)
+    elif args[0] == 'analyze' and len(args) >= 2:
+        analyze(args[1:])
+    else:
+        usage()
+
 if __name__ == '__main__':
     main()